@@ -0,0 +1,452 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include <slogger/DirectConsoleLogger.hpp>
+#include <urtsched/MonotonicTimer.hpp>
+#include <urtsched/RealtimeKernel.hpp>
+#include <urtsched/Simulation.hpp>
+#include <urtsched/StatusWriter.hpp>
+#include <urtsched/TimingWheel.hpp>
+#include <urtsched/latest_value.hpp>
+
+using namespace realtime;
+using namespace std::chrono_literals;
+
+/** Run with --benchmark_out=bench.json --benchmark_out_format=json to get
+ * numbers that can be compared between builds.
+ */
+namespace
+{
+
+logging::DirectConsoleLogger& get_logger()
+{
+    static logging::DirectConsoleLogger logger(
+        true, true, logging::LogOutput::CONSOLE);
+    return logger;
+}
+
+
+TaskStatus nop(BaseTask&)
+{
+    return TaskStatus::TASK_OK;
+}
+
+
+/** a simulated kernel, so step() does not spin and only the scheduler's own
+ * work (and the nop callbacks) is measured */
+struct SimulatedKernel
+{
+    SimulatedKernel(int64_t num_periodics, int64_t num_idle)
+        : kernel(timer, get_logger(), "bench")
+    {
+        kernel.enable_simulation(timer);
+        for (int64_t i = 0; i < num_periodics; i++)
+        {
+            // a spread of periods so releases don't all coincide:
+            auto t = kernel.add_periodic(TaskType::HARD_REALTIME,
+                "periodic-" + std::to_string(i),
+                std::chrono::microseconds(1000 + 100 * i), nop);
+            t->set_cost_model(std::make_shared<FixedCost>(0ns));
+            t->enable();
+            periodics.push_back(t);
+        }
+        for (int64_t i = 0; i < num_idle; i++)
+        {
+            auto t = kernel.add_idle_task("idle-" + std::to_string(i), nop);
+            t->set_cost_model(std::make_shared<FixedCost>(0ns));
+        }
+    }
+
+    SimulatedTimer timer;
+    RealtimeKernel kernel;
+    std::vector<std::shared_ptr<PeriodicTask>> periodics;
+};
+
+
+void task_count_args(benchmark::internal::Benchmark* b)
+{
+    for (const int64_t periodics : { 1, 4, 16, 64 })
+    {
+        for (const int64_t idle : { 0, 1, 4, 16 })
+        {
+            b->Args({ periodics, idle });
+        }
+    }
+}
+
+} // namespace
+
+
+static void BM_TimerRead(benchmark::State& state)
+{
+    MonotonicTimer timer;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(timer.get_time_ns());
+    }
+}
+BENCHMARK(BM_TimerRead);
+
+
+static void BM_Step(benchmark::State& state)
+{
+    SimulatedKernel sim(state.range(0), state.range(1));
+    for (auto _ : state)
+    {
+        sim.kernel.step();
+    }
+    state.counters["periodics"] = (double) state.range(0);
+    state.counters["idle"] = (double) state.range(1);
+}
+BENCHMARK(BM_Step)->Apply(task_count_args);
+
+
+static void BM_AddRemovePeriodic(benchmark::State& state)
+{
+    SimulatedKernel sim(state.range(0), 0);
+    for (auto _ : state)
+    {
+        auto t = sim.kernel.add_periodic(
+            TaskType::SOFT_REALTIME, "added", 1ms, nop);
+        benchmark::DoNotOptimize(sim.kernel.remove(t));
+    }
+}
+BENCHMARK(BM_AddRemovePeriodic)->Arg(0)->Arg(16)->Arg(63);
+
+
+static void BM_Dispatch(benchmark::State& state)
+{
+    MonotonicTimer timer;
+    RealtimeKernel kernel(timer, get_logger(), "bench");
+    auto t = kernel.add_idle_task("dispatch", nop);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(t->run());
+    }
+}
+BENCHMARK(BM_Dispatch);
+
+
+/** the cost perf counters add to every run, state.range(0): 0 software,
+ * 1 hardware read(), 2 hardware rdpmc */
+static void BM_DispatchWithPerfCounters(benchmark::State& state)
+{
+    MonotonicTimer timer;
+    RealtimeKernel kernel(timer, get_logger(), "bench");
+    PerfConfig config;
+    config.hardware = state.range(0) > 0;
+    config.use_rdpmc = state.range(0) > 1;
+    if (kernel.enable_perf_counters(config) != error::Error::OK ||
+        (config.hardware &&
+            kernel.get_perf_counters()->get_mode() != PerfMode::HARDWARE) ||
+        kernel.get_perf_counters()->uses_rdpmc() != config.use_rdpmc)
+    {
+        state.SkipWithError("these perf counters are not available");
+        return;
+    }
+    auto t = kernel.add_idle_task("dispatch", nop);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(t->run());
+    }
+    state.counters["read_ns"] =
+        (double) kernel.get_perf_counters()->get_read_overhead().count();
+}
+BENCHMARK(BM_DispatchWithPerfCounters)->DenseRange(0, 2);
+
+
+/** A hard real-time task chasing pointers through 512 KB that an idle task
+ * (streaming through 32 MB) evicted since its last release, without (0) and
+ * with (1) its working set as prefetch range. Every iteration is one step()
+ * of a real kernel, so the prefetch runs in the kernel's spin window before
+ * the release. The time is the task's, "start_ns" the time its first 64
+ * cache lines took and "prefetch_ns" how long the prefetch before it took.
+ */
+static void BM_ColdTaskStart(benchmark::State& state)
+{
+    constexpr size_t LINE = 64;
+    constexpr size_t LINES = 512 * 1024 / LINE;
+    struct alignas(LINE) Line
+    {
+        uint32_t next;
+    };
+    std::vector<Line> working_set(LINES);
+    // one random cycle through all lines so the hardware prefetchers
+    // can't guess the next one:
+    std::vector<uint32_t> order(LINES);
+    for (uint32_t i = 0; i < LINES; i++)
+    {
+        order[i] = i;
+    }
+    uint64_t rng = 42;
+    for (size_t i = LINES - 1; i > 0; i--)
+    {
+        rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+        std::swap(order[i], order[(rng >> 33) % (i + 1)]);
+    }
+    for (size_t i = 0; i < LINES; i++)
+    {
+        working_set[order[i]].next = order[(i + 1) % LINES];
+    }
+
+    constexpr auto period = 10ms;
+    constexpr auto window = 500us;
+    MonotonicTimer timer;
+    RealtimeKernel kernel(timer, get_logger(), "bench");
+    WaitStrategy wait;
+    wait.prefetch_window = window;
+    kernel.set_wait_strategy(wait);
+
+    // in short runs, like idle work should be:
+    constexpr size_t CHUNK = 256 * 1024;
+    std::vector<char> idle_work(128 * CHUNK);
+    size_t evicted = 0;
+    auto evictor = kernel.add_idle_task("evict", [&](BaseTask&) {
+        if (evicted < idle_work.size())
+        {
+            for (size_t i = evicted; i < evicted + CHUNK; i += LINE)
+            {
+                idle_work[i]++;
+            }
+            evicted += CHUNK;
+        }
+        return TaskStatus::TASK_OK;
+    });
+    evictor->enable();
+
+    std::chrono::nanoseconds took(0);
+    std::chrono::nanoseconds start_latency(0);
+    auto t = kernel.add_periodic(
+        TaskType::HARD_REALTIME, "cold", period, [&](BaseTask&) {
+            const auto start = std::chrono::steady_clock::now();
+            uint32_t ix = order[0];
+            for (size_t i = 0; i < LINES; i++)
+            {
+                ix = working_set[ix].next;
+                if (i == 64)
+                {
+                    start_latency = std::chrono::steady_clock::now() - start;
+                }
+            }
+            benchmark::DoNotOptimize(ix);
+            took = std::chrono::steady_clock::now() - start;
+            evicted = 0;
+            return TaskStatus::TASK_OK;
+        });
+    if (state.range(0))
+    {
+        t->add_prefetch_range(
+            working_set.data(), working_set.size() * sizeof(Line));
+    }
+    // the kernel starts prefetching as the window opens, the hook runs
+    // right after the ranges (in both cases, so both stop idle work):
+    std::chrono::nanoseconds prefetch_took(0);
+    t->set_prefetch_hook([&](BaseTask& task) {
+        prefetch_took = window - task.time_left_until_deadline();
+    });
+    t->enable();
+
+    double sum = 0;
+    double sum_sq = 0;
+    double max = 0;
+    double start_sum = 0;
+    double prefetch_sum = 0;
+    for (auto _ : state)
+    {
+        kernel.step();
+        const auto ns = (double) took.count();
+        state.SetIterationTime(ns / 1e9);
+        sum += ns;
+        sum_sq += ns * ns;
+        max = std::max(max, ns);
+        start_sum += (double) start_latency.count();
+        prefetch_sum += (double) prefetch_took.count();
+    }
+    const auto n = (double) state.iterations();
+    state.counters["start_ns"] = start_sum / n;
+    state.counters["prefetch_ns"] = prefetch_sum / n;
+    state.counters["stddev_ns"] = std::sqrt(std::max(0.0, sum_sq / n - (sum / n) * (sum / n)));
+    state.counters["max_ns"] = max;
+}
+// a release per 10 ms, so a bounded number of them:
+BENCHMARK(BM_ColdTaskStart)->Arg(0)->Arg(1)->Iterations(200)->UseManualTime();
+
+
+static void BM_StatusJson(benchmark::State& state)
+{
+    SimulatedKernel sim(state.range(0), state.range(1));
+    for (int i = 0; i < 100; i++)
+    {
+        sim.kernel.step();
+    }
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(sim.kernel.get_service_status_as_json());
+    }
+}
+BENCHMARK(BM_StatusJson)->Apply(task_count_args);
+
+
+/** into a preallocated buffer, state.range(2) picks the format */
+static void BM_StatusWriter(benchmark::State& state)
+{
+    SimulatedKernel sim(state.range(0), state.range(1));
+    for (int i = 0; i < 100; i++)
+    {
+        sim.kernel.step();
+    }
+    const auto format = state.range(2) ? service::StatusFormat::BINARY
+                                       : service::StatusFormat::JSON;
+    std::vector<char> buffer(64 * 1024);
+    size_t bytes = 0;
+    for (auto _ : state)
+    {
+        service::StatusWriter w(buffer, format);
+        sim.kernel.write_status(w);
+        bytes = w.bytes_needed();
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.counters["bytes"] = (double) bytes;
+    state.SetBytesProcessed((int64_t) (bytes * state.iterations()));
+}
+BENCHMARK(BM_StatusWriter)
+    ->ArgsProduct({ { 1, 16, 64 }, { 0, 16 }, { 0, 1 } });
+
+
+/** Handing 64 KB of state from a writer to a reader in the same thread:
+ * latest_value in place without (0) and with (1) measuring ages, and a copy
+ * in and out under a mutex (2). */
+static void BM_LatestValue(benchmark::State& state)
+{
+    struct State
+    {
+        std::array<double, 8192> values;
+    };
+    MonotonicTimer timer;
+    latest_value<State> value(state.range(0) == 1 ? &timer : nullptr, "bench");
+    std::mutex mutex;
+    State shared{};
+    State local{};
+    double sum = 0;
+    for (auto _ : state)
+    {
+        if (state.range(0) < 2)
+        {
+            value.write_buffer().values[0] = sum;
+            value.publish();
+            sum += value.read().values[0] + 1;
+        }
+        else
+        {
+            local.values[0] = sum;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                shared = local;
+                benchmark::DoNotOptimize(shared);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                local = shared;
+                benchmark::DoNotOptimize(local);
+            }
+            sum += local.values[0] + 1;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_LatestValue)->DenseRange(0, 2);
+
+
+/** One release of state.range(0) tasks of the same period, each added
+ * with add_periodic() (state.range(1) == 0) or add_periodic_grouped() (1).
+ * The kernel's own list takes at most 64. */
+static void BM_SameRateRelease(benchmark::State& state)
+{
+    SimulatedTimer timer;
+    RealtimeKernel kernel(timer, get_logger(), "bench");
+    kernel.enable_simulation(timer);
+    for (int64_t i = 0; i < state.range(0); i++)
+    {
+        const auto name = "periodic-" + std::to_string(i);
+        auto t = state.range(1)
+            ? kernel.add_periodic_grouped(
+                  TaskType::HARD_REALTIME, name, 1000us, nop)
+            : kernel.add_periodic(TaskType::HARD_REALTIME, name, 1000us, nop);
+        t->set_cost_model(std::make_shared<FixedCost>(0ns));
+        t->enable();
+    }
+    for (auto _ : state)
+    {
+        // the release, then the step that waits for the next one:
+        kernel.step();
+        kernel.step();
+    }
+    state.counters["per_task_ns"] = benchmark::Counter(
+        (double) state.range(0),
+        benchmark::Counter::kIsIterationInvariantRate |
+            benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_SameRateRelease)
+    ->Args({ 16, 0 })
+    ->Args({ 16, 1 })
+    ->Args({ 64, 0 })
+    ->Args({ 64, 1 })
+    ->Args({ 256, 1 });
+
+
+/** Scheduling and cancelling a timer while state.range(0) others are
+ * pending within a second, in a TimingWheel (state.range(1) == 0) and in a
+ * std::multimap ordered by time (1). */
+static void BM_TimerScheduleCancel(benchmark::State& state)
+{
+    const auto pending = (size_t) state.range(0);
+    std::mt19937_64 rng(1);
+    std::vector<std::chrono::nanoseconds> times(4096);
+    for (auto& t : times)
+    {
+        t = std::chrono::nanoseconds(rng() % 1000000000);
+    }
+    size_t i = 0;
+
+    if (state.range(1) == 0)
+    {
+        TimingWheel wheel(TimerConfig{ pending + 1, 100us }, 0ns);
+        for (size_t n = 0; n < pending; n++)
+        {
+            (void) wheel.schedule_at(times[n % times.size()], [] {});
+        }
+        for (auto _ : state)
+        {
+            const auto h = wheel.schedule_at(times[i++ % times.size()], [] {});
+            benchmark::DoNotOptimize(wheel.cancel(h));
+        }
+    }
+    else
+    {
+        std::multimap<std::chrono::nanoseconds, std::function<void()>> queue;
+        for (size_t n = 0; n < pending; n++)
+        {
+            queue.emplace(times[n % times.size()], [] {});
+        }
+        for (auto _ : state)
+        {
+            const auto it = queue.emplace(times[i++ % times.size()], [] {});
+            queue.erase(it);
+            benchmark::DoNotOptimize(queue);
+        }
+    }
+}
+BENCHMARK(BM_TimerScheduleCancel)
+    ->ArgsProduct({ { 1000, 10000, 50000 }, { 0, 1 } });
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include <slogger/ILogger.hpp>
+#include <slogger/ITimer.hpp>
+
+#include "BaseTask.hpp"
+#include "CpuBudget.hpp"
+#include "mpsc_queue.hpp"
+
+namespace realtime
+{
+class PeriodicTask;
+
+/** Instances of these are created by the RealtimeKernel::add_aperiodic_server()
+ * method. They serve a queue of aperiodic jobs (packet arrival, signals from
+ * other processes, etc.) using a deferrable server: the server may use
+ * 'budget' of cpu time every 'period'. Jobs run in the slack before the next
+ * periodic deadline, ahead of the idle tasks, and only when they fit.
+ * Hence the server never takes more than budget/period away from the
+ * periodic tasks while a job posted to an idle server waits at most one
+ * period for its budget.
+ */
+class AperiodicServer : public BaseTask
+{
+public:
+    static constexpr auto MAX_PENDING_JOBS = 256;
+
+    AperiodicServer(time_utils::ITimer& timer, const std::string& name,
+        const std::chrono::microseconds& budget,
+        const std::chrono::microseconds& period, logging::ILogger& logger,
+        RealtimeKernel* kernel)
+        : BaseTask(timer, TaskType::SOFT_REALTIME, name, period,
+              [this](BaseTask& t) { return m_current.func(t); }, logger,
+              kernel)
+        , m_budget(timer, budget, period)
+    {
+    }
+
+    /** Queue a job for execution. May be called from any thread.
+     * returns false if the queue is full and the job was dropped.
+     */
+    bool post(const task_func_t& job);
+
+    /** Called by the kernel: run pending jobs for as long as the budget lasts
+     * and the jobs still fit before 'next' needs to run.
+     * 'next' is nullptr if there are no periodics waiting.
+     * returns true if some job ran.
+     */
+    bool serve(const PeriodicTask* next);
+
+    bool has_pending() const
+    {
+        return !m_jobs.empty();
+    }
+
+    const CpuBudget& get_budget() const
+    {
+        return m_budget;
+    }
+
+    uint64_t get_num_served() const
+    {
+        return m_num_served;
+    }
+
+    uint64_t get_num_dropped() const
+    {
+        return m_num_dropped.load(std::memory_order_relaxed);
+    }
+
+    std::chrono::nanoseconds max_response_time_ns() const
+    {
+        return m_max_response_time;
+    }
+
+    std::string get_service_status_as_json() const;
+
+    void write_status(service::StatusWriter& w) const;
+
+private:
+    struct Job
+    {
+        task_func_t func;
+        std::chrono::nanoseconds posted_at = std::chrono::nanoseconds(0);
+    };
+
+    CpuBudget m_budget;
+    mpsc_queue<Job, MAX_PENDING_JOBS> m_jobs;
+    Job m_current;
+    uint64_t m_num_served = 0;
+    std::atomic<uint64_t> m_num_dropped = 0;
+    std::chrono::nanoseconds m_max_response_time = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds m_total_response_time =
+        std::chrono::nanoseconds(0);
+};
+
+} // namespace realtime
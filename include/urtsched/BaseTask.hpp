@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 #include <cassert>
@@ -9,11 +12,22 @@
 #include <slogger/TimeUtils.hpp>
 #include <slogger/ITimer.hpp>
 
+#include "PerfCounters.hpp"
 #include "task_defs.hpp"
 
+namespace service
+{
+class StatusWriter;
+}
+
 namespace realtime
 {
 class RealtimeKernel;
+class CpuReservation;
+class CoreArena;
+class CostModel;
+class ReleaseGroup;
+struct TaskProfile;
 
 class BaseTask
 {
@@ -29,10 +43,17 @@ public:
         , m_name(name)
         , m_logger(logger)
         , m_kernel(kernel)
+        , m_id(next_task_id())
     {
         assert(kernel != nullptr);
     }
 
+    /** unique for every task of the process, see TaskRecorder */
+    uint32_t get_id() const
+    {
+        return m_id;
+    }
+
     TaskType get_task_type() const
     {
         return m_task_type;
@@ -43,39 +64,105 @@ public:
         return m_logger;
     }
 
+    time_utils::ITimer& get_timer() const
+    {
+        return m_timer;
+    }
+
+    RealtimeKernel& get_kernel() const
+    {
+        return *m_kernel;
+    }
+
+    /** the core-local memory of the kernel this task runs on.
+     * Its scratch allocator is reset before every run of a task.
+     */
+    CoreArena& get_arena() const;
+
     std::string get_service_status_as_json() const;
 
+    void write_status(service::StatusWriter& w) const;
+
     const std::string& get_name() const
     {
         return m_name;
     }
 
-    void run();
+    /** runs the task's callback once.
+     * returns how long the callback took.
+     */
+    std::chrono::nanoseconds run();
 
     /** called to wait for deadline to elapse because there's no more idle tasks
      * that we can squeeze into the time until this task needs to run.
      * We only need to do this for hard-realtime tasks as soft ones can run when
      * we have time for them afterwards.
+     * Returns how long we waited.
      */
-    void wait_for_deadline() const
+    std::chrono::nanoseconds wait_for_deadline() const
     {
         assert(get_task_type() == TaskType::HARD_REALTIME);
-        while (!m_timeout.elapsed())
+        auto left = m_timeout.time_left();
+        const auto waited = std::max(left, std::chrono::nanoseconds(0));
+        while (left > std::chrono::nanoseconds(0))
         {
-            ;
+            left = m_timeout.time_left();
         }
+        return waited;
     }
 
-    void run_elapsed()
+    /** runs the task for the release that just elapsed and counts a
+     * deadline miss if it did not complete before its next release.
+     */
+    void run_elapsed();
+
+    /** this task if it is a ReleaseGroup, else nullptr */
+    ReleaseGroup* as_release_group() const
     {
-        if (get_task_type() == TaskType::HARD_REALTIME)
-        {
-            assert(m_timeout.elapsed());
-        }
+        return m_release_group;
+    }
 
+    /** make the task due immediately */
+    void release_now()
+    {
+        m_timeout.reset(std::chrono::microseconds(0));
+    }
+
+    /** skip this release without running the task, e.g. because its
+     * reservation has no budget left.
+     */
+    void skip_release()
+    {
         m_timeout.reset(m_interval);
+        m_gate_open = false;
+    }
 
-        run();
+    /** A gated task is not released by its period but by open_gate(),
+     * once for every open_gate(), see TaskChain. Its period is then
+     * only the deadline of each release.
+     */
+    void set_release_gated(bool gated)
+    {
+        m_release_gated = gated;
+        m_gate_open = false;
+    }
+
+    bool is_release_gated() const
+    {
+        return m_release_gated;
+    }
+
+    /** release a gated task now */
+    void open_gate()
+    {
+        m_gate_open = true;
+        release_now();
+    }
+
+    /** gated and not released, the kernel doesn't consider it */
+    bool is_held() const
+    {
+        return m_release_gated && !m_gate_open;
     }
 
     bool have_time_left_before_deadline() const
@@ -92,23 +179,23 @@ public:
     /** if you need the most accuracy */
     std::chrono::nanoseconds max_time_taken_ns() const
     {
-        return m_max_time_taken;
+        return std::max(m_max_time_taken, m_seeded_max_time_taken);
     }
 
     /** if you need the most accuracy */
     std::chrono::nanoseconds warmup_max_time_taken_ns() const
     {
-        return m_warmup_max_time_taken;
+        return std::max(m_warmup_max_time_taken, m_seeded_warmup_max_time_taken);
     }
 
     std::chrono::microseconds max_time_taken_us() const
     {
-        return std::chrono::duration_cast<std::chrono::microseconds>( m_max_time_taken );
+        return std::chrono::duration_cast<std::chrono::microseconds>( max_time_taken_ns() );
     }
 
     std::chrono::microseconds warmup_max_time_taken_us() const
     {
-        return std::chrono::duration_cast<std::chrono::microseconds>(  m_warmup_max_time_taken );
+        return std::chrono::duration_cast<std::chrono::microseconds>(  warmup_max_time_taken_ns() );
     }
 
     std::chrono::nanoseconds average_time_taken_ns() const
@@ -117,10 +204,53 @@ public:
            average_time_taken_us());
     }
 
+    /** number of releases that completed after the next release was due */
+    uint64_t get_num_deadline_misses() const
+    {
+        return m_num_deadline_misses;
+    }
+
+    /** how long after its release the last run started */
+    std::chrono::nanoseconds get_last_release_lateness() const
+    {
+        return m_last_release_lateness;
+    }
+
+    /** when the last run was due, see get_last_release_lateness() */
+    std::chrono::nanoseconds get_last_release() const
+    {
+        return m_last_release;
+    }
+
+    std::chrono::nanoseconds get_max_release_lateness() const
+    {
+        return m_max_release_lateness;
+    }
+
+    uint64_t get_num_calls() const
+    {
+        return m_num_calls;
+    }
+
+    std::chrono::nanoseconds get_total_time_taken() const
+    {
+        return m_total_time_taken_us;
+    }
+
+    static constexpr size_t EXEC_HISTOGRAM_BUCKETS = 32;
+
+    /** bucket b counts the runs that took [2^(b-1), 2^b) ns, the last
+     * bucket counts all longer ones */
+    const std::array<uint64_t, EXEC_HISTOGRAM_BUCKETS>& get_exec_histogram() const
+    {
+        return m_exec_histogram;
+    }
+
     std::chrono::microseconds average_time_taken_us() const
     {
-        return std::chrono::microseconds(
-            (int64_t) ((double) m_total_time_taken_us.count() / m_num_calls));
+        return std::chrono::microseconds((int64_t) ((double) (
+            m_total_time_taken_us + m_seeded_time_taken).count() /
+            (m_num_calls + m_seeded_calls)));
     }
 
     void set_period(const std::chrono::microseconds& t)
@@ -128,6 +258,11 @@ public:
         m_interval = t;
     }
 
+    std::chrono::microseconds get_period() const
+    {
+        return m_interval;
+    }
+
     void enable()
     {
         m_enabled = true;
@@ -143,7 +278,94 @@ public:
         return m_enabled;
     }
 
+    /** charge the time this task runs to 'r' (may be nullptr) */
+    void set_reservation(CpuReservation* r)
+    {
+        m_reservation = r;
+    }
+
+    CpuReservation* get_reservation() const
+    {
+        return m_reservation;
+    }
+
+    /** how long a run takes when the kernel is simulated,
+     * see RealtimeKernel::enable_simulation() */
+    void set_cost_model(const std::shared_ptr<CostModel>& model)
+    {
+        m_cost_model = model;
+    }
+
+    const std::shared_ptr<CostModel>& get_cost_model() const
+    {
+        return m_cost_model;
+    }
+
+    /** Start from what an earlier run of this task learned, see
+     * TaskProfileStore: the maximum and average execution times include
+     * that history from the first run on (and so does the status), and
+     * there's no warm-up. get_num_calls(), get_total_time_taken() and the
+     * histogram only count this process. The history counts as at most
+     * MAX_SEEDED_CALLS runs so today's behaviour soon dominates the
+     * average, and its maximum is dropped after MAX_SEEDED_CALLS runs of
+     * our own, so an old spike isn't saved again and again. Not while the
+     * task runs.
+     */
+    void seed_profile(const TaskProfile& profile);
+
+    bool is_seeded() const
+    {
+        return m_seed != nullptr;
+    }
+
+    static constexpr size_t MAX_PREFETCH_RANGES = 4;
+
+    /** Memory to bring into the caches (and TLB) right before each release
+     * of this hard real-time task, see WaitStrategy::prefetch_window.
+     * Returns false if there are MAX_PREFETCH_RANGES already.
+     */
+    bool add_prefetch_range(const void* data, size_t bytes);
+
+    /** Called right before each release of this hard real-time task to
+     * warm up its working set, e.g. by walking its data structures. It
+     * must be short: it runs in the window before the release.
+     */
+    void set_prefetch_hook(const std::function<void(BaseTask&)>& hook)
+    {
+        m_prefetch_hook = hook;
+    }
+
+    /** Called after each run with the time the run completed, e.g. to
+     * release successors, see TaskChain. */
+    void set_completion_hook(
+        const std::function<void(BaseTask&, std::chrono::nanoseconds)>& hook)
+    {
+        m_completion_hook = hook;
+    }
+
+    bool has_prefetch() const
+    {
+        return m_num_prefetch_ranges > 0 || m_prefetch_hook;
+    }
+
+    /** touch the prefetch ranges and call the hook */
+    void prefetch();
+
+    /** what this task has learned, including a seeded profile */
+    void get_profile(TaskProfile& out) const;
+
+    static constexpr uint64_t MAX_SEEDED_CALLS = 1000;
+
+    /** what the kernel's perf counters counted during this task's runs,
+     * see RealtimeKernel::enable_perf_counters() */
+    const PerfTaskStats& get_perf_stats() const
+    {
+        return m_perf_stats;
+    }
+
 private:
+    friend class ReleaseGroup;
+
     time_utils::ITimer& m_timer;
     TaskType m_task_type;
     std::chrono::microseconds m_interval = std::chrono::microseconds(0);
@@ -155,12 +377,44 @@ private:
 
     uint64_t m_num_calls = 0;
     uint64_t m_num_task_ok_calls = 0;
+    uint64_t m_num_deadline_misses = 0;
+    std::chrono::nanoseconds m_last_release_lateness =
+        std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds m_max_release_lateness =
+        std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds m_last_release = std::chrono::nanoseconds(0);
+    std::array<uint64_t, EXEC_HISTOGRAM_BUCKETS> m_exec_histogram{};
+    PerfTaskStats m_perf_stats;
     task_func_t m_task_func;
     time_utils::Timeout m_timeout;
     bool m_enabled = false;
+    bool m_release_gated = false;
+    bool m_gate_open = false;
     std::string m_name;
     logging::ILogger& m_logger;
     RealtimeKernel* m_kernel = nullptr;
+    CpuReservation* m_reservation = nullptr;
+    std::shared_ptr<CostModel> m_cost_model;
+    std::array<std::pair<const char*, size_t>, MAX_PREFETCH_RANGES>
+        m_prefetch_ranges{};
+    size_t m_num_prefetch_ranges = 0;
+    std::function<void(BaseTask&)> m_prefetch_hook;
+    std::function<void(BaseTask&, std::chrono::nanoseconds)> m_completion_hook;
+    // the (scaled down) history from seed_profile():
+    std::shared_ptr<const TaskProfile> m_seed;
+    uint64_t m_seeded_calls = 0;
+    std::chrono::microseconds m_seeded_time_taken = std::chrono::microseconds(0);
+    // until we've run MAX_SEEDED_CALLS times ourselves:
+    std::chrono::nanoseconds m_seeded_max_time_taken = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds m_seeded_warmup_max_time_taken =
+        std::chrono::nanoseconds(0);
+    ReleaseGroup* m_release_group = nullptr;
+    const uint32_t m_id;
+
+    static uint32_t next_task_id();
+
+    /** a run for the release m_last_release_lateness ago took 'took' */
+    void count_deadline_miss_if_late(std::chrono::nanoseconds took);
 };
 
 } // namespace realtime
\ No newline at end of file
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#include <slogger/ILogger.hpp>
+
+#include "RtMemory.hpp"
+
+namespace realtime
+{
+
+/** Core-local memory for tasks, preallocated so tasks never have to call
+ * new/malloc (and contend on glibc's arenas) from a real-time core:
+ * - a bump allocator for scratch memory, reset before every task run
+ * - fixed size-class pools for objects that live longer than one run
+ * Not thread-safe: only to be used from the kernel's own thread.
+ */
+class CoreArena
+{
+public:
+    static constexpr size_t MIN_BLOCK_SIZE = 32;
+    static constexpr size_t NUM_POOLS = 8; // 32 .. 4096 bytes
+
+    CoreArena() = default;
+    CoreArena(const ArenaConfig& config, logging::ILogger& logger);
+
+    CoreArena(const CoreArena&) = delete;
+    CoreArena& operator=(const CoreArena&) = delete;
+    CoreArena(CoreArena&&) = delete;
+    CoreArena& operator=(CoreArena&&) = delete;
+
+    /** returns nullptr if the scratch memory is exhausted */
+    void* allocate_scratch(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    void reset_scratch()
+    {
+        m_scratch_used = 0;
+    }
+
+    /** returns nullptr if there is no free block large enough */
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    /** 'bytes' and 'alignment' must be the ones passed to allocate() */
+    void deallocate(void* p, size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    /** scratch memory as a std::pmr resource, deallocation is a no-op */
+    std::pmr::memory_resource& scratch_resource()
+    {
+        return m_scratch_resource;
+    }
+
+    /** the size-class pools as a std::pmr resource */
+    std::pmr::memory_resource& pool_resource()
+    {
+        return m_pool_resource;
+    }
+
+    size_t scratch_capacity() const
+    {
+        return m_scratch_size;
+    }
+
+    size_t scratch_high_water_mark() const
+    {
+        return m_scratch_high_water_mark;
+    }
+
+    uint64_t get_num_failed_allocations() const
+    {
+        return m_num_failed_allocations;
+    }
+
+    size_t pool_blocks_in_use(size_t pool) const
+    {
+        return m_pools[pool].in_use;
+    }
+
+private:
+    class ScratchResource : public std::pmr::memory_resource
+    {
+    public:
+        explicit ScratchResource(CoreArena& arena)
+            : m_arena(arena)
+        {
+        }
+
+    private:
+        CoreArena& m_arena;
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void*, size_t, size_t) override
+        {
+        }
+        bool do_is_equal(
+            const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    class PoolResource : public std::pmr::memory_resource
+    {
+    public:
+        explicit PoolResource(CoreArena& arena)
+            : m_arena(arena)
+        {
+        }
+
+    private:
+        CoreArena& m_arena;
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override
+        {
+            m_arena.deallocate(p, bytes, alignment);
+        }
+        bool do_is_equal(
+            const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct Pool
+    {
+        FreeBlock* free_list = nullptr;
+        size_t in_use = 0;
+    };
+
+    RtMemoryRegion m_memory;
+
+    char* m_scratch = nullptr;
+    size_t m_scratch_size = 0;
+    size_t m_scratch_used = 0;
+    size_t m_scratch_high_water_mark = 0;
+
+    std::array<Pool, NUM_POOLS> m_pools;
+    uint64_t m_num_failed_allocations = 0;
+
+    ScratchResource m_scratch_resource{ *this };
+    PoolResource m_pool_resource{ *this };
+
+    static size_t pool_index(size_t bytes, size_t alignment);
+};
+
+} // namespace realtime
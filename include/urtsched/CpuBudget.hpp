@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+#include <slogger/ITimer.hpp>
+#include <slogger/TimeUtils.hpp>
+
+namespace realtime
+{
+
+/** An amount of cpu time that is handed out again every period.
+ * Time used beyond the budget is carried over as debt into the next period,
+ * so in the long run the consumer never gets more than budget/period of the
+ * core.
+ */
+class CpuBudget
+{
+public:
+    CpuBudget(time_utils::ITimer& timer, const std::chrono::microseconds& budget,
+        const std::chrono::microseconds& period)
+        : m_budget(budget)
+        , m_period(period)
+        , m_remaining(budget)
+        , m_replenish_timeout(timer, period)
+    {
+    }
+
+    void replenish_if_due()
+    {
+        if (!m_replenish_timeout.elapsed())
+        {
+            return;
+        }
+        m_replenish_timeout.reset(m_period);
+
+        m_used_last_period = m_budget - m_remaining;
+        if (m_remaining < std::chrono::nanoseconds(0))
+        {
+            m_num_overruns++;
+            m_total_overrun -= m_remaining;
+        }
+        m_remaining = std::min(m_remaining, std::chrono::nanoseconds(0)) +
+            std::chrono::nanoseconds(m_budget);
+        m_num_periods++;
+    }
+
+    bool has_budget() const
+    {
+        return m_remaining > std::chrono::nanoseconds(0);
+    }
+
+    void charge(const std::chrono::nanoseconds& took)
+    {
+        m_remaining -= took;
+        m_total_used += took;
+    }
+
+    std::chrono::microseconds get_budget() const
+    {
+        return m_budget;
+    }
+
+    std::chrono::microseconds get_period() const
+    {
+        return m_period;
+    }
+
+    std::chrono::nanoseconds get_remaining() const
+    {
+        return m_remaining;
+    }
+
+    std::chrono::nanoseconds get_used_last_period() const
+    {
+        return m_used_last_period;
+    }
+
+    std::chrono::nanoseconds get_total_used() const
+    {
+        return m_total_used;
+    }
+
+    uint64_t get_num_periods() const
+    {
+        return m_num_periods;
+    }
+
+    /** number of periods that ended with more time used than budgeted */
+    uint64_t get_num_overruns() const
+    {
+        return m_num_overruns;
+    }
+
+    std::chrono::nanoseconds get_total_overrun() const
+    {
+        return m_total_overrun;
+    }
+
+private:
+    const std::chrono::microseconds m_budget;
+    const std::chrono::microseconds m_period;
+    std::chrono::nanoseconds m_remaining;
+    std::chrono::nanoseconds m_used_last_period = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds m_total_used = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds m_total_overrun = std::chrono::nanoseconds(0);
+    uint64_t m_num_periods = 0;
+    uint64_t m_num_overruns = 0;
+    time_utils::Timeout m_replenish_timeout;
+};
+
+} // namespace realtime
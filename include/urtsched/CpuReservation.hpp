@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <slogger/ITimer.hpp>
+
+#include "CpuBudget.hpp"
+
+namespace service
+{
+class StatusWriter;
+}
+
+namespace realtime
+{
+
+/** Instances of these are created by the RealtimeKernel::add_reservation()
+ * method. A reservation is a share of the core (budget per period) for a
+ * group of tasks, typically all tasks of one service::Service.
+ * Idle tasks, soft-realtime periodics and aperiodic servers of an exhausted
+ * reservation are skipped until its budget is replenished.
+ * Hard-realtime tasks are never skipped but their time is still charged,
+ * so an overrunning service shows up in its own accounting instead of
+ * silently starving its neighbours.
+ */
+class CpuReservation
+{
+public:
+    CpuReservation(time_utils::ITimer& timer, const std::string& name,
+        const std::chrono::microseconds& budget,
+        const std::chrono::microseconds& period)
+        : m_name(name)
+        , m_budget(timer, budget, period)
+    {
+    }
+
+    const std::string& get_name() const
+    {
+        return m_name;
+    }
+
+    /** start a new period if it's time, the kernel calls it once per
+     * step() so admit() needn't read the timer */
+    void replenish_if_due()
+    {
+        m_budget.replenish_if_due();
+    }
+
+    /** returns true if tasks of this reservation may run now */
+    bool admit()
+    {
+        if (m_budget.has_budget())
+        {
+            return true;
+        }
+        // the kernel asks on every pass of its slack loop, count periods:
+        const auto period = m_budget.get_num_periods();
+        if (period != m_throttled_in_period)
+        {
+            m_throttled_in_period = period;
+            m_num_throttled++;
+        }
+        return false;
+    }
+
+    void charge(const std::chrono::nanoseconds& took)
+    {
+        m_budget.charge(took);
+    }
+
+    /** a task of this reservation took longer than allowed */
+    void count_task_overrun()
+    {
+        m_num_task_overruns++;
+    }
+
+    const CpuBudget& get_budget() const
+    {
+        return m_budget;
+    }
+
+    /** the periods in which tasks were held back */
+    uint64_t get_num_throttled() const
+    {
+        return m_num_throttled;
+    }
+
+    uint64_t get_num_task_overruns() const
+    {
+        return m_num_task_overruns;
+    }
+
+    std::string get_service_status_as_json() const;
+
+    void write_status(service::StatusWriter& w) const;
+
+private:
+    const std::string m_name;
+    CpuBudget m_budget;
+    uint64_t m_num_throttled = 0;
+    uint64_t m_throttled_in_period = UINT64_MAX;
+    uint64_t m_num_task_overruns = 0;
+};
+
+} // namespace realtime
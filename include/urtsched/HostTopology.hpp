@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <slogger/ILogger.hpp>
+
+namespace realtime
+{
+
+/** parses a linux cpu or node list like "0-3,8,10-11" */
+std::vector<uint32_t> parse_cpu_list(const std::string& list);
+
+/** the inverse of parse_cpu_list(): {0,1,2,3,8} -> "0-3,8" */
+std::string format_cpu_list(std::vector<uint32_t> cpus);
+
+/** parses a hex cpu mask as found in /proc/irq/N/smp_affinity,
+ * e.g. "00000000,0000000f" -> {0,1,2,3} */
+std::vector<uint32_t> parse_cpu_mask(const std::string& mask);
+
+/** the inverse of parse_cpu_mask(), using at least 'min_groups' comma
+ * separated groups of 32 bits */
+std::string format_cpu_mask(const std::vector<uint32_t>& cpus, size_t min_groups = 1);
+
+/** reads a whole (sysfs/procfs) file, without the trailing newline.
+ * returns std::nullopt if it can't be read */
+std::optional<std::string> read_file(const std::filesystem::path& path);
+
+struct NumaNode
+{
+    uint32_t id = 0;
+    std::vector<uint32_t> cpus;
+};
+
+/** The NUMA nodes of the host as found in /sys/devices/system/node.
+ * 'root' is prepended to all paths so a fake sysfs can be used for testing.
+ */
+class NumaTopology
+{
+public:
+    static NumaTopology discover(const std::filesystem::path& root = "/");
+
+    const std::vector<NumaNode>& get_nodes() const
+    {
+        return m_nodes;
+    }
+
+    std::optional<uint32_t> node_of_cpu(uint32_t cpu) const;
+
+    /** the (sorted, unique) nodes the given cpus are on */
+    std::vector<uint32_t> nodes_of_cpus(const std::vector<uint32_t>& cpus) const;
+
+private:
+    std::vector<NumaNode> m_nodes;
+};
+
+/** bind all future memory allocations of the calling thread to 'node'.
+ * returns false on failure.
+ */
+bool bind_memory_to_node(uint32_t node, logging::ILogger& logger);
+
+} // namespace realtime
@@ -4,6 +4,8 @@
 
 #include <slogger/Error.hpp>
 
+#include <urtsched/StatusWriter.hpp>
+
 namespace service
 {
     class IService
@@ -11,10 +13,22 @@ namespace service
     public:
         virtual std::string get_service_status_as_json() const { return ""; }
 
+        /** Serialize the status as one value (usually an object). Services
+         * that only implement get_service_status_as_json() are written
+         * as raw json; override this to avoid its allocations.
+         */
+        virtual void write_status(StatusWriter& w) const
+        {
+            if (const auto s = get_service_status_as_json(); !s.empty())
+            {
+                w.raw_json(s);
+            }
+        }
+
         [[nodiscard]]
         virtual error::Error init() = 0;
 
         [[nodiscard]]
         virtual error::Error finish() = 0;
     };
-}
\ No newline at end of file
+}
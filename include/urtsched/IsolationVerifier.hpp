@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <slogger/ILogger.hpp>
+
+namespace realtime
+{
+
+enum class CheckStatus
+{
+    OK,
+    WARNING,
+    FAILED
+};
+
+struct IsolationCheck
+{
+    std::string name;
+    CheckStatus status = CheckStatus::OK;
+    std::string detail;
+};
+
+struct IsolationReport
+{
+    std::vector<IsolationCheck> checks;
+
+    /** true if none of the checks failed */
+    bool ok() const;
+
+    std::string to_json() const;
+};
+
+struct IsolationConfig
+{
+    bool verify = true;
+
+    /** rewrite /proc/irq/N/smp_affinity so no irq is routed to a
+     * reserved core while MultiCoreRealtimeKernel::run() runs */
+    bool steer_irqs = false;
+};
+
+/** Checks whether the host is set up to keep other work off the reserved
+ * cores: kernel command line (isolcpus/nohz_full/rcu_nocbs), irq affinity,
+ * real-time throttling, cpu frequency governors and thread affinity.
+ * All paths are relative to 'root' so a fake sysfs/procfs can be used for
+ * testing.
+ */
+class IsolationVerifier
+{
+public:
+    IsolationVerifier(const std::filesystem::path& root,
+        const std::vector<uint32_t>& reserved_cores, logging::ILogger& logger)
+        : m_root(root)
+        , m_reserved_cores(reserved_cores)
+        , m_logger(logger)
+    {
+    }
+
+    /** runs all checks except the thread affinity one */
+    IsolationReport verify() const;
+
+    void check_kernel_cmdline(IsolationReport& report) const;
+    void check_irq_affinity(IsolationReport& report) const;
+    void check_rt_throttling(IsolationReport& report) const;
+    void check_cpu_governors(IsolationReport& report) const;
+
+    /** checks that the calling thread may only run on 'expected_cores' */
+    static void check_thread_affinity(IsolationReport& report,
+        const std::string& name, const std::vector<uint32_t>& expected_cores);
+
+    /** removes the reserved cores from the affinity of every irq.
+     * returns the number of irqs that were steered away, their previous
+     * masks are added to 'previous' if given. See IrqSteering.
+     */
+    size_t steer_irqs_away(
+        std::vector<std::pair<std::filesystem::path, std::string>>* previous =
+            nullptr) const;
+
+    /** logs the checks that are not ok */
+    void log(const IsolationReport& report) const;
+
+    logging::ILogger& get_logger() const
+    {
+        return m_logger;
+    }
+
+private:
+    const std::filesystem::path m_root;
+    const std::vector<uint32_t> m_reserved_cores;
+    logging::ILogger& m_logger;
+
+    /** the reserved cores missing from 'cpus' */
+    std::vector<uint32_t> missing_from(const std::vector<uint32_t>& cpus) const;
+
+    /** the irqs whose affinity includes a reserved core */
+    std::vector<std::string> irqs_on_reserved_cores() const;
+};
+
+
+
+/** Keeps the irqs off the reserved cores for as long as it exists (or until
+ * release()) and puts their previous affinity back afterwards, so the
+ * host's irq routing is only changed while the kernels run.
+ */
+class IrqSteering
+{
+public:
+    explicit IrqSteering(const IsolationVerifier& verifier);
+
+    ~IrqSteering()
+    {
+        release();
+    }
+
+    IrqSteering(const IrqSteering&) = delete;
+    IrqSteering& operator=(const IrqSteering&) = delete;
+
+    size_t get_num_steered() const
+    {
+        return m_saved.size();
+    }
+
+    void release();
+
+private:
+    logging::ILogger& m_logger;
+
+    // the smp_affinity files we changed and their previous masks
+    std::vector<std::pair<std::filesystem::path, std::string>> m_saved;
+
+    logging::ILogger& get_logger() const
+    {
+        return m_logger;
+    }
+};
+
+} // namespace realtime
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <time.h>
+
+#include <chrono>
+
+#include <slogger/ITimer.hpp>
+
+namespace realtime
+{
+
+/** reads CLOCK_MONOTONIC, which is not affected by changes of the
+ * wall-clock time */
+class MonotonicTimer : public time_utils::ITimer
+{
+public:
+    std::chrono::nanoseconds get_time_ns() override
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return std::chrono::seconds(ts.tv_sec) +
+            std::chrono::nanoseconds(ts.tv_nsec);
+    }
+};
+
+} // namespace realtime
@@ -1,14 +1,23 @@
 #pragma once
 
+#include <filesystem>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <vector>
 
 #include <slogger/ILogger.hpp>
 #include <slogger/TimeUtils.hpp>
 #include <slogger/ITimer.hpp>
 
+#include <urtsched/HostTopology.hpp>
+#include <urtsched/IsolationVerifier.hpp>
+#include <urtsched/PowerManagement.hpp>
 #include <urtsched/RealtimeKernel.hpp>
 #include <urtsched/ServiceBus.hpp>
+#include <urtsched/StatsSegment.hpp>
+#include <urtsched/Watchdog.hpp>
 
 namespace realtime
 {
@@ -47,13 +56,100 @@ public:
         return k;
     }
 
-    void run(const std::chrono::milliseconds& max_runtime);
+    /** Runs every kernel on its own thread, kernel 0 on the calling thread.
+     * Each thread is pinned and scheduled as the kernel's SchedulingConfig
+     * says, the calling thread's settings are restored afterwards.
+     * @param max_runtime if 0 run until request_stop() is called
+     * returns FAILED if reserving the cores, locking the memory or setting
+     * up a thread's scheduling failed, the kernels run regardless.
+     */
+    [[nodiscard]] error::Error run(const std::chrono::milliseconds& max_runtime);
+
+    /** Let every core finish its current step and return from run().
+     * May be called from any thread.
+     */
+    void request_stop()
+    {
+        for (auto& k : m_kernels)
+        {
+            k->request_stop();
+        }
+    }
+
+    /** Opt-in: lock all memory and prefault every core's stack and state
+     * before the real-time loops start. Page fault counts of every core are
+     * logged when run() is done. run() returns FAILED if the memory could
+     * not be locked.
+     */
+    void set_memory_hardening(const MemoryHardeningConfig& config)
+    {
+        m_memory_config = config;
+    }
+
+    /** Opt-in: count hardware (or software) perf events around every task
+     * run on every core, see RealtimeKernel::enable_perf_counters(). A core
+     * whose counters can't be opened runs without.
+     */
+    void set_perf_counters(const PerfConfig& config)
+    {
+        m_perf_config = config;
+    }
+
+    /** Opt-in: limit how deep the cpus may sleep while run() is active,
+     * the host's settings are restored when it returns. Combine with
+     * RealtimeKernel::set_wait_strategy() to trade power for jitter.
+     */
+    void set_power_latency(const PowerLatencyConfig& config)
+    {
+        m_power_config = config;
+    }
+
+    /** Publish every core's counters in the POSIX shared memory segment
+     * 'name' (e.g. "/urtsched") every 'interval', for urtsched-top and other
+     * monitors. The segment exists from run() until we're destroyed.
+     */
+    void set_stats_segment(const std::string& name,
+        std::chrono::milliseconds interval = std::chrono::milliseconds(10))
+    {
+        m_stats_name = name;
+        m_stats_interval = interval;
+    }
+
+    /** monitor the cores from a separate thread while run() is active */
+    void set_watchdog(const WatchdogConfig& config)
+    {
+        m_watchdog_config = config;
+    }
 
     logging::ILogger& get_logger() const
     {
         return m_logger;
     }
 
+    /** the cores the kernels run on: one per kernel, from
+     * first_reserved_core onwards */
+    std::vector<uint32_t> get_reserved_cores() const;
+
+    /** configure the host checks done at the start of run() */
+    void set_isolation_config(const IsolationConfig& config)
+    {
+        m_isolation_config = config;
+    }
+
+    /** the result of the host checks done by the last run() */
+    const IsolationReport& get_isolation_report() const
+    {
+        return m_isolation_report;
+    }
+
+    /** sysfs/procfs/cgroup paths are looked up relative to 'root'.
+     * Only useful for testing against a fake root.
+     */
+    void set_host_root(const std::filesystem::path& root)
+    {
+        m_host_root = root;
+    }
+
 private:
     time_utils::ITimer& m_timer;
     service::ServiceBus& m_bus;
@@ -64,7 +160,44 @@ private:
     // one per core:
     std::vector<std::shared_ptr<RealtimeKernel>> m_kernels;
 
-    void reserve_cores_using_cgroups();
+    std::optional<WatchdogConfig> m_watchdog_config;
+    std::optional<MemoryHardeningConfig> m_memory_config;
+    std::optional<PowerLatencyConfig> m_power_config;
+    std::optional<PerfConfig> m_perf_config;
+    std::optional<std::string> m_stats_name;
+    std::chrono::milliseconds m_stats_interval = std::chrono::milliseconds(10);
+    std::unique_ptr<StatsSegment> m_stats;
+
+    void log_memory_reports();
+    void create_stats_segment();
+
+    std::filesystem::path m_host_root = "/";
+    IsolationConfig m_isolation_config;
+    IsolationReport m_isolation_report;
+    // guards m_isolation_report and m_startup_result:
+    std::mutex m_startup_mutex;
+    error::Error m_startup_result = error::Error::OK;
+    NumaTopology m_numa;
+
+    uint32_t core_of(size_t kernel_index) const
+    {
+        return m_kernels[kernel_index]->get_scheduling_config().core.value_or(
+            m_first_reserved_core + (uint32_t) kernel_index);
+    }
+
+    /** the numa nodes of the reserved cores as a cgroup mems list */
+    std::string get_reserved_mems() const;
+
+    error::Error reserve_cores_using_cgroups();
+    error::Error reserve_cores_using_cgroups_v1();
+    error::Error reserve_cores_using_cgroups_v2();
+    void bind_memory_to_local_node(size_t kernel_index);
+    void verify_isolation();
+    void verify_thread_affinity(size_t kernel_index);
+
+    /** pin and schedule the calling thread for kernel 'kernel_index' and
+     * prepare its memory */
+    void setup_kernel_thread(size_t kernel_index);
 };
 
 } // namespace realtime
\ No newline at end of file
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <slogger/ILogger.hpp>
+
+struct perf_event_mmap_page;
+
+namespace realtime
+{
+
+enum class PerfEvent : uint8_t
+{
+    CYCLES,
+    INSTRUCTIONS,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    CONTEXT_SWITCHES,
+    TASK_CLOCK, // ns on the cpu
+    PAGE_FAULTS
+};
+
+constexpr size_t NUM_PERF_EVENTS = 7;
+
+const char* to_string(PerfEvent e);
+
+
+enum class PerfMode
+{
+    OFF,
+    /** cycles, instructions, LLC misses, branch misses (+ context switches) */
+    HARDWARE,
+    /** no PMU (e.g. in a VM) or not allowed:
+     * task clock, context switches and page faults */
+    SOFTWARE
+};
+
+const char* to_string(PerfMode m);
+
+
+struct PerfConfig
+{
+    /** try the hardware counters first, else only the software ones */
+    bool hardware = true;
+
+    /** Read the hardware counters with rdpmc from user space when the
+     * kernel allows it (x86, /sys/bus/event_source/devices/cpu/rdpmc).
+     * That costs no syscall per run but context switches, a software
+     * event, are then not counted.
+     */
+    bool use_rdpmc = true;
+};
+
+
+/** counter values indexed by PerfEvent, events not counted stay 0 */
+struct PerfSample
+{
+    std::array<uint64_t, NUM_PERF_EVENTS> values{};
+
+    uint64_t operator[](PerfEvent e) const
+    {
+        return values[(size_t) e];
+    }
+};
+
+
+/** what a task's runs counted, see BaseTask::get_perf_stats() */
+struct PerfTaskStats
+{
+    uint64_t samples = 0;
+    PerfSample total;
+    PerfSample max;
+    PerfSample last;
+
+    void add(const PerfSample& before, const PerfSample& after)
+    {
+        samples++;
+        for (size_t i = 0; i < NUM_PERF_EVENTS; i++)
+        {
+            const auto d = after.values[i] - before.values[i];
+            last.values[i] = d;
+            total.values[i] += d;
+            max.values[i] = d > max.values[i] ? d : max.values[i];
+        }
+    }
+
+    uint64_t average(PerfEvent e) const
+    {
+        return samples ? total[e] / samples : 0;
+    }
+};
+
+
+/** A perf_event_open() group counting the calling thread, see
+ * RealtimeKernel::enable_perf_counters(). All counters of the group are
+ * scheduled onto the PMU together so their values are comparable.
+ */
+class PerfCounterGroup
+{
+public:
+    static constexpr size_t MAX_COUNTERS = 5;
+
+    PerfCounterGroup() = default;
+    ~PerfCounterGroup()
+    {
+        close();
+    }
+
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    /** Opens the counters for the calling thread, falling back to the
+     * software counters. Returns false if not even those could be opened,
+     * e.g. because of /proc/sys/kernel/perf_event_paranoid.
+     */
+    bool open(const PerfConfig& config, logging::ILogger& logger);
+
+    void close();
+
+    PerfMode get_mode() const
+    {
+        return m_mode;
+    }
+
+    bool uses_rdpmc() const
+    {
+        return m_rdpmc;
+    }
+
+    bool has(PerfEvent e) const;
+
+    /** the current values of the counters, to be subtracted from a later
+     * read() */
+    void read(PerfSample& out) const;
+
+    /** what one read() costs, measured by open() */
+    std::chrono::nanoseconds get_read_overhead() const
+    {
+        return m_read_overhead;
+    }
+
+private:
+    struct Counter
+    {
+        PerfEvent event = PerfEvent::CYCLES;
+        int fd = -1;
+        perf_event_mmap_page* page = nullptr;
+    };
+
+    std::array<Counter, MAX_COUNTERS> m_counters{};
+    size_t m_num_counters = 0;
+    PerfMode m_mode = PerfMode::OFF;
+    bool m_rdpmc = false;
+    std::chrono::nanoseconds m_read_overhead = std::chrono::nanoseconds(0);
+
+    bool add(PerfEvent e);
+    bool map_for_rdpmc();
+    void measure_read_overhead();
+};
+
+} // namespace realtime
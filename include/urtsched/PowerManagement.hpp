@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <slogger/ILogger.hpp>
+
+namespace realtime
+{
+
+/** Limits on how deep the cpus may sleep (C-states) while the kernels run.
+ * The deeper the sleep, the longer a core takes to wake up for the next
+ * release. See MultiCoreRealtimeKernel::set_power_latency().
+ */
+struct PowerLatencyConfig
+{
+    /** hold a PM QoS request on /dev/cpu_dma_latency: applies to all cpus */
+    std::optional<std::chrono::microseconds> cpu_dma_latency;
+
+    /** write the reserved cores' pm_qos_resume_latency_us in sysfs: applies
+     * to the reserved cores only. 0us means the core may not sleep at all.
+     */
+    std::optional<std::chrono::microseconds> resume_latency;
+};
+
+
+/** Holds the requests of a PowerLatencyConfig from construction until
+ * release() or destruction, after which the host is as before.
+ */
+class PowerLatencyRequest
+{
+public:
+    PowerLatencyRequest(const std::filesystem::path& root,
+        const PowerLatencyConfig& config, const std::vector<uint32_t>& cores,
+        logging::ILogger& logger);
+
+    ~PowerLatencyRequest()
+    {
+        release();
+    }
+
+    PowerLatencyRequest(const PowerLatencyRequest&) = delete;
+    PowerLatencyRequest& operator=(const PowerLatencyRequest&) = delete;
+
+    /** returns false if any of the requests could not be made */
+    bool ok() const
+    {
+        return m_ok;
+    }
+
+    void release();
+
+private:
+    logging::ILogger& m_logger;
+    bool m_ok = true;
+
+    // the PM QoS request lasts as long as the file is open:
+    int m_dma_latency_fd = -1;
+
+    // the sysfs files we changed and their previous content
+    std::vector<std::pair<std::filesystem::path, std::string>> m_saved;
+
+    logging::ILogger& get_logger() const
+    {
+        return m_logger;
+    }
+};
+
+
+enum class WaitKind
+{
+    /** busy-wait until the next release: least jitter, most power */
+    SPIN,
+    /** sleep until shortly before the next release, then spin */
+    HYBRID
+};
+
+/** how a kernel waits for its next release when it has nothing to do,
+ * see RealtimeKernel::set_wait_strategy() */
+struct WaitStrategy
+{
+    WaitKind kind = WaitKind::SPIN;
+
+    /** HYBRID: stop sleeping this long before the release. It should cover
+     * the wake-up latency of the core plus the timer slack. */
+    std::chrono::nanoseconds spin_window = std::chrono::microseconds(50);
+
+    /** HYBRID: don't sleep for less than this */
+    std::chrono::nanoseconds min_sleep = std::chrono::microseconds(20);
+
+    /** this long before the release of hard real-time tasks that have a
+     * prefetch (BaseTask::add_prefetch_range(), set_prefetch_hook()) the
+     * kernel warms them up and then only spins: idle work would evict
+     * what was just loaded. 0 turns prefetching off. */
+    std::chrono::nanoseconds prefetch_window = std::chrono::microseconds(20);
+};
+
+struct WaitStats
+{
+    uint64_t num_sleeps = 0;
+    std::chrono::nanoseconds total_slept = std::chrono::nanoseconds(0);
+
+    /** the most a sleep took longer than asked for */
+    std::chrono::nanoseconds max_oversleep = std::chrono::nanoseconds(0);
+
+    /** sleeps that woke up after the release they were waiting for */
+    uint64_t num_late_wakeups = 0;
+};
+
+} // namespace realtime
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 #include <chrono>
@@ -10,15 +12,72 @@
 #include <slogger/TimeUtils.hpp>
 #include <slogger/ITimer.hpp>
 
+#include <urtsched/CoreArena.hpp>
 #include <urtsched/IService.hpp>
+#include <urtsched/PerfCounters.hpp>
+#include <urtsched/PowerManagement.hpp>
+#include <urtsched/RtMemory.hpp>
+#include <urtsched/SchedulingConfig.hpp>
+#include <urtsched/Simulation.hpp>
+#include <urtsched/StatsSegment.hpp>
+#include <urtsched/TaskProfile.hpp>
+#include <urtsched/TaskRecorder.hpp>
+#include <urtsched/TimingWheel.hpp>
 #include <urtsched/fixed_size_vector.hpp>
+#include <urtsched/latest_value.hpp>
+#include <urtsched/mpsc_queue.hpp>
 
+#include "AperiodicServer.hpp"
 #include "BaseTask.hpp"
+#include "CpuReservation.hpp"
 #include "IdleTask.hpp"
 #include "PeriodicTask.hpp"
+#include "ReleaseGroup.hpp"
+#include "TaskMode.hpp"
 
 namespace realtime
 {
+class TaskChain;
+
+/** progress info a kernel publishes so it can be monitored from other
+ * threads, see RealtimeKernel::get_heartbeat() */
+struct KernelHeartbeat
+{
+    uint64_t steps = 0;
+    uint64_t deadline_misses = 0;
+
+    /** the BaseTask::get_id() of the task that is running right now or 0.
+     * An id rather than the task: it may be gone by the time it's read. */
+    uint32_t running_task_id = 0;
+    std::chrono::nanoseconds running_since = std::chrono::nanoseconds(0);
+};
+
+/** page faults of a kernel's thread, see RealtimeKernel::prepare_memory() */
+struct MemoryReport
+{
+    PageFaultCounts before_prefault;
+    PageFaultCounts after_prefault;
+    PageFaultCounts at_exit;
+};
+
+/** Where a kernel's time went since run() started, see
+ * RealtimeKernel::get_accounting(). The buckets add up to 'total'.
+ */
+struct CoreAccounting
+{
+    std::chrono::nanoseconds total = std::chrono::nanoseconds(0);
+    /** task bodies, the same as RealtimeKernel::get_busy_time() */
+    std::chrono::nanoseconds tasks = std::chrono::nanoseconds(0);
+    /** busy-waiting for the release of hard real-time tasks */
+    std::chrono::nanoseconds spin = std::chrono::nanoseconds(0);
+    /** sweeps over the idle tasks and servers that found nothing to run */
+    std::chrono::nanoseconds idle_sweeps = std::chrono::nanoseconds(0);
+    /** sleeping with WaitKind::HYBRID (or skipped in simulation) */
+    std::chrono::nanoseconds sleep = std::chrono::nanoseconds(0);
+    /** the scheduler's own bookkeeping: scans, sorts, control commands... */
+    std::chrono::nanoseconds overhead = std::chrono::nanoseconds(0);
+};
+
 /** Schedules stuff on a single core.
  * As its for a single core only, it does not need
  * locks/synchronization code and is therefore really fast.
@@ -29,6 +88,7 @@ class RealtimeKernel : public service::IService
 public:
     RealtimeKernel(time_utils::ITimer& timer, logging::ILogger& logger, const std::string& name)
         : m_timer(timer), m_logger(logger), m_name(name)
+        , m_arena(std::make_unique<CoreArena>())
     {
     }
 
@@ -37,7 +97,184 @@ public:
         return m_timer;
     }
 
-    void set_sched_affinity(uint32_t core);
+    /** pin the calling thread to 'core' */
+    [[nodiscard]] error::Error set_sched_affinity(uint32_t core);
+
+    /** how the kernel's thread is to be scheduled,
+     * MultiCoreRealtimeKernel::run() applies it to every core's thread. */
+    void set_scheduling_config(const SchedulingConfig& config)
+    {
+        m_scheduling_config = config;
+    }
+
+    const SchedulingConfig& get_scheduling_config() const
+    {
+        return m_scheduling_config;
+    }
+
+    /** To be called on the kernel's own thread before run():
+     * pins it to the configured core (or 'core' if none is configured)
+     * and applies the configured policy, priority and timer slack.
+     * Everything is attempted; returns the first failure.
+     */
+    [[nodiscard]] error::Error apply_scheduling(uint32_t core);
+
+    /** how to wait for the next release when there's nothing to do:
+     * spinning (the default) or sleeping until shortly before it. */
+    void set_wait_strategy(const WaitStrategy& strategy)
+    {
+        m_wait_strategy = strategy;
+    }
+
+    const WaitStrategy& get_wait_strategy() const
+    {
+        return m_wait_strategy;
+    }
+
+    const WaitStats& get_wait_stats() const
+    {
+        return m_wait_stats;
+    }
+
+    /** Run in virtual time: 'timer' must be the timer the kernel was
+     * created with. Time then only advances by the cost of the tasks that
+     * run (BaseTask::set_cost_model()) and waits for a release jump straight
+     * to it, so run() simulates its runtime in virtual time.
+     */
+    void enable_simulation(
+        SimulatedTimer& timer, const SimulationConfig& config = {})
+    {
+        assert(&timer == &m_timer);
+        m_simulation = &timer;
+        m_simulation_config = config;
+    }
+
+    bool is_simulated() const
+    {
+        return m_simulation != nullptr;
+    }
+
+    /** Record every task run into 'recorder' (nullptr to stop recording).
+     * Set it before run(), the recorder's drain thread writes the records.
+     */
+    void set_recorder(const std::shared_ptr<TaskRecorder>& recorder);
+
+    const std::shared_ptr<TaskRecorder>& get_recorder() const
+    {
+        return m_recorder;
+    }
+
+    /** Seed the tasks added so far and all added later from the profile of
+     * their name in 'store', and copy their profiles back into it every
+     * 'interval' (skipped while the store is being saved, never blocking)
+     * and at the end of run(). nullptr to stop.
+     */
+    void set_profile_store(const std::shared_ptr<TaskProfileStore>& store,
+        std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+
+    const std::shared_ptr<TaskProfileStore>& get_profile_store() const
+    {
+        return m_profile_store;
+    }
+
+    /** calls 'f' with every task: periodic tasks (the members of release
+     * groups instead of the groups), idle tasks and servers */
+    template <typename F> void for_each_task(F&& f) const
+    {
+        for (const auto& t : m_periodic_list)
+        {
+            if (!t)
+            {
+                continue;
+            }
+            if (const auto* g = t->as_release_group())
+            {
+                g->for_each_member(f);
+            }
+            else
+            {
+                f(*t);
+            }
+        }
+        for (const auto& t : m_idle_list)
+        {
+            if (t)
+            {
+                f(*t);
+            }
+        }
+        for (const auto& t : m_server_list)
+        {
+            f(*t);
+        }
+    }
+
+    /** Publish our counters into 'slot' of a StatsSegment every 'interval'
+     * (nullptr to stop). Set it before run().
+     */
+    void set_stats_slot(stats_layout::KernelStats* slot, uint32_t core,
+        std::chrono::milliseconds interval = std::chrono::milliseconds(10))
+    {
+        m_stats_slot = slot;
+        m_stats_core = core;
+        m_stats_interval = interval;
+    }
+
+    /** how long tasks ran since the start of run() */
+    std::chrono::nanoseconds get_busy_time() const
+    {
+        return m_busy_time;
+    }
+
+    /** the breakdown of the time since the start of run(), updated at the
+     * start of every step() */
+    const CoreAccounting& get_accounting() const
+    {
+        return m_accounting;
+    }
+
+    /** To be called on the kernel's own thread before run():
+     * prefaults the thread's stack and maps the kernel's state memory so
+     * neither faults in the real-time loop. The page faults taken before,
+     * after this and at the end of run() are kept in get_memory_report().
+     */
+    void prepare_memory(const MemoryHardeningConfig& config);
+
+    const MemoryReport& get_memory_report() const
+    {
+        return m_memory_report;
+    }
+
+    /** To be called on the kernel's own thread before run(): count cycles,
+     * instructions, cache misses etc. (or software counters where there's
+     * no PMU) around every task run, see BaseTask::get_perf_stats().
+     * Returns FAILED if no counters could be opened at all.
+     */
+    [[nodiscard]] error::Error enable_perf_counters(
+        const PerfConfig& config = PerfConfig());
+
+    /** nullptr unless enable_perf_counters() succeeded */
+    const PerfCounterGroup* get_perf_counters() const
+    {
+        return m_perf.get();
+    }
+
+    /** Preallocate the core-local memory tasks get from
+     * BaseTask::get_arena(). Call it on the kernel's own thread so the memory
+     * is local to the core, prepare_memory() does so for its config.arena.
+     */
+    void create_arena(const ArenaConfig& config);
+
+    CoreArena& get_arena()
+    {
+        return *m_arena;
+    }
+
+    /** memory reserved for this kernel by prepare_memory(), may be empty */
+    RtMemoryRegion& get_state_memory()
+    {
+        return m_state_memory;
+    }
 
     [[nodiscard]] error::Error init() override
     {
@@ -56,50 +293,391 @@ public:
     /** Add a periodic task to the scheduler.
      * The returned task is disabled by default.
      * Therefore, call periodic->enable() to enable it.
+     * returns nullptr if there are MAX_PERIODIC_TASKS already.
      */
     [[nodiscard]] std::shared_ptr<PeriodicTask> add_periodic(
         TaskType tt,
         const std::string& name, const std::chrono::microseconds& interval,
         const task_func_t& callback);
 
+    /** Like add_periodic() but for one of many small tasks of the same or
+     * harmonic periods (1 ms, 2 ms, 10 ms...): it joins a ReleaseGroup of
+     * its type whose period divides its own, or whose period it divides,
+     * which is then rebased to it. A group takes a single slot of the
+     * kernel and runs its due members back-to-back at its release.
+     * Add the tasks before the kernel runs.
+     * returns nullptr if a new group doesn't fit.
+     */
+    [[nodiscard]] std::shared_ptr<PeriodicTask> add_periodic_grouped(
+        TaskType tt,
+        const std::string& name, const std::chrono::microseconds& interval,
+        const task_func_t& callback);
+
     /** Add an idle task to the scheduler.
      * It is enabled by default.
+     * returns nullptr if there are MAX_IDLE_TASKS already.
      */
     [[nodiscard]] std::shared_ptr<IdleTask> add_idle_task(
         const std::string& name, const task_func_t& callback);
 
+    /** Add a server for aperiodic jobs that may use at most 'budget' of cpu
+     * time every 'period'. Jobs are posted to the returned server with
+     * AperiodicServer::post(). It is enabled by default.
+     * returns nullptr if there are MAX_APERIODIC_SERVERS already.
+     */
+    [[nodiscard]] std::shared_ptr<AperiodicServer> add_aperiodic_server(
+        const std::string& name, const std::chrono::microseconds& budget,
+        const std::chrono::microseconds& period);
+
+    /** Add a cpu reservation of 'budget' every 'period'.
+     * Tasks are attached to it with BaseTask::set_reservation(),
+     * see also service::Service::set_cpu_reservation().
+     * returns nullptr if there are MAX_RESERVATIONS already.
+     */
+    [[nodiscard]] std::shared_ptr<CpuReservation> add_reservation(
+        const std::string& name, const std::chrono::microseconds& budget,
+        const std::chrono::microseconds& period);
+
+    /** Drop a reservation of add_reservation(), attach its tasks to
+     * another one (or none) first. Not while the kernel runs.
+     * returns false if it isn't ours */
+    bool remove_reservation(const std::shared_ptr<CpuReservation>& r);
+
+    /** Add a latest_value for handing T from one task to another, of this
+     * kernel or of another one (e.g. another core of a
+     * MultiCoreRealtimeKernel). It measures the age of the values read
+     * with our timer and its counts are part of our status.
+     * Not while the kernel runs.
+     * returns nullptr if there are MAX_LATEST_VALUES already.
+     */
+    template <typename T>
+    [[nodiscard]] std::shared_ptr<latest_value<T>> add_latest_value(
+        const std::string& name)
+    {
+        if (m_latest_values.size() == m_latest_values.capacity())
+        {
+            return nullptr;
+        }
+        auto v = std::make_shared<latest_value<T>>(&m_timer, name);
+        m_latest_values.push_back(v);
+        return v;
+    }
+
+    /** Preallocate the timers of schedule_at(), replacing the pending
+     * ones. Otherwise the first schedule_at() before run() creates them
+     * with the default TimerConfig. Not while the kernel runs.
+     */
+    void create_timers(const TimerConfig& config);
+
+    /** Call 'fn' once 'time' (of our timer) has passed, to the tick of the
+     * TimerConfig: on this kernel's thread, in the slack before the next
+     * release or while no periodic task is due, ahead of the aperiodic
+     * jobs and idle tasks. Scheduling and cancelling are O(1) and don't
+     * allocate, see TimingWheel. Only from this kernel's thread (e.g. in
+     * its tasks and timer callbacks) or before run(). The timers must
+     * exist by then: while the kernel runs, a schedule_at() without them
+     * asserts (returns an invalid handle in release builds) rather than
+     * allocating them. Returns an invalid handle if all timers are pending.
+     */
+    TimerHandle schedule_at(std::chrono::nanoseconds time, timer_func_t fn);
+
+    /** schedule_at() 'delay' from now */
+    TimerHandle schedule_after(
+        std::chrono::nanoseconds delay, timer_func_t fn);
+
+    /** returns false if the timer fired or was cancelled already */
+    bool cancel_timer(TimerHandle h);
+
+    /** nullptr until the first schedule_at() or create_timers() */
+    const TimingWheel* get_timers() const
+    {
+        return m_timers.get();
+    }
+
+    /** Define a mode: a named set of tasks with their periods.
+     * Switching to a mode enables its tasks and disables the tasks of all
+     * other modes; tasks that are not part of any mode are left alone.
+     * Modes must be defined before the kernel runs.
+     * Redefining a mode replaces it. returns false if there are MAX_MODES
+     * other modes already.
+     */
+    [[nodiscard]] bool define_mode(
+        const std::string& name, const std::vector<ModeTask>& tasks);
+
+    /** Request a switch to the mode 'name'. May be called from any thread.
+     * The kernel applies the whole task set at once at the next 'boundary'.
+     * When several requests are made before one is applied, the last one wins.
+     * returns false if there is no such mode.
+     */
+    bool request_mode_change(const std::string& name,
+        ModeChangeBoundary boundary = ModeChangeBoundary::RELEASE);
+
+    /** returns the name of the active mode or "" if no mode was applied yet */
+    const std::string& get_current_mode() const;
+
+    uint64_t get_num_mode_changes() const
+    {
+        return m_num_mode_changes;
+    }
+
+    /** time between the last mode change request and its application */
+    std::chrono::nanoseconds get_last_mode_change_latency() const
+    {
+        return m_last_mode_change_latency;
+    }
+
     /** return true on successful removal */
     bool remove(const std::shared_ptr<PeriodicTask>& task_ptr);
 
+    /** The post_*() methods are the thread-safe versions of add_periodic(),
+     * add_idle_task(), remove(), enable(), disable() and set_period().
+     * They may be called from any thread (e.g. a management thread).
+     * The change is queued and applied by the kernel at the start of its
+     * next step(), so the real-time loop never takes a lock for them.
+     * They return nullptr/false when the command queue is full, the
+     * post_add_*() ones also when the kernel has no room for the task
+     * (counting the adds still queued).
+     */
+    [[nodiscard]] std::shared_ptr<PeriodicTask> post_add_periodic(
+        TaskType tt,
+        const std::string& name, const std::chrono::microseconds& interval,
+        const task_func_t& callback);
+
+    [[nodiscard]] std::shared_ptr<IdleTask> post_add_idle_task(
+        const std::string& name, const task_func_t& callback);
+
+    bool post_remove(const std::shared_ptr<PeriodicTask>& task_ptr);
+
+    bool post_enable(const std::shared_ptr<BaseTask>& task_ptr);
+
+    bool post_disable(const std::shared_ptr<BaseTask>& task_ptr);
+
+    bool post_set_period(const std::shared_ptr<BaseTask>& task_ptr,
+        const std::chrono::microseconds& interval);
+
+    /** disable the task with BaseTask::get_id() 'task_id' if it is (still)
+     * one of ours. For monitors that only know its id, see get_heartbeat().
+     */
+    bool post_disable_task_id(uint32_t task_id);
+
+    /** Ask the kernel to stop. May be called from any thread.
+     * The kernel finishes its current step and run() returns.
+     */
+    void request_stop()
+    {
+        m_stop_requested.store(true, std::memory_order_relaxed);
+    }
+
+    /** forget an earlier request_stop() so run() can be called again */
+    void clear_stop_request()
+    {
+        m_stop_requested.store(false, std::memory_order_relaxed);
+    }
+
     bool should_exit() const
     {
-        return false;
+        return m_stop_requested.load(std::memory_order_relaxed);
     }
 
+    /** may be called from any thread */
+    KernelHeartbeat get_heartbeat() const;
+
     /** @param max_runtime if no value is provided or if 0 run forever
      */
     void run(std::optional<const std::chrono::milliseconds> max_runtime);
 
     void step();
 
+    /** an object with the status of all tasks, servers, reservations
+     * and whatever else this kernel tracks */
     std::string get_service_status_as_json() const;
 
+    void write_status(service::StatusWriter& w) const;
+
     logging::ILogger& get_logger()
     {
         return m_logger;
     }
 
 private:
+    friend class BaseTask;
+    friend class TaskChain;
+
     time_utils::ITimer& m_timer;
     static constexpr bool m_debug = false;
     logging::ILogger& m_logger;
     const std::string m_name;
+    SchedulingConfig m_scheduling_config;
+    WaitStrategy m_wait_strategy;
+    WaitStats m_wait_stats;
+    SimulatedTimer* m_simulation = nullptr;
+    SimulationConfig m_simulation_config;
+    std::shared_ptr<TaskRecorder> m_recorder;
+    std::shared_ptr<TaskProfileStore> m_profile_store;
+    std::chrono::milliseconds m_profile_interval = std::chrono::milliseconds(1000);
+    std::chrono::nanoseconds m_next_profile_capture = std::chrono::nanoseconds(0);
+
+    stats_layout::KernelStats* m_stats_slot = nullptr;
+    uint32_t m_stats_core = 0;
+    std::chrono::milliseconds m_stats_interval = std::chrono::milliseconds(10);
+    std::chrono::nanoseconds m_next_stats_publish = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds m_run_started_at = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds m_busy_time = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds m_last_slack = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds m_min_slack = std::chrono::nanoseconds::max();
+
+    CoreAccounting m_accounting;
+    // the part of the accounting of the step() in progress that is
+    // measured, the rest is overhead (or an idle sweep if 'idle'):
+    struct StepAccounting
+    {
+        std::optional<std::chrono::nanoseconds> started_at;
+        std::chrono::nanoseconds busy_at_start = std::chrono::nanoseconds(0);
+        std::chrono::nanoseconds spin = std::chrono::nanoseconds(0);
+        std::chrono::nanoseconds idle_sweeps = std::chrono::nanoseconds(0);
+        std::chrono::nanoseconds sleep = std::chrono::nanoseconds(0);
+        bool idle = false;
+    } m_step;
 
     static constexpr auto MAX_PERIODIC_TASKS = 64;
     static constexpr auto MAX_IDLE_TASKS = 16;
+    static constexpr auto MAX_APERIODIC_SERVERS = 4;
+    static constexpr auto MAX_RESERVATIONS = 16;
+    static constexpr auto MAX_MODES = 8;
+    static constexpr auto MAX_CHAINS = 8;
+    static constexpr auto MAX_LATEST_VALUES = 16;
+    static constexpr auto MAX_PENDING_COMMANDS = 64;
+    static constexpr int NO_MODE = -1;
 
     realtime::fixed_size_vector<std::shared_ptr<PeriodicTask>, MAX_PERIODIC_TASKS> m_periodic_list;
     realtime::fixed_size_vector<std::shared_ptr<IdleTask>, MAX_IDLE_TASKS> m_idle_list;
+    // the slots of the lists above in use or reserved by post_add_*():
+    std::atomic<size_t> m_periodic_slots = 0;
+    std::atomic<size_t> m_idle_slots = 0;
+    realtime::fixed_size_vector<std::shared_ptr<AperiodicServer>, MAX_APERIODIC_SERVERS> m_server_list;
+    realtime::fixed_size_vector<std::shared_ptr<CpuReservation>, MAX_RESERVATIONS> m_reservation_list;
+    // the TaskChains with stages on this kernel:
+    realtime::fixed_size_vector<std::shared_ptr<TaskChain>, MAX_CHAINS> m_chains;
+    bool m_has_remote_chain_stages = false;
+    realtime::fixed_size_vector<std::shared_ptr<latest_value_base>, MAX_LATEST_VALUES> m_latest_values;
+    std::unique_ptr<TimingWheel> m_timers;
+    // the longest a timer callback took, less than that left and the
+    // rest wait for the next slack:
+    std::chrono::nanoseconds m_max_timer_callback = std::chrono::nanoseconds(0);
+
+    realtime::fixed_size_vector<TaskMode, MAX_MODES> m_modes;
+    int m_current_mode = NO_MODE;
+    int m_pending_mode = NO_MODE;
+    ModeChangeBoundary m_pending_boundary = ModeChangeBoundary::RELEASE;
+    std::chrono::nanoseconds m_pending_requested_at = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds m_mode_started_at = std::chrono::nanoseconds(0);
+    uint64_t m_num_mode_changes = 0;
+    std::chrono::nanoseconds m_last_mode_change_latency = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds m_max_mode_change_latency = std::chrono::nanoseconds(0);
+
+    // written by request_mode_change() from any thread:
+    // (sequence number << 16) | (boundary << 8) | mode index, a seqlock
+    // around m_mode_requested_at_ns (odd while a request is written)
+    std::atomic<uint64_t> m_mode_request = 0;
+    std::atomic<int64_t> m_mode_requested_at_ns = 0;
+    uint64_t m_mode_request_seen = 0;
+
+    struct ControlCommand
+    {
+        enum class Op
+        {
+            NONE,
+            ADD_PERIODIC,
+            ADD_IDLE,
+            REMOVE,
+            ENABLE,
+            DISABLE,
+            DISABLE_IF_OURS,
+            SET_PERIOD
+        };
+
+        Op op = Op::NONE;
+        std::shared_ptr<BaseTask> task;
+        std::chrono::microseconds interval = std::chrono::microseconds(0);
+        uint32_t task_id = 0;
+    };
+
+    realtime::mpsc_queue<ControlCommand, MAX_PENDING_COMMANDS> m_control_queue;
+
+    std::atomic<bool> m_stop_requested = false;
+
+    bool m_memory_prepared = false;
+    /** set for the duration of run() */
+    bool m_running = false;
+    MemoryReport m_memory_report;
+    RtMemoryRegion m_state_memory;
+    std::unique_ptr<CoreArena> m_arena;
+    std::unique_ptr<PerfCounterGroup> m_perf;
+
+    // written by the kernel's own thread only, published once per step():
+    uint64_t m_num_steps = 0;
+    uint64_t m_num_deadline_misses = 0;
+    std::atomic<uint64_t> m_published_steps = 0;
+    std::atomic<uint64_t> m_published_deadline_misses = 0;
+
+    // set by BaseTask::run():
+    std::atomic<uint32_t> m_running_task_id = 0;
+    std::atomic<int64_t> m_running_since_ns = 0;
+
+    void run_next();
+
+    /** account the step() that started at m_step.started_at */
+    void close_step_accounting(std::chrono::nanoseconds now);
+
+    /** write our counters to m_stats_slot under its seqlock */
+    void publish_stats(std::chrono::nanoseconds now);
+
+    void register_with_recorder(const BaseTask& t, RecordedTaskKind kind)
+    {
+        if (m_recorder)
+        {
+            m_recorder->register_task(t, kind);
+        }
+    }
+
+    /** a task was created for this kernel */
+    void task_created(BaseTask& t, RecordedTaskKind kind)
+    {
+        register_with_recorder(t, kind);
+        if (m_profile_store)
+        {
+            m_profile_store->seed(t);
+        }
+    }
+
+    /** called by TaskChain for each stage it adds to this kernel,
+     * 'remote' if the stage has a predecessor on another kernel.
+     * returns false if there are MAX_CHAINS other chains already */
+    bool add_chain(const std::shared_ptr<TaskChain>& chain, bool remote);
+
+    /** open the gates of our chain stages whose predecessors completed,
+     * returns true if it released one */
+    bool release_chain_stages();
+
+    /** take one of 'capacity' slots of a list, from any thread */
+    static bool take_slot(std::atomic<size_t>& taken, size_t capacity)
+    {
+        if (taken.fetch_add(1, std::memory_order_relaxed) < capacity)
+        {
+            return true;
+        }
+        taken.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /** into a slot taken before, returns false if there's none after all */
+    bool insert_periodic(const std::shared_ptr<PeriodicTask>& s);
+    bool insert_idle_task(const std::shared_ptr<IdleTask>& s);
+    void apply_control_commands();
+    void disable_if_ours(uint32_t task_id);
+
+    void check_mode_change();
+    void apply_mode(int mode);
 
     std::vector<std::shared_ptr<PeriodicTask>> get_next_periodics();
 
@@ -114,7 +692,33 @@ private:
     /** return a sorted list of real-time tasks */
     std::vector<PeriodicTask*> get_sorted_realtime_tasks(const std::vector<std::shared_ptr<PeriodicTask>>& next_up);
 
-    void run_idle_tasks();
+    /** returns true if some idle task ran */
+    bool run_idle_tasks();
+
+    /** returns false if the task's reservation is exhausted */
+    static bool admit(const BaseTask& t)
+    {
+        auto* r = t.get_reservation();
+        return r == nullptr || r->admit();
+    }
+
+    /** Run the callbacks of the due timers while there's time for them
+     * before 'next' (as long as there are any if it's nullptr).
+     * returns true if one ran */
+    bool run_due_timers(const PeriodicTask* next);
+
+    /** how long until a timer may be due, max() for none */
+    std::chrono::nanoseconds time_until_next_timer() const;
+
+    /** returns true if some aperiodic job ran */
+    bool serve_aperiodic_jobs(const PeriodicTask* next);
+
+    /** with the HYBRID wait strategy: sleep until 'next' is due within the
+     * spin window. In simulation: jump to the release of 'next'.
+     * Either way for at most 'limit' if it's positive.
+     * Returns how long we slept. */
+    std::chrono::nanoseconds idle_until_close_to(const BaseTask& next,
+        std::chrono::nanoseconds limit = std::chrono::nanoseconds::max());
 };
 
 } // namespace realtime
\ No newline at end of file
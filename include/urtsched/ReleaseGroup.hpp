@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <slogger/ILogger.hpp>
+
+#include "PeriodicTask.hpp"
+#include "fixed_size_vector.hpp"
+
+namespace realtime
+{
+
+/** Created by RealtimeKernel::add_periodic_grouped(): periodic tasks whose
+ * periods are multiples of the group's share one slot of the kernel, one
+ * deadline and one release. At each release the group runs its due members
+ * back-to-back, a member with k times the group's period every k-th
+ * release, so the scheduler scans and sorts the group once instead of
+ * every member. A period set later that is no multiple is rounded down.
+ */
+class ReleaseGroup : public PeriodicTask
+{
+public:
+    static constexpr size_t MAX_MEMBERS = 128;
+
+    ReleaseGroup(time_utils::ITimer& timer, TaskType tt,
+        const std::string& name, const std::chrono::microseconds& t,
+        logging::ILogger& logger, RealtimeKernel* kernel);
+
+    /** true if a task of type 'tt' with period 't' can join now or after
+     * rebase() */
+    bool can_take(TaskType tt, const std::chrono::microseconds& t) const;
+
+    /** Make 't', a divisor of our period, the group's period: the members
+     * keep their periods and phases. */
+    void rebase(const std::chrono::microseconds& t);
+
+    /** returns false if the group is full */
+    bool add_member(const std::shared_ptr<PeriodicTask>& task);
+
+    /** Returns false if 'task' is none of our members. The members left
+     * keep the group's period a divisor of theirs, see fit_period(). */
+    bool remove_member(const std::shared_ptr<PeriodicTask>& task);
+
+    /** Make the greatest common divisor of the members' periods the
+     * group's period, e.g. once its fastest member left. */
+    void fit_period();
+
+    /** without, the kernel doesn't release the group */
+    bool has_enabled_members() const;
+
+    /** calls 'f' with every member */
+    template <typename F> void for_each_member(F&& f) const
+    {
+        for (const auto& m : m_members)
+        {
+            if (m)
+            {
+                f(*m);
+            }
+        }
+    }
+
+    size_t get_num_members() const;
+
+    uint64_t get_num_releases() const
+    {
+        return m_num_releases;
+    }
+
+    /** run the members that are due, from run_elapsed() */
+    std::chrono::nanoseconds run_members();
+
+private:
+    // remove_member() leaves empty slots behind:
+    realtime::fixed_size_vector<std::shared_ptr<PeriodicTask>, MAX_MEMBERS>
+        m_members;
+    uint64_t m_num_releases = 0;
+};
+
+} // namespace realtime
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <slogger/ILogger.hpp>
+
+#include <urtsched/Simulation.hpp>
+#include <urtsched/TaskRecorder.hpp>
+#include <urtsched/task_defs.hpp>
+
+namespace realtime
+{
+
+/** what to change when replaying recordings. Tasks are named as they were
+ * given to add_periodic()/add_idle_task(), without the kernel's prefix.
+ */
+struct ReplayConfig
+{
+    /** replace the period of a periodic task */
+    std::map<std::string, std::chrono::microseconds> periods;
+
+    /** replay a periodic task as hard or soft real-time instead of as
+     * recorded */
+    std::map<std::string, TaskType> task_types;
+
+    /** move a task to another core: an index into the recordings, new cores
+     * are added as needed */
+    std::map<std::string, size_t> placement;
+
+    /** how long to simulate, by default the span of the longest recording */
+    std::optional<std::chrono::nanoseconds> duration;
+
+    SimulationConfig simulation;
+};
+
+struct ReplayTaskResult
+{
+    std::string name;
+    size_t core = 0;
+    TaskType type = TaskType::HARD_REALTIME;
+    uint64_t runs = 0;
+    uint64_t deadline_misses = 0;
+    std::chrono::nanoseconds max_release_lateness = std::chrono::nanoseconds(0);
+};
+
+struct ReplayReport
+{
+    std::vector<ReplayTaskResult> tasks;
+    uint64_t total_deadline_misses = 0;
+
+    const ReplayTaskResult* find(const std::string& name) const;
+
+    std::string to_json() const;
+};
+
+
+/** Answers "would this configuration have missed deadlines?" for recorded
+ * task timings: every task is recreated on a simulated kernel, per core, and
+ * its runs take the recorded durations again, in the recorded order.
+ * Aperiodic servers are replayed as idle tasks.
+ */
+class ReplayDriver
+{
+public:
+    /** one recording per core */
+    ReplayDriver(logging::ILogger& logger, std::vector<Recording> recordings)
+        : m_logger(logger)
+        , m_recordings(std::move(recordings))
+    {
+    }
+
+    ReplayReport run(const ReplayConfig& config = {}) const;
+
+private:
+    logging::ILogger& m_logger;
+    const std::vector<Recording> m_recordings;
+};
+
+} // namespace realtime
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <slogger/ILogger.hpp>
+
+namespace realtime
+{
+struct ArenaConfig
+{
+    /** bytes for the scratch allocator that is reset before every task run */
+    size_t scratch_bytes = 0;
+
+    /** number of blocks in every size-class pool */
+    size_t blocks_per_pool = 0;
+
+    /** the scratch memory and all pools, see CoreArena */
+    size_t total_bytes() const;
+};
+
+/** opt-in memory preparation done before the real-time loops start,
+ * see MultiCoreRealtimeKernel::set_memory_hardening()
+ */
+struct MemoryHardeningConfig
+{
+    /** mlockall(MCL_CURRENT | MCL_FUTURE) so no page is ever swapped out
+     * or faulted in lazily */
+    bool lock_memory = true;
+
+    /** how much of each real-time thread's stack to touch up front */
+    size_t prefault_stack_bytes = 256 * 1024;
+
+    /** size of the (hugepage backed if possible) memory region every kernel
+     * gets for its own state, see RealtimeKernel::get_state_memory() */
+    size_t state_memory_bytes = 0;
+
+    /** the per-core task memory, see RealtimeKernel::create_arena() */
+    ArenaConfig arena;
+};
+
+struct PageFaultCounts
+{
+    uint64_t minor = 0;
+    uint64_t major = 0;
+};
+
+/** page faults taken by the calling thread so far */
+PageFaultCounts get_thread_page_faults();
+
+/** returns false if the memory could not be locked, e.g. because of
+ * RLIMIT_MEMLOCK or a missing CAP_IPC_LOCK */
+bool lock_all_memory(logging::ILogger& logger);
+
+/** touch 'bytes' of the calling thread's stack so later calls do not fault */
+void prefault_stack(size_t bytes);
+
+/** An anonymous memory mapping that is backed by hugepages when the system
+ * has them available, and by normal (transparent hugepage advised) pages
+ * otherwise. All of it is touched at creation so it never faults later.
+ */
+class RtMemoryRegion
+{
+public:
+    RtMemoryRegion() = default;
+    RtMemoryRegion(size_t bytes, logging::ILogger& logger);
+    ~RtMemoryRegion();
+
+    RtMemoryRegion(const RtMemoryRegion&) = delete;
+    RtMemoryRegion& operator=(const RtMemoryRegion&) = delete;
+    RtMemoryRegion(RtMemoryRegion&& other) noexcept;
+    RtMemoryRegion& operator=(RtMemoryRegion&& other) noexcept;
+
+    void* data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    bool is_hugepage_backed() const
+    {
+        return m_hugepages;
+    }
+
+private:
+    void* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_hugepages = false;
+
+    void release();
+};
+
+} // namespace realtime
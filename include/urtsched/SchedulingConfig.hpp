@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace realtime
+{
+
+enum class SchedPolicy
+{
+    /** the normal (CFS) scheduler, i.e. no real-time class */
+    OTHER,
+    FIFO,
+    RR,
+    DEADLINE
+};
+
+/** how a kernel's thread is scheduled by the OS,
+ * see RealtimeKernel::set_scheduling_config() */
+struct SchedulingConfig
+{
+    /** std::nullopt leaves the policy and priority the thread has, e.g.
+     * inherited from a process started with chrt */
+    std::optional<SchedPolicy> policy;
+
+    /** for FIFO and RR: 1 (lowest) .. 99 (highest) */
+    int priority = 0;
+
+    /** the core to pin to, by default the kernel's reserved core */
+    std::optional<uint32_t> core;
+
+    /** for DEADLINE: the thread gets 'runtime' every 'period', to be used
+     * before 'deadline'. Note that SCHED_DEADLINE threads can only be pinned
+     * to a single core inside an isolated cpuset partition. */
+    std::chrono::nanoseconds runtime = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds deadline = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds period = std::chrono::nanoseconds(0);
+
+    /** the thread's timer slack (PR_SET_TIMERSLACK), lower means more
+     * precise wake-ups from sleeps. std::nullopt leaves it as is. */
+    std::optional<std::chrono::nanoseconds> timer_slack =
+        std::chrono::nanoseconds(1);
+};
+
+/** the OS scheduling settings of a thread, so they can be restored */
+struct ThreadSchedulingState
+{
+    int policy = 0;
+    int priority = 0;
+    /** the sched_attr flags and nice value, see sched_getattr(2) */
+    uint64_t flags = 0;
+    int nice = 0;
+    /** for SCHED_DEADLINE, as in SchedulingConfig */
+    std::chrono::nanoseconds runtime = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds deadline = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds period = std::chrono::nanoseconds(0);
+    uint64_t timer_slack_ns = 0;
+    std::optional<std::vector<uint32_t>> cpus;
+};
+
+/** returns the scheduling settings of the calling thread */
+ThreadSchedulingState save_thread_scheduling();
+
+/** reverts the calling thread to 'state' */
+void restore_thread_scheduling(const ThreadSchedulingState& state);
+
+} // namespace realtime
@@ -4,6 +4,7 @@
 #include <queue>
 #include <memory>
 #include <map>
+#include <vector>
 
 #include <slogger/ILogger.hpp>
 #include <slogger/ITimer.hpp>
@@ -42,9 +43,41 @@ public:
      */
     void run_oneshot_idle_task(const std::string& name, const realtime::task_func_t& f);
 
+    /** Limit this service to 'budget' of cpu time every 'period'.
+     * All tasks created through this service (also the ones created
+     * before this call) are charged to the reservation. Calling it again
+     * replaces the reservation.
+     */
+    void set_cpu_reservation(const std::string& name,
+        const std::chrono::microseconds& budget,
+        const std::chrono::microseconds& period);
+
+    const std::shared_ptr<realtime::CpuReservation>& get_cpu_reservation() const
+    {
+        return m_reservation;
+    }
+
+    /** same as RealtimeKernel::add_periodic() but charged to this
+     * service's reservation */
+    [[nodiscard]] std::shared_ptr<realtime::PeriodicTask> add_periodic(
+        realtime::TaskType tt, const std::string& name,
+        const std::chrono::microseconds& interval,
+        const realtime::task_func_t& callback);
+
+    /** same as RealtimeKernel::add_idle_task() but charged to this
+     * service's reservation */
+    [[nodiscard]] std::shared_ptr<realtime::IdleTask> add_idle_task(
+        const std::string& name, const realtime::task_func_t& callback);
+
 private:
     std::shared_ptr<realtime::RealtimeKernel> m_rt_kernel;
     logging::ILogger& m_logger;
+    std::shared_ptr<realtime::CpuReservation> m_reservation;
+
+    // all tasks created through this service:
+    std::vector<std::shared_ptr<realtime::BaseTask>> m_own_tasks;
+
+    void own(const std::shared_ptr<realtime::BaseTask>& task);
 
     std::map<std::string, std::shared_ptr<realtime::IdleTask>> m_tasks;
 };
@@ -1,10 +1,11 @@
-
 #pragma once
 
 #include <memory>
+#include <span>
 #include <vector>
 
 #include <urtsched/IService.hpp>
+#include <urtsched/StatusWriter.hpp>
 
 namespace service
 {
@@ -15,8 +16,19 @@ namespace service
 class ServiceBus
 {
 public:
+    /** a json array with the status of every service that has one */
     std::string get_service_status_as_json();
 
+    /** Writes the same as get_service_status_as_json() (or its binary
+     * form) into 'buffer' without allocating. Returns the bytes the
+     * complete status takes: if that's more than buffer.size() the output
+     * was cut off and should be retried with a bigger buffer.
+     */
+    size_t write_status(std::span<char> buffer,
+        StatusFormat format = StatusFormat::JSON) const;
+
+    void write_status(StatusWriter& w) const;
+
     void add(const std::shared_ptr<service::IService> s)
     {
         m_services.push_back(s);
@@ -25,4 +37,4 @@ public:
 private:
     std::vector<std::shared_ptr<service::IService>> m_services;
 };
-} // namespace service
\ No newline at end of file
+} // namespace service
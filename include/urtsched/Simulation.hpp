@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <slogger/ITimer.hpp>
+
+namespace realtime
+{
+
+/** A clock that only moves when told to.
+ * With RealtimeKernel::enable_simulation() the kernel moves it by the cost
+ * of the tasks it runs and jumps it to the next release when it would
+ * otherwise wait, so a schedule is simulated as fast as the tasks' callbacks
+ * can be called and the outcome does not depend on the host.
+ */
+class SimulatedTimer : public time_utils::ITimer
+{
+public:
+    explicit SimulatedTimer(
+        std::chrono::nanoseconds start = std::chrono::nanoseconds(0))
+        : m_now_ns(start.count())
+    {
+    }
+
+    std::chrono::nanoseconds get_time_ns() override
+    {
+        return std::chrono::nanoseconds(
+            m_now_ns.load(std::memory_order_relaxed));
+    }
+
+    void advance(std::chrono::nanoseconds d)
+    {
+        if (d.count() > 0)
+        {
+            m_now_ns.fetch_add(d.count(), std::memory_order_relaxed);
+        }
+    }
+
+    /** never goes back in time */
+    void advance_to(std::chrono::nanoseconds t)
+    {
+        advance(t - get_time_ns());
+    }
+
+private:
+    // atomic so monitors on other threads may read it:
+    std::atomic<int64_t> m_now_ns;
+};
+
+
+/** how long a task's run takes in simulated time,
+ * see BaseTask::set_cost_model() */
+class CostModel
+{
+public:
+    virtual ~CostModel() = default;
+
+    virtual std::chrono::nanoseconds next_cost() = 0;
+};
+
+
+class FixedCost : public CostModel
+{
+public:
+    explicit FixedCost(std::chrono::nanoseconds cost)
+        : m_cost(cost)
+    {
+    }
+
+    std::chrono::nanoseconds next_cost() override
+    {
+        return m_cost;
+    }
+
+private:
+    const std::chrono::nanoseconds m_cost;
+};
+
+
+/** costs drawn uniformly from [min, max] */
+class UniformCost : public CostModel
+{
+public:
+    UniformCost(std::chrono::nanoseconds min, std::chrono::nanoseconds max,
+        uint64_t seed)
+        : m_rng(seed)
+        , m_dist(min.count(), max.count())
+    {
+    }
+
+    std::chrono::nanoseconds next_cost() override
+    {
+        return std::chrono::nanoseconds(m_dist(m_rng));
+    }
+
+private:
+    std::mt19937_64 m_rng;
+    std::uniform_int_distribution<int64_t> m_dist;
+};
+
+
+/** normally distributed costs, clamped to [min, max] */
+class NormalCost : public CostModel
+{
+public:
+    NormalCost(std::chrono::nanoseconds mean, std::chrono::nanoseconds stddev,
+        std::chrono::nanoseconds min, std::chrono::nanoseconds max,
+        uint64_t seed)
+        : m_rng(seed)
+        , m_dist((double) mean.count(), (double) stddev.count())
+        , m_min(min)
+        , m_max(max)
+    {
+    }
+
+    std::chrono::nanoseconds next_cost() override;
+
+private:
+    std::mt19937_64 m_rng;
+    std::normal_distribution<double> m_dist;
+    const std::chrono::nanoseconds m_min;
+    const std::chrono::nanoseconds m_max;
+};
+
+
+/** replays recorded costs in order, from the start again when done */
+class ReplayCost : public CostModel
+{
+public:
+    explicit ReplayCost(std::vector<std::chrono::nanoseconds> costs)
+        : m_costs(std::move(costs))
+    {
+    }
+
+    std::chrono::nanoseconds next_cost() override;
+
+    /** how many times all costs were replayed */
+    uint64_t get_num_wraps() const
+    {
+        return m_num_wraps;
+    }
+
+private:
+    const std::vector<std::chrono::nanoseconds> m_costs;
+    size_t m_next = 0;
+    uint64_t m_num_wraps = 0;
+};
+
+
+struct SimulationConfig
+{
+    /** the cost of tasks without a cost model */
+    std::chrono::nanoseconds default_cost = std::chrono::microseconds(1);
+
+    /** Idle tasks usually poll: run them once per gap between releases
+     * and then jump to the release, instead of sweeping them over and over
+     * while their costs slowly fill the gap.
+     */
+    bool idle_once_per_release = true;
+};
+
+} // namespace realtime
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <slogger/ILogger.hpp>
+
+namespace realtime
+{
+
+/** The fixed layout of the shared memory statistics segment.
+ * Readers must check magic and version, and may only rely on the sizes in
+ * the header to find the kernels. Fields are only ever added at the end of
+ * a struct, together with a version bump, so a reader of a newer version
+ * can read what an older one wrote, see kernel_stats_size().
+ */
+namespace stats_layout
+{
+    constexpr uint32_t MAGIC = 0x53545255; // "URTS"
+    constexpr uint32_t VERSION = 3;
+    constexpr size_t MAX_KERNELS = 16;
+    constexpr size_t MAX_TASKS = 96;
+    constexpr size_t NAME_LEN = 48;
+
+    /** bucket b counts runs that took [2^(b-1), 2^b) ns, the last bucket
+     * counts everything longer */
+    constexpr size_t EXEC_HISTOGRAM_BUCKETS = 32;
+
+    enum TaskKind : uint32_t
+    {
+        PERIODIC = 0,
+        IDLE = 1,
+        SERVER = 2
+    };
+
+    struct TaskStats
+    {
+        char name[NAME_LEN];
+        uint32_t id;
+        uint32_t kind; // a TaskKind
+        int64_t period_ns;
+        uint64_t runs;
+        uint64_t deadline_misses;
+        int64_t max_exec_ns;
+        int64_t total_exec_ns;
+        int64_t last_release_lateness_ns;
+        int64_t max_release_lateness_ns;
+        uint64_t exec_histogram[EXEC_HISTOGRAM_BUCKETS];
+    };
+
+    struct KernelStats
+    {
+        /** odd while the kernel is writing, only accessed through
+         * std::atomic_ref, see StatsReader::read_kernel() */
+        uint64_t seq;
+
+        char name[NAME_LEN];
+        uint32_t core;
+        uint32_t num_tasks;
+
+        /** heartbeat: the kernel's time of this update and its steps */
+        int64_t published_at_ns;
+        uint64_t steps;
+        uint64_t deadline_misses;
+
+        /** time since run() started and how much of it tasks ran */
+        int64_t elapsed_ns;
+        int64_t busy_ns;
+
+        /** time left before the next release when the kernel ran out of
+         * periodic work: the slack idle tasks can use */
+        int64_t last_slack_ns;
+        int64_t min_slack_ns;
+
+        TaskStats tasks[MAX_TASKS];
+
+        /** since version 2: the rest of the time since run() started,
+         * see CoreAccounting. busy_ns is the time in task bodies. */
+        int64_t spin_ns;
+        int64_t idle_sweep_ns;
+        int64_t sleep_ns;
+        int64_t overhead_ns;
+
+        /** since version 3: how many tasks the kernel has. More than
+         * num_tasks when only the first MAX_TASKS of them fit in tasks[]. */
+        uint32_t total_tasks;
+        uint32_t unused;
+    };
+
+    /** how much of a KernelStats a writer of 'version' fills in */
+    constexpr size_t kernel_stats_size(uint32_t version)
+    {
+        switch (version)
+        {
+        case 1:
+            return offsetof(KernelStats, spin_ns);
+        case 2:
+            return offsetof(KernelStats, total_tasks);
+        default:
+            return sizeof(KernelStats);
+        }
+    }
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t header_size;
+        uint32_t kernel_stats_size;
+        uint32_t task_stats_size;
+        uint32_t num_kernels;
+        int64_t pid;
+    };
+
+    struct Segment
+    {
+        Header header;
+        KernelStats kernels[MAX_KERNELS];
+    };
+} // namespace stats_layout
+
+
+/** Creates (and when destroyed removes) a POSIX shared memory segment with
+ * the stats_layout, see MultiCoreRealtimeKernel::set_stats_segment().
+ * Kernels write their slot with RealtimeKernel::set_stats_slot(). A segment
+ * of the same name is only replaced when the process in its header is
+ * gone, otherwise ok() is false.
+ */
+class StatsSegment
+{
+public:
+    /** 'name' as for shm_open(), e.g. "/urtsched" */
+    StatsSegment(const std::string& name, uint32_t num_kernels,
+        logging::ILogger& logger);
+    ~StatsSegment();
+
+    StatsSegment(const StatsSegment&) = delete;
+    StatsSegment& operator=(const StatsSegment&) = delete;
+
+    bool ok() const
+    {
+        return m_segment != nullptr;
+    }
+
+    stats_layout::KernelStats* kernel_slot(uint32_t ix);
+
+private:
+    const std::string m_name;
+    stats_layout::Segment* m_segment = nullptr;
+};
+
+
+/** Reads a StatsSegment from another process. Never blocks the writers. */
+class StatsReader
+{
+public:
+    explicit StatsReader(const std::string& name);
+    ~StatsReader();
+
+    StatsReader(const StatsReader&) = delete;
+    StatsReader& operator=(const StatsReader&) = delete;
+
+    /** false if there's no such segment or it isn't one of ours */
+    bool ok() const
+    {
+        return m_segment != nullptr;
+    }
+
+    /** the layout version of the writer. Fields of later versions read as
+     * 0, except total_tasks, which is num_tasks before version 3. */
+    uint32_t get_version() const
+    {
+        return m_segment ? m_segment->header.version : 0;
+    }
+
+    uint32_t get_num_kernels() const;
+
+    int64_t get_pid() const;
+
+    /** copies a consistent snapshot of kernel 'ix' into 'out'. Returns false
+     * if the kernel kept updating it while we tried. */
+    bool read_kernel(uint32_t ix, stats_layout::KernelStats& out) const;
+
+private:
+    const stats_layout::Segment* m_segment = nullptr;
+    size_t m_size = 0;
+
+    const stats_layout::KernelStats& kernel(uint32_t ix) const;
+};
+
+} // namespace realtime
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace service
+{
+
+enum class StatusFormat
+{
+    JSON,
+    /** A tagged encoding of the same tree that skips number formatting,
+     * see status_to_json().
+     * It starts with "URSB" and a version byte, then one entry per value:
+     * a tag byte, the key if inside an object (uint8 length + bytes) and
+     * the value (little-endian int64/uint64/double, uint8 bool, uint16
+     * length + bytes for strings, uint32 length + bytes for raw json).
+     */
+    BINARY
+};
+
+/** Serializes status into a caller-provided buffer without allocating.
+ * When the buffer is too small the output is cut off (possibly mid-value)
+ * and bytes_needed() tells how big it would have had to be.
+ * Objects and arrays nested deeper than MAX_DEPTH are left out, with all
+ * they contain, see too_deep(). Doubles that are not finite are written
+ * as null in json.
+ */
+class StatusWriter
+{
+public:
+    static constexpr uint8_t BINARY_VERSION = 1;
+    static constexpr size_t MAX_DEPTH = 16;
+
+    enum Tag : uint8_t
+    {
+        TAG_OBJECT_BEGIN = 1,
+        TAG_OBJECT_END = 2,
+        TAG_ARRAY_BEGIN = 3,
+        TAG_ARRAY_END = 4,
+        TAG_INT = 5,
+        TAG_UINT = 6,
+        TAG_DOUBLE = 7,
+        TAG_STRING = 8,
+        TAG_BOOL = 9,
+        TAG_RAW_JSON = 10
+    };
+
+    StatusWriter(std::span<char> buffer, StatusFormat format = StatusFormat::JSON);
+
+    StatusFormat get_format() const
+    {
+        return m_format;
+    }
+
+    /** an object as an array element (or the top level) */
+    void begin_object();
+    /** an object as the member 'key' of the enclosing object */
+    void begin_object(std::string_view key);
+    void end_object();
+
+    void begin_array();
+    void begin_array(std::string_view key);
+    void end_array();
+
+    void value(std::string_view key, std::string_view v);
+    void value(std::string_view key, const char* v)
+    {
+        value(key, std::string_view(v));
+    }
+    void value(std::string_view key, bool v);
+    void value(std::string_view key, double v);
+
+    template <std::integral T> void value(std::string_view key, T v)
+    {
+        if constexpr (std::is_signed_v<T>)
+        {
+            put_int(key, (int64_t) v);
+        }
+        else
+        {
+            put_uint(key, (uint64_t) v);
+        }
+    }
+
+    /** a duration, in seconds as elsewhere in the status */
+    void seconds(std::string_view key, std::chrono::nanoseconds d)
+    {
+        value(key, (double) d.count() / (1000.0 * 1000.0 * 1000.0));
+    }
+
+    /** an already serialized json value, e.g. from a service that only
+     * implements IService::get_service_status_as_json() */
+    void raw_json(std::string_view json);
+
+    /** bytes written to the buffer */
+    size_t size() const
+    {
+        return m_pos < m_buffer.size() ? m_pos : m_buffer.size();
+    }
+
+    /** bytes the complete status takes */
+    size_t bytes_needed() const
+    {
+        return m_pos;
+    }
+
+    bool truncated() const
+    {
+        return m_pos > m_buffer.size();
+    }
+
+    /** whether objects or arrays nested too deeply were left out */
+    bool too_deep() const
+    {
+        return m_too_deep;
+    }
+
+    std::string_view view() const
+    {
+        return std::string_view(m_buffer.data(), size());
+    }
+
+private:
+    std::span<char> m_buffer;
+    const StatusFormat m_format;
+    size_t m_pos = 0;
+    size_t m_depth = 0;
+    // levels below MAX_DEPTH that are being left out:
+    size_t m_skipped_depth = 0;
+    bool m_too_deep = false;
+    // per nesting level: inside an object (else an array), and whether the
+    // next element needs a comma:
+    bool m_in_object[MAX_DEPTH] = {};
+    bool m_need_comma[MAX_DEPTH] = {};
+
+    void put(const void* data, size_t n);
+    void put_char(char c)
+    {
+        put(&c, 1);
+    }
+    template <typename T> void put_raw(const T& v)
+    {
+        put(&v, sizeof(v));
+    }
+    void put_escaped(std::string_view s);
+
+    /** starts an element: separator and key. false if it is left out. */
+    bool element(std::string_view key, Tag tag);
+    void begin(std::string_view key, Tag tag, bool object);
+    void end(Tag tag);
+    void put_int(std::string_view key, int64_t v);
+    void put_uint(std::string_view key, uint64_t v);
+};
+
+
+/** Run 'f' with a StatusWriter and return its output as a string,
+ * growing the buffer as needed. For convenience APIs, this allocates.
+ */
+template <typename F>
+std::string write_status_to_string(F&& f, StatusFormat format = StatusFormat::JSON)
+{
+    std::string ret(4096, '\0');
+    while (true)
+    {
+        StatusWriter w(std::span<char>(ret.data(), ret.size()), format);
+        f(w);
+        if (!w.truncated())
+        {
+            ret.resize(w.size());
+            return ret;
+        }
+        ret.resize(w.bytes_needed());
+    }
+}
+
+
+/** decodes StatusFormat::BINARY into json,
+ * returns false if 'binary' is not a complete encoding */
+bool status_to_json(std::span<const char> binary, std::string& json);
+
+} // namespace service
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <urtsched/IService.hpp>
+
+#include "PeriodicTask.hpp"
+#include "task_defs.hpp"
+
+namespace realtime
+{
+class RealtimeKernel;
+
+/** end-to-end latencies of a TaskChain, from the release of its source to
+ * the completion of a last stage (one without successors) in the same
+ * period. With several last stages each of them counts. */
+struct ChainLatency
+{
+    uint64_t count = 0;
+    uint64_t deadline_misses = 0;
+    std::chrono::nanoseconds last = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds max = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds total = std::chrono::nanoseconds(0);
+
+    std::chrono::nanoseconds average() const
+    {
+        return count ? total / (int64_t) count : std::chrono::nanoseconds(0);
+    }
+};
+
+
+/** what TaskChain::analyze() found */
+struct ChainAnalysis
+{
+    /** the latency of the critical path when every stage takes its
+     * worst-case execution time and is blocked by the longest other task
+     * of its kernel first (our kernels don't preempt) */
+    std::chrono::nanoseconds worst_case_latency = std::chrono::nanoseconds(0);
+
+    /** the stages of the longest path, source first */
+    std::vector<std::string> critical_path;
+
+    /** why the chain cannot meet its deadline */
+    std::vector<std::string> problems;
+
+    /** e.g. stages that never ran, so nothing is known about them */
+    std::vector<std::string> warnings;
+
+    bool feasible() const
+    {
+        return problems.empty();
+    }
+};
+
+
+/** A pipeline of periodic stages, e.g. read -> filter -> publish, on one
+ * or several kernels (e.g. the cores of a MultiCoreRealtimeKernel).
+ * The source is released every period, every other stage as soon as all
+ * its predecessors completed the same period, not at a phase offset of
+ * its own. Stages are periodic tasks of their kernels whose period is the
+ * chain's, so their release lateness and deadline misses count as usual.
+ *
+ * Create it with std::make_shared and add all stages before the kernels
+ * run. It is a service so its status (the end-to-end latency) can be
+ * published on a ServiceBus.
+ */
+class TaskChain : public service::IService,
+                  public std::enable_shared_from_this<TaskChain>
+{
+public:
+    static constexpr size_t MAX_STAGES = 16;
+
+    /** 'deadline' is the end-to-end deadline, 0 for the period */
+    TaskChain(const std::string& name, std::chrono::microseconds period,
+        std::chrono::microseconds deadline = std::chrono::microseconds(0));
+
+    const std::string& get_name() const
+    {
+        return m_name;
+    }
+
+    std::chrono::microseconds get_period() const
+    {
+        return m_period;
+    }
+
+    std::chrono::microseconds get_deadline() const
+    {
+        return m_deadline;
+    }
+
+    /** Add the first stage, a periodic task on 'kernel'. 'wcet' is the
+     * execution time analyze() assumes, 0 for the measured (or seeded)
+     * maximum. The task is disabled, like the ones of add_periodic().
+     * returns nullptr if the chain has a source already or is full.
+     */
+    [[nodiscard]] std::shared_ptr<PeriodicTask> add_source(
+        RealtimeKernel& kernel, TaskType tt, const std::string& name,
+        const task_func_t& callback,
+        std::chrono::nanoseconds wcet = std::chrono::nanoseconds(0));
+
+    /** Add a stage on 'kernel' that is released once all of 'after',
+     * stages of this chain on any kernels, completed the current period.
+     * returns nullptr if 'after' is empty or holds tasks of another chain,
+     * or if the chain or 'kernel' is full.
+     */
+    [[nodiscard]] std::shared_ptr<PeriodicTask> add_stage(
+        RealtimeKernel& kernel, TaskType tt, const std::string& name,
+        const task_func_t& callback,
+        const std::vector<std::shared_ptr<PeriodicTask>>& after,
+        std::chrono::nanoseconds wcet = std::chrono::nanoseconds(0));
+
+    /** may be called from any thread */
+    ChainLatency get_latency() const;
+
+    /** The worst-case end-to-end latency from the stages' execution times
+     * and what else runs on their kernels. Best before the kernels run or
+     * after they stopped, else the times it reads may be a bit stale.
+     */
+    ChainAnalysis analyze() const;
+
+    [[nodiscard]] error::Error init() override
+    {
+        return error::Error::OK;
+    }
+
+    [[nodiscard]] error::Error finish() override
+    {
+        return error::Error::OK;
+    }
+
+    std::string get_service_status_as_json() const override;
+
+    void write_status(service::StatusWriter& w) const override;
+
+private:
+    friend class RealtimeKernel;
+
+    struct Stage
+    {
+        std::shared_ptr<PeriodicTask> task;
+        RealtimeKernel* kernel = nullptr;
+        std::vector<size_t> after;
+        bool is_last = true;
+        std::chrono::nanoseconds wcet = std::chrono::nanoseconds(0);
+
+        // written by the stage's kernel only:
+        uint64_t released_period = 0;
+        // the last period it completed, read by the successors' kernels:
+        std::atomic<uint64_t> completed_period = 0;
+    };
+
+    // release times of the last periods, to measure the latency at the end
+    static constexpr size_t RELEASE_HISTORY = 64;
+
+    const std::string m_name;
+    const std::chrono::microseconds m_period;
+    const std::chrono::microseconds m_deadline;
+
+    std::vector<std::unique_ptr<Stage>> m_stages;
+    std::array<std::atomic<int64_t>, RELEASE_HISTORY> m_release_ns{};
+
+    std::atomic<uint64_t> m_latency_count = 0;
+    std::atomic<uint64_t> m_latency_misses = 0;
+    std::atomic<int64_t> m_latency_last_ns = 0;
+    std::atomic<int64_t> m_latency_max_ns = 0;
+    std::atomic<int64_t> m_latency_total_ns = 0;
+
+    std::shared_ptr<PeriodicTask> add(RealtimeKernel& kernel, TaskType tt,
+        const std::string& name, const task_func_t& callback,
+        std::vector<size_t> after, std::chrono::nanoseconds wcet);
+
+    /** the completion hook of every stage */
+    void stage_completed(Stage& stage, const BaseTask& task,
+        std::chrono::nanoseconds completed_at);
+
+    /** open the gates of the stages on 'kernel' whose predecessors
+     * completed, from its thread. returns true if it released one */
+    bool release_ready_stages(const RealtimeKernel& kernel);
+
+    void record_latency(std::chrono::nanoseconds latency);
+};
+
+} // namespace realtime
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BaseTask.hpp"
+
+namespace realtime
+{
+
+/** a task that is part of a mode, see RealtimeKernel::define_mode() */
+struct ModeTask
+{
+    std::shared_ptr<BaseTask> task;
+
+    /** the period the task runs at in this mode, 0 keeps the current period */
+    std::chrono::microseconds period = std::chrono::microseconds(0);
+};
+
+/** where a requested mode change is allowed to happen */
+enum class ModeChangeBoundary
+{
+    /** at the next release of the scheduler, i.e. between two tasks */
+    RELEASE,
+
+    /** at the end of the current mode's hyperperiod, so every task of the
+     * current mode completes all its jobs of the hyperperiod first */
+    HYPERPERIOD
+};
+
+/** a named set of tasks that are enabled together */
+struct TaskMode
+{
+    std::string name;
+    std::vector<ModeTask> tasks;
+
+    /** least common multiple of the periods of the periodic tasks */
+    std::chrono::microseconds hyperperiod = std::chrono::microseconds(0);
+};
+
+} // namespace realtime
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <urtsched/BaseTask.hpp>
+
+namespace realtime
+{
+class RealtimeKernel;
+
+/** what a task learned about its execution times, see
+ * BaseTask::seed_profile() */
+struct TaskProfile
+{
+    std::string name;
+    std::chrono::microseconds period = std::chrono::microseconds(0);
+    uint64_t num_calls = 0;
+    std::chrono::nanoseconds max_time_taken = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds warmup_max_time_taken = std::chrono::nanoseconds(0);
+    std::chrono::microseconds total_time_taken = std::chrono::microseconds(0);
+    std::array<uint64_t, BaseTask::EXEC_HISTOGRAM_BUCKETS> exec_histogram{};
+};
+
+
+/** Keeps the TaskProfiles of a kernel's tasks across restarts, see
+ * RealtimeKernel::set_profile_store(): tasks added to the kernel start
+ * from the profile of the same name instead of from zero.
+ *
+ * File format, all little-endian:
+ *   "URTPRF\0\0", uint32 version, uint16 length + kernel name,
+ *   uint32 number of histogram buckets, uint32 number of profiles, then per
+ *   profile: uint16 length + name, int64 period us, uint64 calls,
+ *   int64 max ns, int64 warmup max ns, int64 total us, the buckets as uint64
+ *   and at the end a uint64 FNV-1a hash of everything before it.
+ */
+class TaskProfileStore
+{
+public:
+    static constexpr uint32_t VERSION = 1;
+
+    explicit TaskProfileStore(const std::string& kernel_name)
+        : m_kernel_name(kernel_name)
+    {
+    }
+
+    ~TaskProfileStore()
+    {
+        stop();
+    }
+
+    TaskProfileStore(const TaskProfileStore&) = delete;
+    TaskProfileStore& operator=(const TaskProfileStore&) = delete;
+
+    /** Replaces the profiles with the ones in 'path'. Returns false, and
+     * keeps what we had, if the file is missing, of another version or
+     * kernel, or corrupt. */
+    bool load(const std::filesystem::path& path);
+
+    /** write the profiles to 'path' (via a temporary file and rename(),
+     * so a crash never leaves half a file behind) */
+    bool save(const std::filesystem::path& path) const;
+
+    /** save() to 'path' every 'interval' from a thread of our own, the
+     * kernel only copies its tasks' profiles into the store */
+    void start(const std::filesystem::path& path,
+        std::chrono::milliseconds interval);
+
+    void stop();
+
+    /** Copy the profiles of all of 'kernel's tasks into the store, keeping
+     * the ones of tasks it doesn't have (anymore). From the kernel's thread
+     * or while it does not run. With 'wait' false, as from the real-time
+     * loop, it gives up, returning false, while save() is busy, so the
+     * kernel never blocks on it, and it never allocates: only tasks the
+     * store has a profile for are copied, see seed().
+     */
+    bool capture(const RealtimeKernel& kernel, bool wait = true);
+
+    /** seed 'task' with the profile of its name, returns false if there is
+     * none. Either way the store makes room for the task's profile, so
+     * capture() can copy it from the real-time loop. Not for the real-time
+     * loop: the kernel calls it when a task is added. */
+    bool seed(BaseTask& task);
+
+    size_t size() const;
+
+    /** a copy of the profile named 'name', if any */
+    bool find(const std::string& name, TaskProfile& out) const;
+
+private:
+    const std::string m_kernel_name;
+
+    mutable std::mutex m_mutex;
+    std::vector<TaskProfile> m_profiles;
+
+    std::thread m_thread;
+    std::condition_variable m_cond;
+    bool m_stop = false;
+
+    void capture_locked(const BaseTask& task, bool allocate);
+    const TaskProfile* find_locked(const std::string& name) const;
+};
+
+} // namespace realtime
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <urtsched/mpsc_queue.hpp>
+#include <urtsched/task_defs.hpp>
+
+namespace realtime
+{
+class BaseTask;
+
+enum class RecordedTaskKind : uint8_t
+{
+    PERIODIC,
+    IDLE,
+    SERVER
+};
+
+/** one run of a task. All times are of the kernel's timer. */
+struct TaskRecord
+{
+    uint32_t task_id = 0;
+    uint32_t status = 0; // a TaskStatus
+    int64_t release_ns = 0;
+    int64_t start_ns = 0;
+    int64_t duration_ns = 0;
+};
+static_assert(sizeof(TaskRecord) == 32);
+
+struct RecordedTask
+{
+    uint32_t id = 0;
+    RecordedTaskKind kind = RecordedTaskKind::PERIODIC;
+    TaskType type = TaskType::HARD_REALTIME;
+    std::chrono::nanoseconds period = std::chrono::nanoseconds(0);
+    std::string name;
+};
+
+/** what TaskRecorder::load() read back from a file */
+struct Recording
+{
+    std::string kernel_name;
+    std::vector<RecordedTask> tasks;
+    std::vector<TaskRecord> records;
+
+    const RecordedTask* find_task(uint32_t id) const;
+
+    /** the durations of the runs of task 'id', in order */
+    std::vector<std::chrono::nanoseconds> durations_of(uint32_t id) const;
+
+    /** from the first release to the end of the last run */
+    std::chrono::nanoseconds span() const;
+};
+
+
+/** Records every run of a kernel's tasks, see RealtimeKernel::set_recorder().
+ *
+ * The kernel only pushes a fixed-size record into a lock-free ring per run.
+ * A non real-time thread (start(), or whoever calls drain()) writes them to
+ * a file. Records are dropped, and counted, when the ring is full.
+ *
+ * File format, all little-endian:
+ *   header: "URTREC\0\0", uint32 version, uint16 length + kernel name
+ *   then chunks, each starting with a uint8 tag:
+ *     TASK:    uint32 id, uint8 kind, uint8 type, int64 period ns,
+ *              uint16 length + name
+ *     RECORDS: uint32 count, count * TaskRecord
+ * A task's TASK chunk always comes before its first record.
+ */
+class TaskRecorder
+{
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t RING_SIZE = 8192;
+
+    explicit TaskRecorder(const std::string& kernel_name)
+        : m_kernel_name(kernel_name)
+    {
+    }
+
+    ~TaskRecorder()
+    {
+        close();
+    }
+
+    TaskRecorder(const TaskRecorder&) = delete;
+    TaskRecorder& operator=(const TaskRecorder&) = delete;
+
+    /** start a new file, returns false if it can't be created */
+    bool open(const std::filesystem::path& path);
+
+    /** stops draining, writes what is left and closes the file */
+    void close();
+
+    /** drain to the file every 'interval' from a thread of our own */
+    void start(std::chrono::milliseconds interval);
+
+    void stop();
+
+    /** write all pending records to the file, returns how many.
+     * Not for the real-time loop, but any other thread may call it while
+     * start()'s thread drains too, e.g. the Watchdog.
+     */
+    size_t drain();
+
+    /** add a task to the task table. Not for the real-time loop: the
+     * kernel calls it when a task is added. */
+    void register_task(const BaseTask& task, RecordedTaskKind kind);
+
+    /** called by the kernel after each run, lock-free */
+    void record(const TaskRecord& r)
+    {
+        if (!m_ring.try_push(r))
+        {
+            m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t get_num_dropped() const
+    {
+        return m_num_dropped.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_num_written() const
+    {
+        return m_num_written;
+    }
+
+    /** nullopt for files of another format or version, and for batches
+     * that claim more records than the file holds */
+    static std::optional<Recording> load(const std::filesystem::path& path);
+
+private:
+    enum Tag : uint8_t
+    {
+        TAG_TASK = 1,
+        TAG_RECORDS = 2
+    };
+
+    const std::string m_kernel_name;
+    mpsc_queue<TaskRecord, RING_SIZE> m_ring;
+    std::atomic<uint64_t> m_num_dropped = 0;
+    // the ring has a single consumer, and m_batch is its buffer:
+    std::mutex m_drain_mutex;
+
+    // guards the task table and the file:
+    std::mutex m_mutex;
+    std::vector<RecordedTask> m_tasks;
+    size_t m_tasks_written = 0;
+    FILE* m_file = nullptr;
+    uint64_t m_num_written = 0;
+    std::vector<TaskRecord> m_batch;
+
+    std::thread m_thread;
+    std::condition_variable m_cond;
+    bool m_stop = false;
+
+    void write_new_tasks();
+};
+
+} // namespace realtime
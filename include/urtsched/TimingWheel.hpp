@@ -0,0 +1,184 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace realtime
+{
+
+using timer_func_t = std::function<void()>;
+
+/** Refers to a timer of a TimingWheel. Stays safe to use after the timer
+ * fired or was cancelled, even once its slot is reused. */
+struct TimerHandle
+{
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    uint32_t index = NONE;
+    uint32_t generation = 0;
+
+    bool valid() const
+    {
+        return index != NONE;
+    }
+};
+
+
+struct TimerConfig
+{
+    /** timers that can be pending at once, all allocated up front */
+    size_t capacity = 16384;
+
+    /** timers fire at the first tick at or after their time */
+    std::chrono::nanoseconds tick = std::chrono::microseconds(100);
+};
+
+
+struct TimerStats
+{
+    uint64_t scheduled = 0;
+    uint64_t fired = 0;
+    uint64_t cancelled = 0;
+    /** schedules that failed because all timers were pending */
+    uint64_t full = 0;
+    size_t max_pending = 0;
+    /** from the time a timer was due to its callback */
+    std::chrono::nanoseconds max_lateness = std::chrono::nanoseconds(0);
+};
+
+
+/** A hierarchical timing wheel: LEVELS wheels of SLOTS slots, each slot of
+ * a level spanning a whole turn of the level below. A timer goes into the
+ * lowest level whose current turn contains its tick and moves down a level
+ * each time its slot comes up, so scheduling and cancelling are O(1) and
+ * expiring costs O(1) per timer plus a step per occupied slot or turn of
+ * the lowest level. Timers beyond the top level wait in an overflow list.
+ * The timers are preallocated, the wheel never allocates after its
+ * construction (apart from callbacks too big for std::function's own
+ * storage). Not thread-safe, see RealtimeKernel::schedule_after().
+ */
+class TimingWheel
+{
+public:
+    static constexpr size_t LEVELS = 4;
+    static constexpr size_t SLOT_BITS = 6;
+    static constexpr size_t SLOTS = 1 << SLOT_BITS;
+
+    TimingWheel(const TimerConfig& config, std::chrono::nanoseconds now);
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    /** Call 'fn' from expire() once 'time' has passed. Returns an invalid
+     * handle if all timers are pending. */
+    TimerHandle schedule_at(std::chrono::nanoseconds time, timer_func_t fn);
+
+    /** returns false if the timer fired or was cancelled already */
+    bool cancel(TimerHandle h);
+
+    bool is_pending(TimerHandle h) const;
+
+    /** Run the callbacks of the timers that are due at 'now', at most
+     * 'max' of them (the others stay due). Callbacks may schedule and
+     * cancel timers, the ones they make due run in the next call. Returns
+     * how many ran. */
+    size_t expire(std::chrono::nanoseconds now, size_t max = SIZE_MAX);
+
+    /** expire() one callback at a time: set the timers due at 'now' aside
+     * (behind those left over from an earlier call), then run them with
+     * expire_next(). */
+    void begin_expire(std::chrono::nanoseconds now);
+
+    /** Run the next timer set aside by begin_expire(), false if there's
+     * none left. Timers made due meanwhile wait for the next
+     * begin_expire(), so a callback that schedules itself again right away
+     * can't keep this going. */
+    bool expire_next(std::chrono::nanoseconds now);
+
+    /** no pending timer is due before this, max() if there are none */
+    std::chrono::nanoseconds next_expiry_bound() const;
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    size_t capacity() const
+    {
+        return m_nodes.size();
+    }
+
+    std::chrono::nanoseconds get_tick() const
+    {
+        return m_tick;
+    }
+
+    const TimerStats& get_stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+    static constexpr uint16_t NO_LIST = UINT16_MAX;
+    // the lists after the slots of all levels:
+    static constexpr uint16_t DUE_LIST = LEVELS * SLOTS;
+    static constexpr uint16_t OVERFLOW_LIST = DUE_LIST + 1;
+    // set aside by begin_expire():
+    static constexpr uint16_t EXPIRING_LIST = OVERFLOW_LIST + 1;
+    static constexpr size_t NUM_LISTS = EXPIRING_LIST + 1;
+
+    struct Node
+    {
+        timer_func_t fn;
+        uint64_t tick = 0;
+        uint32_t prev = NIL;
+        uint32_t next = NIL;
+        uint32_t generation = 0;
+        uint16_t list = NO_LIST;
+    };
+
+    struct List
+    {
+        uint32_t head = NIL;
+        uint32_t tail = NIL;
+    };
+
+    const std::chrono::nanoseconds m_tick;
+    std::vector<Node> m_nodes;
+    std::array<List, NUM_LISTS> m_lists{};
+    // a bit per non-empty slot of each level:
+    std::array<uint64_t, LEVELS> m_occupied{};
+    // the last tick we processed:
+    uint64_t m_current = 0;
+    uint32_t m_free = NIL;
+    size_t m_size = 0;
+    // pending in the levels (not due or overflowing):
+    size_t m_in_wheel = 0;
+    TimerStats m_stats;
+
+    /** put 'ix' into the list its tick belongs to now */
+    void place(uint32_t ix);
+    void link(uint32_t ix, uint16_t list);
+    void unlink(uint32_t ix);
+    /** re-place all timers of 'list' */
+    void replace_all(uint16_t list);
+    /** move all timers of 'list' to the end of list 'to' */
+    void move_all(uint16_t list, uint16_t to);
+    /** the next tick after m_current where a slot comes up that has
+     * timers or must move timers down */
+    uint64_t next_work_tick() const;
+    /** advance to tick 't', a next_work_tick() */
+    void advance_to(uint64_t t);
+};
+
+} // namespace realtime
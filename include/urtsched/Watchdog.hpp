@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <slogger/ILogger.hpp>
+#include <slogger/ITimer.hpp>
+
+#include <urtsched/RealtimeKernel.hpp>
+
+namespace realtime
+{
+
+/** what the watchdog does when it detects a problem */
+struct WatchdogActions
+{
+    /** log the heartbeat of every kernel */
+    bool log_status = true;
+
+    /** disable the task that is running on the stalled core */
+    bool disable_task = false;
+
+    /** request all kernels to stop */
+    bool request_shutdown = false;
+
+    /** write what is in the affected kernel's TaskRecorder ring to its file
+     * right away, so the runs that led up to the problem are kept even if
+     * the process doesn't get much further */
+    bool dump_trace = false;
+};
+
+struct WatchdogEvent
+{
+    enum class Kind
+    {
+        STALLED_CORE,
+        RUNAWAY_TASK,
+        DEADLINE_MISSES
+    };
+
+    Kind kind;
+    std::shared_ptr<RealtimeKernel> kernel;
+    KernelHeartbeat heartbeat;
+};
+
+struct WatchdogConfig
+{
+    /** how often the watchdog looks at the kernels */
+    std::chrono::milliseconds check_interval = std::chrono::milliseconds(100);
+
+    /** a core that did not finish a step for this long is stalled */
+    std::chrono::milliseconds stall_timeout = std::chrono::milliseconds(1000);
+
+    /** a single task that runs for this long is a runaway */
+    std::chrono::milliseconds runaway_timeout = std::chrono::milliseconds(10);
+
+    /** more deadline misses than this within one check_interval */
+    uint64_t max_deadline_misses = 10;
+
+    WatchdogActions on_stall{ true, false, true };
+    WatchdogActions on_runaway{ true, true, false };
+    WatchdogActions on_deadline_misses{ true, false, false };
+
+    /** called from the watchdog's thread for every detected problem */
+    std::function<void(const WatchdogEvent&)> on_event;
+};
+
+/** Monitors the heartbeats of a set of kernels from a (non-realtime)
+ * thread of its own. The kernels are not slowed down by it: they only
+ * publish a few counters once per step.
+ */
+class Watchdog
+{
+public:
+    Watchdog(time_utils::ITimer& timer, logging::ILogger& logger,
+        const WatchdogConfig& config,
+        const std::vector<std::shared_ptr<RealtimeKernel>>& kernels)
+        : m_timer(timer)
+        , m_logger(logger)
+        , m_config(config)
+        , m_kernels(kernels)
+    {
+    }
+
+    ~Watchdog()
+    {
+        stop();
+    }
+
+    void start();
+
+    /** stops the monitoring thread, returns once it has exited */
+    void stop();
+
+    /** look at all kernels once. start() calls this every check_interval */
+    void check();
+
+    uint64_t get_num_events() const
+    {
+        return m_num_events.load(std::memory_order_relaxed);
+    }
+
+    logging::ILogger& get_logger() const
+    {
+        return m_logger;
+    }
+
+private:
+    struct KernelState
+    {
+        KernelHeartbeat last;
+        std::chrono::nanoseconds last_progress = std::chrono::nanoseconds(0);
+        uint32_t reported_runaway = 0;
+        bool reported_stall = false;
+    };
+
+    time_utils::ITimer& m_timer;
+    logging::ILogger& m_logger;
+    const WatchdogConfig m_config;
+    const std::vector<std::shared_ptr<RealtimeKernel>> m_kernels;
+    std::vector<KernelState> m_state;
+    // counted on the watchdog's thread, read from any:
+    std::atomic<uint64_t> m_num_events = 0;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_stop = false;
+
+    void handle(WatchdogEvent::Kind kind, const WatchdogActions& actions,
+        const std::shared_ptr<RealtimeKernel>& kernel,
+        const KernelHeartbeat& hb);
+};
+
+} // namespace realtime
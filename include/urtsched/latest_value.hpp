@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <slogger/ITimer.hpp>
+
+#include <urtsched/StatusWriter.hpp>
+
+namespace realtime
+{
+
+/** the part of a latest_value that doesn't depend on its type: its name
+ * and statistics, see RealtimeKernel::add_latest_value().
+ * The ages of the values read are only measured with a timer, which costs
+ * a timer read on both sides.
+ */
+class latest_value_base
+{
+public:
+    latest_value_base(time_utils::ITimer* timer, const std::string& name)
+        : m_timer(timer)
+        , m_name(name)
+    {
+    }
+
+    latest_value_base(const latest_value_base&) = delete;
+    latest_value_base& operator=(const latest_value_base&) = delete;
+
+    const std::string& get_name() const
+    {
+        return m_name;
+    }
+
+    /** the statistics may be read from any thread */
+    uint64_t get_num_publishes() const
+    {
+        return m_num_publishes.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_num_reads() const
+    {
+        return m_num_reads.load(std::memory_order_relaxed);
+    }
+
+    /** reads that found a value published since the previous read */
+    uint64_t get_num_fresh_reads() const
+    {
+        return m_num_fresh_reads.load(std::memory_order_relaxed);
+    }
+
+    /** values that were replaced before the reader saw them */
+    uint64_t get_num_overwritten() const
+    {
+        return m_num_overwritten.load(std::memory_order_relaxed);
+    }
+
+    /** how old the value was that the last read returned */
+    std::chrono::nanoseconds get_last_age() const
+    {
+        return std::chrono::nanoseconds(
+            m_last_age_ns.load(std::memory_order_relaxed));
+    }
+
+    std::chrono::nanoseconds get_max_age() const
+    {
+        return std::chrono::nanoseconds(
+            m_max_age_ns.load(std::memory_order_relaxed));
+    }
+
+    void write_status(service::StatusWriter& w) const
+    {
+        w.begin_object();
+        w.value("name", m_name);
+        w.value("publishes", get_num_publishes());
+        w.value("reads", get_num_reads());
+        w.value("fresh_reads", get_num_fresh_reads());
+        w.value("overwritten", get_num_overwritten());
+        w.seconds("last_age", get_last_age());
+        w.seconds("max_age", get_max_age());
+        w.end_object();
+    }
+
+protected:
+    time_utils::ITimer* m_timer = nullptr;
+
+    // the writer's:
+    alignas(64) std::atomic<uint64_t> m_num_publishes = 0;
+
+    // the reader's:
+    alignas(64) std::atomic<uint64_t> m_num_reads = 0;
+    std::atomic<uint64_t> m_num_fresh_reads = 0;
+    std::atomic<uint64_t> m_num_overwritten = 0;
+    std::atomic<int64_t> m_last_age_ns = 0;
+    std::atomic<int64_t> m_max_age_ns = 0;
+
+private:
+    const std::string m_name;
+};
+
+
+/** The latest consistent T from one writer to one reader, e.g. an
+ * estimator's output for a controller running at another rate, on the same
+ * core or on another one. Neither side ever blocks or copies a T: the
+ * writer fills a buffer in place and publishes it, the reader gets a
+ * reference to the newest published buffer, which stays valid and
+ * unchanged until its next read(). Three buffers make that possible, the
+ * hand-over is a single atomic exchange on either side.
+ */
+template <typename T> class latest_value : public latest_value_base
+{
+public:
+    latest_value(time_utils::ITimer* timer, const std::string& name)
+        : latest_value_base(timer, name)
+    {
+    }
+
+    /** Writer only: the buffer to fill for the next publish(). It holds an
+     * older value, not the last published one, so write all of it. */
+    T& write_buffer()
+    {
+        return m_slots[m_back].value;
+    }
+
+    /** Writer only: make the write_buffer() the latest value */
+    void publish()
+    {
+        auto& slot = m_slots[m_back];
+        const auto n = m_num_publishes.load(std::memory_order_relaxed) + 1;
+        slot.sequence = n;
+        if (m_timer)
+        {
+            slot.published_ns = m_timer->get_time_ns().count();
+        }
+        m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) &
+            INDEX;
+        m_num_publishes.store(n, std::memory_order_relaxed);
+    }
+
+    /** Writer only: copies, for small values */
+    void publish(const T& value)
+    {
+        write_buffer() = value;
+        publish();
+    }
+
+    /** Reader only: the latest published value (a default constructed T
+     * before the first publish()) */
+    const T& read()
+    {
+        if (m_middle.load(std::memory_order_relaxed) & FRESH)
+        {
+            const auto previous = m_slots[m_front].sequence;
+            m_front =
+                m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+            const auto skipped = m_slots[m_front].sequence - previous - 1;
+            m_num_fresh_reads.store(
+                m_num_fresh_reads.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+            if (skipped > 0)
+            {
+                m_num_overwritten.store(
+                    m_num_overwritten.load(std::memory_order_relaxed) +
+                        skipped,
+                    std::memory_order_relaxed);
+            }
+        }
+        const auto& slot = m_slots[m_front];
+        if (m_timer && slot.sequence > 0)
+        {
+            const auto age =
+                m_timer->get_time_ns().count() - slot.published_ns;
+            m_last_age_ns.store(age, std::memory_order_relaxed);
+            if (age > m_max_age_ns.load(std::memory_order_relaxed))
+            {
+                m_max_age_ns.store(age, std::memory_order_relaxed);
+            }
+        }
+        m_num_reads.store(m_num_reads.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+        return slot.value;
+    }
+
+    /** Reader only: the number of the publish() that read() returned,
+     * 0 for none */
+    uint64_t get_read_sequence() const
+    {
+        return m_slots[m_front].sequence;
+    }
+
+private:
+    static constexpr uint8_t INDEX = 3;
+    static constexpr uint8_t FRESH = 4;
+
+    struct alignas(64) Slot
+    {
+        T value{};
+        uint64_t sequence = 0;
+        int64_t published_ns = 0;
+    };
+
+    std::array<Slot, 3> m_slots;
+    // the index of the buffer in between, FRESH if it was published and
+    // not read yet:
+    alignas(64) std::atomic<uint8_t> m_middle = 1;
+    alignas(64) uint8_t m_back = 2;
+    alignas(64) uint8_t m_front = 0;
+};
+
+} // namespace realtime
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace realtime
+{
+
+/** a bounded multi-producer/single-consumer queue.
+ * Producers may run on any thread and never block (a push fails when the
+ * queue is full). The consumer is the core's own thread: popping uses only
+ * relaxed loads and stores, no atomic read-modify-write, so checking the queue
+ * from the real-time loop is cheap.
+ */
+template <typename T, size_t N> class mpsc_queue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+    mpsc_queue()
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    /** may be called from any thread.
+     * returns false when the queue is full.
+     */
+    bool try_push(T value)
+    {
+        Cell* cell = nullptr;
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &m_cells[pos & (N - 1)];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const auto dif = (intptr_t) seq - (intptr_t) pos;
+            if (dif == 0)
+            {
+                if (m_enqueue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (dif < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** only to be called from the consuming thread */
+    bool try_pop(T& out)
+    {
+        const auto pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        Cell& cell = m_cells[pos & (N - 1)];
+        const size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (seq != pos + 1)
+        {
+            return false;
+        }
+
+        out = std::move(cell.value);
+        cell.value = T{};
+        cell.sequence.store(pos + N, std::memory_order_release);
+        m_dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /** only to be called from the consuming thread */
+    bool empty() const
+    {
+        const auto pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        const Cell& cell = m_cells[pos & (N - 1)];
+        return cell.sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    /** may be called from any thread, an approximation as producers and
+     * the consumer may be busy concurrently */
+    size_t size_approx() const
+    {
+        const auto deq = m_dequeue_pos.load(std::memory_order_relaxed);
+        const auto enq = m_enqueue_pos.load(std::memory_order_relaxed);
+        return enq >= deq ? enq - deq : 0;
+    }
+
+    size_t capacity() const
+    {
+        return N;
+    }
+
+private:
+    struct alignas(64) Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::array<Cell, N> m_cells;
+    alignas(64) std::atomic<size_t> m_enqueue_pos = 0;
+    // only written by the consumer, atomic for size_approx():
+    alignas(64) std::atomic<size_t> m_dequeue_pos = 0;
+};
+
+} // namespace realtime
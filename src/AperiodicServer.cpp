@@ -0,0 +1,87 @@
+#include <urtsched/AperiodicServer.hpp>
+#include <urtsched/RealtimeKernel.hpp>
+
+#include <slogger/ILogger.hpp>
+
+
+namespace realtime
+{
+
+bool AperiodicServer::post(const task_func_t& job)
+{
+    if (!m_jobs.try_push(Job{ job, get_timer().get_time_ns() }))
+    {
+        m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+
+bool AperiodicServer::serve(const PeriodicTask* next)
+{
+    m_budget.replenish_if_due();
+
+    bool ran_some_jobs = false;
+    while (m_budget.has_budget() && is_enabled())
+    {
+        if (next != nullptr &&
+            next->time_left_until_deadline() <= max_time_taken_ns())
+        {
+            // the next job would not finish before the periodic is due.
+            break;
+        }
+
+        if (!m_jobs.try_pop(m_current))
+        {
+            break;
+        }
+
+        const auto start = get_timer().get_time_ns();
+        const auto took = run();
+        m_current.func = nullptr;
+
+        m_budget.charge(took);
+
+        const auto response_time = start + took - m_current.posted_at;
+        m_total_response_time += response_time;
+        if (response_time > m_max_response_time)
+        {
+            m_max_response_time = response_time;
+        }
+        m_num_served++;
+        ran_some_jobs = true;
+    }
+    return ran_some_jobs;
+}
+
+
+std::string AperiodicServer::get_service_status_as_json() const
+{
+    return service::write_status_to_string(
+        [this](service::StatusWriter& w) { write_status(w); });
+}
+
+
+void AperiodicServer::write_status(service::StatusWriter& w) const
+{
+    const auto avg_response = m_num_served == 0
+        ? std::chrono::nanoseconds(0)
+        : m_total_response_time / (int64_t) m_num_served;
+
+    w.begin_object();
+    w.value("name", get_name());
+    w.seconds("budget", m_budget.get_budget());
+    w.seconds("period", m_budget.get_period());
+    w.seconds("used_last_period", m_budget.get_used_last_period());
+    w.seconds("used_total", m_budget.get_total_used());
+    w.seconds("remaining", m_budget.get_remaining());
+    w.value("served", m_num_served);
+    w.value("dropped", get_num_dropped());
+    w.value("pending", m_jobs.size_approx());
+    w.seconds("max_response", m_max_response_time);
+    w.seconds("avg_response", avg_response);
+    w.end_object();
+}
+
+} // namespace realtime
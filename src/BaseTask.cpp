@@ -1,10 +1,13 @@
 #include <urtsched/RealtimeKernel.hpp>
+#include <urtsched/ReleaseGroup.hpp>
 
 #include <slogger/ILogger.hpp>
 #include <slogger/StringUtils.hpp>
 #include <slogger/TimeUtils.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cstdio>
 #include <thread>
 
@@ -17,14 +20,152 @@ static constexpr auto MAX_ALLOWED_TASK_TIME = 500us;
 
 namespace realtime
 {
-void BaseTask::run()
+void BaseTask::run_elapsed()
+{
+    if (get_task_type() == TaskType::HARD_REALTIME)
+    {
+        assert(m_timeout.elapsed());
+    }
+
+    m_last_release_lateness = -m_timeout.time_left();
+    m_max_release_lateness =
+        std::max(m_max_release_lateness, m_last_release_lateness);
+    m_timeout.reset(m_interval);
+    m_gate_open = false;
+
+    if (m_release_group)
+    {
+        // the members count their own misses:
+        m_release_group->run_members();
+        return;
+    }
+
+    count_deadline_miss_if_late(run());
+}
+
+
+void BaseTask::count_deadline_miss_if_late(std::chrono::nanoseconds took)
+{
+    if (m_last_release_lateness + took > m_interval)
+    {
+        m_num_deadline_misses++;
+        m_kernel->m_num_deadline_misses++;
+    }
+}
+
+
+uint32_t BaseTask::next_task_id()
+{
+    static std::atomic<uint32_t> next_id = 1;
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+bool BaseTask::add_prefetch_range(const void* data, size_t bytes)
+{
+    if (m_num_prefetch_ranges == MAX_PREFETCH_RANGES)
+    {
+        return false;
+    }
+    m_prefetch_ranges[m_num_prefetch_ranges++] = {
+        static_cast<const char*>(data), bytes
+    };
+    return true;
+}
+
+
+void BaseTask::prefetch()
+{
+    constexpr size_t CACHE_LINE = 64;
+    constexpr size_t PAGE = 4096;
+    for (size_t i = 0; i < m_num_prefetch_ranges; i++)
+    {
+        const auto [data, bytes] = m_prefetch_ranges[i];
+        for (size_t off = 0; off < bytes; off += CACHE_LINE)
+        {
+            if (off % PAGE == 0)
+            {
+                // a load, not only a prefetch hint, so the TLB entry is
+                // there too:
+                (void) *static_cast<const volatile char*>(data + off);
+            }
+            __builtin_prefetch(data + off, 0, 3);
+        }
+    }
+    if (m_prefetch_hook)
+    {
+        m_prefetch_hook(*this);
+    }
+}
+
+
+CoreArena& BaseTask::get_arena() const
+{
+    return m_kernel->get_arena();
+}
+
+
+std::chrono::nanoseconds BaseTask::run()
 {
     m_num_calls++;
+    if (m_num_calls == MAX_SEEDED_CALLS)
+    {
+        // our own maximum is representative by now:
+        m_seeded_max_time_taken = std::chrono::nanoseconds(0);
+        m_seeded_warmup_max_time_taken = std::chrono::nanoseconds(0);
+    }
+    m_kernel->m_arena->reset_scratch();
+    // outside of the timed part so the reads don't count towards it:
+    PerfSample perf_before;
+    const auto* perf = m_kernel->m_perf.get();
+    if (perf)
+    {
+        perf->read(perf_before);
+    }
     const auto start = m_timer.get_time_ns();
+    m_kernel->m_running_since_ns.store(
+        start.count(), std::memory_order_relaxed);
+    m_kernel->m_running_task_id.store(m_id, std::memory_order_release);
     const auto task_status = m_task_func(*this);
+    if (m_kernel->m_simulation)
+    {
+        m_kernel->m_simulation->advance(m_cost_model
+                ? m_cost_model->next_cost()
+                : m_kernel->m_simulation_config.default_cost);
+    }
+    m_kernel->m_running_task_id.store(0, std::memory_order_release);
     const auto end = m_timer.get_time_ns();
+    if (perf)
+    {
+        PerfSample perf_after;
+        perf->read(perf_after);
+        m_perf_stats.add(perf_before, perf_after);
+    }
     assert(end >= start); // overflow?
-    auto took = end - start;
+    const auto measured = end - start;
+
+    m_exec_histogram[std::min<size_t>(
+        std::bit_width((uint64_t) measured.count()), EXEC_HISTOGRAM_BUCKETS - 1)]++;
+    m_kernel->m_busy_time += measured;
+
+    // periodic tasks were due m_last_release_lateness before they
+    // started, the others when they started:
+    m_last_release = start - m_last_release_lateness;
+    if (auto* recorder = m_kernel->m_recorder.get())
+    {
+        recorder->record(TaskRecord{ m_id, (uint32_t) task_status,
+            m_last_release.count(), start.count(), measured.count() });
+    }
+    if (m_completion_hook)
+    {
+        m_completion_hook(*this, end);
+    }
+    auto took = measured;
+
+    if (m_reservation)
+    {
+        m_reservation->charge(measured);
+    }
 
     if (took > MAX_ALLOWED_TASK_TIME)
     {
@@ -37,6 +178,11 @@ void BaseTask::run()
             m_kernel->get_name(), m_name, micros, avg, m_num_calls,
             m_num_task_ok_calls);
 
+        if (m_reservation)
+        {
+            m_reservation->count_task_overrun();
+        }
+
         // lie a bit to make sure this task can be scheduled at all:
         took = took / 20;
     }
@@ -47,12 +193,12 @@ void BaseTask::run()
     if (task_status == TaskStatus::TASK_YIELD)
     {
         // we yielded, so do not count this time towards our stats.
-        return;
+        return measured;
     }
 
     m_num_task_ok_calls++;
 
-    if (m_num_calls < WARMUP_COUNT)
+    if (m_num_calls < WARMUP_COUNT && !m_seed)
     {
         if (took > m_warmup_max_time_taken)
         {
@@ -64,7 +210,7 @@ void BaseTask::run()
         if (took > MAX_ALLOWED_TASK_TIME)
         {
             // lets not count towards our normal statistics.
-            return;
+            return measured;
         }
 
         if (took > m_max_time_taken)
@@ -72,6 +218,7 @@ void BaseTask::run()
             m_max_time_taken = took;
         }
     }
+    return measured;
 }
 
 } // namespace realtime
\ No newline at end of file
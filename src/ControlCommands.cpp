@@ -0,0 +1,182 @@
+#include <urtsched/RealtimeKernel.hpp>
+
+#include <slogger/ILogger.hpp>
+
+using namespace std::chrono_literals;
+
+
+namespace realtime
+{
+
+std::shared_ptr<PeriodicTask> RealtimeKernel::post_add_periodic(TaskType tt,
+    const std::string& name, const std::chrono::microseconds& interval,
+    const task_func_t& callback)
+{
+    // the slot is reserved and the task created on the caller's thread,
+    // only its insertion is left to the kernel:
+    if (!take_slot(m_periodic_slots, MAX_PERIODIC_TASKS))
+    {
+        return nullptr;
+    }
+    auto s = std::make_shared<PeriodicTask>(
+        m_timer, tt, "periodic: " + name, interval, callback, m_logger, this);
+    s->disable();
+    task_created(*s, RecordedTaskKind::PERIODIC);
+    if (!m_control_queue.try_push(
+            ControlCommand{ ControlCommand::Op::ADD_PERIODIC, s }))
+    {
+        m_periodic_slots.fetch_sub(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return s;
+}
+
+
+std::shared_ptr<IdleTask> RealtimeKernel::post_add_idle_task(
+    const std::string& name, const task_func_t& callback)
+{
+    if (!take_slot(m_idle_slots, MAX_IDLE_TASKS))
+    {
+        return nullptr;
+    }
+    auto s = std::make_shared<IdleTask>(
+        m_timer, "idle: " + name, 0us, callback, m_logger, this);
+    s->enable();
+    task_created(*s, RecordedTaskKind::IDLE);
+    if (!m_control_queue.try_push(
+            ControlCommand{ ControlCommand::Op::ADD_IDLE, s }))
+    {
+        m_idle_slots.fetch_sub(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return s;
+}
+
+
+bool RealtimeKernel::post_remove(const std::shared_ptr<PeriodicTask>& task_ptr)
+{
+    if (!task_ptr)
+    {
+        return false;
+    }
+    return m_control_queue.try_push(
+        ControlCommand{ ControlCommand::Op::REMOVE, task_ptr });
+}
+
+
+bool RealtimeKernel::post_enable(const std::shared_ptr<BaseTask>& task_ptr)
+{
+    return m_control_queue.try_push(
+        ControlCommand{ ControlCommand::Op::ENABLE, task_ptr });
+}
+
+
+bool RealtimeKernel::post_disable(const std::shared_ptr<BaseTask>& task_ptr)
+{
+    return m_control_queue.try_push(
+        ControlCommand{ ControlCommand::Op::DISABLE, task_ptr });
+}
+
+
+bool RealtimeKernel::post_set_period(const std::shared_ptr<BaseTask>& task_ptr,
+    const std::chrono::microseconds& interval)
+{
+    return m_control_queue.try_push(
+        ControlCommand{ ControlCommand::Op::SET_PERIOD, task_ptr, interval });
+}
+
+
+bool RealtimeKernel::post_disable_task_id(uint32_t task_id)
+{
+    return m_control_queue.try_push(ControlCommand{
+        ControlCommand::Op::DISABLE_IF_OURS, nullptr, 0us, task_id });
+}
+
+
+void RealtimeKernel::disable_if_ours(uint32_t task_id)
+{
+    auto disable_in = [task_id](auto& list) {
+        for (auto& it : list)
+        {
+            if (it && it->get_id() == task_id)
+            {
+                it->disable();
+                return true;
+            }
+        }
+        return false;
+    };
+
+    if (disable_in(m_periodic_list) || disable_in(m_idle_list) ||
+        disable_in(m_server_list))
+    {
+        return;
+    }
+    bool found = false;
+    for (const auto& p : m_periodic_list)
+    {
+        if (const auto* g = p ? p->as_release_group() : nullptr)
+        {
+            g->for_each_member([task_id, &found](PeriodicTask& m) {
+                if (m.get_id() == task_id)
+                {
+                    m.disable();
+                    found = true;
+                }
+            });
+        }
+    }
+    if (found)
+    {
+        return;
+    }
+    LOG_ERROR(get_logger(), "{} - task to disable is not ours", m_name);
+}
+
+
+void RealtimeKernel::apply_control_commands()
+{
+    ControlCommand cmd;
+    while (m_control_queue.try_pop(cmd))
+    {
+        switch (cmd.op)
+        {
+        case ControlCommand::Op::NONE:
+            break;
+        case ControlCommand::Op::ADD_PERIODIC:
+            if (!insert_periodic(
+                    std::static_pointer_cast<PeriodicTask>(cmd.task)))
+            {
+                m_periodic_slots.fetch_sub(1, std::memory_order_relaxed);
+            }
+            break;
+        case ControlCommand::Op::ADD_IDLE:
+            if (!insert_idle_task(std::static_pointer_cast<IdleTask>(cmd.task)))
+            {
+                m_idle_slots.fetch_sub(1, std::memory_order_relaxed);
+            }
+            break;
+        case ControlCommand::Op::REMOVE:
+            if (!remove(std::static_pointer_cast<PeriodicTask>(cmd.task)))
+            {
+                LOG_ERROR(get_logger(), "{} - failed to remove {}", m_name,
+                    cmd.task->get_name());
+            }
+            break;
+        case ControlCommand::Op::ENABLE:
+            cmd.task->enable();
+            break;
+        case ControlCommand::Op::DISABLE:
+            cmd.task->disable();
+            break;
+        case ControlCommand::Op::DISABLE_IF_OURS:
+            disable_if_ours(cmd.task_id);
+            break;
+        case ControlCommand::Op::SET_PERIOD:
+            cmd.task->set_period(cmd.interval);
+            break;
+        }
+    }
+}
+
+} // namespace realtime
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <new>
+
+#include <urtsched/CoreArena.hpp>
+
+#include <slogger/ILogger.hpp>
+
+
+namespace realtime
+{
+
+CoreArena::CoreArena(const ArenaConfig& config, logging::ILogger& logger)
+    : m_memory(config.total_bytes(), logger)
+{
+    if (m_memory.data() == nullptr)
+    {
+        return;
+    }
+
+    // the pools come first, largest blocks first, so every block is aligned
+    // to its own size:
+    auto* p = static_cast<char*>(m_memory.data());
+    for (size_t i = NUM_POOLS; i-- > 0;)
+    {
+        const size_t block_size = MIN_BLOCK_SIZE << i;
+        for (size_t b = 0; b < config.blocks_per_pool; b++)
+        {
+            auto* block = reinterpret_cast<FreeBlock*>(p);
+            block->next = m_pools[i].free_list;
+            m_pools[i].free_list = block;
+            p += block_size;
+        }
+    }
+
+    m_scratch = p;
+    m_scratch_size = config.scratch_bytes;
+}
+
+
+void* CoreArena::allocate_scratch(size_t bytes, size_t alignment)
+{
+    const auto base = reinterpret_cast<uintptr_t>(m_scratch);
+    const auto start = (base + m_scratch_used + alignment - 1) & ~(alignment - 1);
+    const auto end = start + bytes;
+    if (m_scratch == nullptr || end > base + m_scratch_size)
+    {
+        m_num_failed_allocations++;
+        return nullptr;
+    }
+
+    m_scratch_used = end - base;
+    if (m_scratch_used > m_scratch_high_water_mark)
+    {
+        m_scratch_high_water_mark = m_scratch_used;
+    }
+    return reinterpret_cast<void*>(start);
+}
+
+
+size_t CoreArena::pool_index(size_t bytes, size_t alignment)
+{
+    const auto needed = std::bit_ceil(std::max({ bytes, alignment, MIN_BLOCK_SIZE }));
+    return std::countr_zero(needed) - std::countr_zero(MIN_BLOCK_SIZE);
+}
+
+
+void* CoreArena::allocate(size_t bytes, size_t alignment)
+{
+    const auto ix = pool_index(bytes, alignment);
+    if (ix >= NUM_POOLS || m_pools[ix].free_list == nullptr)
+    {
+        m_num_failed_allocations++;
+        return nullptr;
+    }
+
+    auto& pool = m_pools[ix];
+    FreeBlock* block = pool.free_list;
+    pool.free_list = block->next;
+    pool.in_use++;
+    return block;
+}
+
+
+void CoreArena::deallocate(void* p, size_t bytes, size_t alignment)
+{
+    if (p == nullptr)
+    {
+        return;
+    }
+
+    const auto ix = pool_index(bytes, alignment);
+    assert(ix < NUM_POOLS);
+
+    auto& pool = m_pools[ix];
+    auto* block = static_cast<FreeBlock*>(p);
+    block->next = pool.free_list;
+    pool.free_list = block;
+    pool.in_use--;
+}
+
+
+void* CoreArena::ScratchResource::do_allocate(size_t bytes, size_t alignment)
+{
+    if (void* p = m_arena.allocate_scratch(bytes, alignment))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+
+void* CoreArena::PoolResource::do_allocate(size_t bytes, size_t alignment)
+{
+    if (void* p = m_arena.allocate(bytes, alignment))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace realtime
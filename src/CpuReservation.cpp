@@ -0,0 +1,33 @@
+#include <urtsched/CpuReservation.hpp>
+
+#include <slogger/ILogger.hpp>
+
+#include <urtsched/StatusWriter.hpp>
+
+
+namespace realtime
+{
+
+std::string CpuReservation::get_service_status_as_json() const
+{
+    return service::write_status_to_string(
+        [this](service::StatusWriter& w) { write_status(w); });
+}
+
+
+void CpuReservation::write_status(service::StatusWriter& w) const
+{
+    w.begin_object();
+    w.value("name", get_name());
+    w.seconds("budget", m_budget.get_budget());
+    w.seconds("period", m_budget.get_period());
+    w.seconds("used_last_period", m_budget.get_used_last_period());
+    w.seconds("used_total", m_budget.get_total_used());
+    w.value("overrun_periods", m_budget.get_num_overruns());
+    w.seconds("overrun_total", m_budget.get_total_overrun());
+    w.value("throttled", m_num_throttled);
+    w.value("task_overruns", m_num_task_overruns);
+    w.end_object();
+}
+
+} // namespace realtime
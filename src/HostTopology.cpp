@@ -0,0 +1,236 @@
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <urtsched/HostTopology.hpp>
+
+#include <slogger/ILogger.hpp>
+
+
+namespace realtime
+{
+
+std::vector<uint32_t> parse_cpu_list(const std::string& list)
+{
+    std::vector<uint32_t> ret;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ','))
+    {
+        if (range.empty() || range == "\n")
+        {
+            continue;
+        }
+
+        try
+        {
+            const auto dash = range.find('-');
+            if (dash == std::string::npos)
+            {
+                ret.push_back((uint32_t) std::stoul(range));
+                continue;
+            }
+
+            const auto first = std::stoul(range.substr(0, dash));
+            const auto last = std::stoul(range.substr(dash + 1));
+            for (auto c = first; c <= last; c++)
+            {
+                ret.push_back((uint32_t) c);
+            }
+        }
+        catch (const std::exception&)
+        {
+            // ignore garbage, the lists come from the kernel
+        }
+    }
+    return ret;
+}
+
+
+std::string format_cpu_list(std::vector<uint32_t> cpus)
+{
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+
+    std::string ret;
+    for (size_t i = 0; i < cpus.size();)
+    {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+        {
+            j++;
+        }
+
+        if (!ret.empty())
+        {
+            ret += ",";
+        }
+        ret += std::to_string(cpus[i]);
+        if (j > i)
+        {
+            ret += "-" + std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return ret;
+}
+
+
+std::vector<uint32_t> parse_cpu_mask(const std::string& mask)
+{
+    std::vector<uint32_t> ret;
+    uint32_t bit = 0;
+    for (auto it = mask.rbegin(); it != mask.rend(); ++it)
+    {
+        if (!std::isxdigit((unsigned char) *it))
+        {
+            continue;
+        }
+        const auto nibble = (uint32_t) std::stoul(std::string(1, *it), nullptr, 16);
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            if (nibble & (1u << i))
+            {
+                ret.push_back(bit + i);
+            }
+        }
+        bit += 4;
+    }
+    return ret;
+}
+
+
+std::string format_cpu_mask(const std::vector<uint32_t>& cpus, size_t min_groups)
+{
+    size_t groups = min_groups;
+    for (const auto cpu : cpus)
+    {
+        groups = std::max(groups, (size_t) cpu / 32 + 1);
+    }
+
+    std::vector<uint32_t> words(groups, 0);
+    for (const auto cpu : cpus)
+    {
+        words[cpu / 32] |= 1u << (cpu % 32);
+    }
+
+    std::string ret;
+    for (size_t i = groups; i-- > 0;)
+    {
+        ret += std::format("{:08x}", words[i]);
+        if (i > 0)
+        {
+            ret += ",";
+        }
+    }
+    return ret;
+}
+
+
+std::optional<std::string> read_file(const std::filesystem::path& path)
+{
+    std::ifstream f(path);
+    if (!f)
+    {
+        return std::nullopt;
+    }
+    std::stringstream ss;
+    ss << f.rdbuf();
+    auto s = ss.str();
+    while (!s.empty() && (s.back() == '\n' || s.back() == ' '))
+    {
+        s.pop_back();
+    }
+    return s;
+}
+
+
+NumaTopology NumaTopology::discover(const std::filesystem::path& root)
+{
+    NumaTopology ret;
+
+    const auto node_dir = root / "sys/devices/system/node";
+    std::error_code ec;
+    for (const auto& entry :
+        std::filesystem::directory_iterator(node_dir, ec))
+    {
+        const auto name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+            !std::all_of(name.begin() + 4, name.end(), ::isdigit))
+        {
+            continue;
+        }
+
+        NumaNode node;
+        node.id = (uint32_t) std::stoul(name.substr(4));
+        if (const auto cpulist = read_file(entry.path() / "cpulist"))
+        {
+            node.cpus = parse_cpu_list(*cpulist);
+        }
+        ret.m_nodes.push_back(node);
+    }
+
+    std::sort(ret.m_nodes.begin(), ret.m_nodes.end(),
+        [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+    return ret;
+}
+
+
+std::optional<uint32_t> NumaTopology::node_of_cpu(uint32_t cpu) const
+{
+    for (const auto& n : m_nodes)
+    {
+        if (std::find(n.cpus.begin(), n.cpus.end(), cpu) != n.cpus.end())
+        {
+            return n.id;
+        }
+    }
+    return std::nullopt;
+}
+
+
+std::vector<uint32_t> NumaTopology::nodes_of_cpus(
+    const std::vector<uint32_t>& cpus) const
+{
+    std::vector<uint32_t> ret;
+    for (const auto cpu : cpus)
+    {
+        if (const auto node = node_of_cpu(cpu))
+        {
+            ret.push_back(*node);
+        }
+    }
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+    return ret;
+}
+
+
+bool bind_memory_to_node(uint32_t node, logging::ILogger& logger)
+{
+    constexpr auto BITS_PER_MASK = 8 * sizeof(unsigned long);
+    unsigned long mask[4] = {};
+    if (node >= 4 * BITS_PER_MASK)
+    {
+        LOG_ERROR(logger, "numa node {} out of range", node);
+        return false;
+    }
+    mask[node / BITS_PER_MASK] = 1UL << (node % BITS_PER_MASK);
+
+    if (syscall(SYS_set_mempolicy, MPOL_BIND, mask, 4 * BITS_PER_MASK) != 0)
+    {
+        LOG_ERROR(logger, "failed to bind memory to numa node {}: {}", node,
+            strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+} // namespace realtime
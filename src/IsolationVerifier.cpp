@@ -0,0 +1,333 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sched.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include <urtsched/HostTopology.hpp>
+#include <urtsched/IsolationVerifier.hpp>
+
+#include <slogger/ILogger.hpp>
+
+
+namespace realtime
+{
+
+static const char* to_string(CheckStatus status)
+{
+    switch (status)
+    {
+    case CheckStatus::OK:
+        return "ok";
+    case CheckStatus::WARNING:
+        return "warning";
+    case CheckStatus::FAILED:
+        return "failed";
+    }
+    return "?";
+}
+
+
+bool IsolationReport::ok() const
+{
+    return std::none_of(checks.begin(), checks.end(),
+        [](const IsolationCheck& c) { return c.status == CheckStatus::FAILED; });
+}
+
+
+std::string IsolationReport::to_json() const
+{
+    std::string ret = "[";
+    const char* comma = "";
+    for (const auto& c : checks)
+    {
+        ret += comma;
+        ret += std::format(
+            "{{ \"name\": \"{}\", \"status\": \"{}\", \"detail\": \"{}\" }}",
+            c.name, to_string(c.status), c.detail);
+        comma = ",";
+    }
+    ret += "]";
+    return ret;
+}
+
+
+std::vector<uint32_t> IsolationVerifier::missing_from(
+    const std::vector<uint32_t>& cpus) const
+{
+    std::vector<uint32_t> ret;
+    for (const auto core : m_reserved_cores)
+    {
+        if (std::find(cpus.begin(), cpus.end(), core) == cpus.end())
+        {
+            ret.push_back(core);
+        }
+    }
+    return ret;
+}
+
+
+IsolationReport IsolationVerifier::verify() const
+{
+    IsolationReport report;
+    check_kernel_cmdline(report);
+    check_irq_affinity(report);
+    check_rt_throttling(report);
+    check_cpu_governors(report);
+    return report;
+}
+
+
+void IsolationVerifier::check_kernel_cmdline(IsolationReport& report) const
+{
+    const auto cmdline = read_file(m_root / "proc/cmdline");
+    if (!cmdline)
+    {
+        report.checks.push_back(
+            { "cmdline", CheckStatus::WARNING, "failed to read /proc/cmdline" });
+        return;
+    }
+
+    for (const std::string param : { "isolcpus", "nohz_full", "rcu_nocbs" })
+    {
+        std::vector<uint32_t> cpus;
+        std::stringstream ss(*cmdline);
+        std::string token;
+        while (ss >> token)
+        {
+            if (token.rfind(param + "=", 0) == 0)
+            {
+                // flags like isolcpus=domain,managed_irq,2-3 are skipped by
+                // the parser:
+                cpus = parse_cpu_list(token.substr(param.size() + 1));
+            }
+        }
+
+        if (const auto missing = missing_from(cpus); missing.empty())
+        {
+            report.checks.push_back({ param, CheckStatus::OK, "" });
+        }
+        else
+        {
+            report.checks.push_back({ param, CheckStatus::WARNING,
+                "reserved cores not in " + param + ": " +
+                    format_cpu_list(missing) });
+        }
+    }
+}
+
+
+std::vector<std::string> IsolationVerifier::irqs_on_reserved_cores() const
+{
+    std::vector<std::string> ret;
+    std::error_code ec;
+    for (const auto& entry :
+        std::filesystem::directory_iterator(m_root / "proc/irq", ec))
+    {
+        const auto mask = read_file(entry.path() / "smp_affinity");
+        if (!mask)
+        {
+            continue;
+        }
+        if (missing_from(parse_cpu_mask(*mask)).size() < m_reserved_cores.size())
+        {
+            ret.push_back(entry.path().filename().string());
+        }
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+
+void IsolationVerifier::check_irq_affinity(IsolationReport& report) const
+{
+    const auto irqs = irqs_on_reserved_cores();
+    if (irqs.empty())
+    {
+        report.checks.push_back({ "irq_affinity", CheckStatus::OK, "" });
+        return;
+    }
+
+    std::string list;
+    for (const auto& irq : irqs)
+    {
+        list += (list.empty() ? "" : ",") + irq;
+    }
+    report.checks.push_back({ "irq_affinity", CheckStatus::FAILED,
+        "irqs routed to reserved cores: " + list });
+}
+
+
+void IsolationVerifier::check_rt_throttling(IsolationReport& report) const
+{
+    const auto runtime = read_file(m_root / "proc/sys/kernel/sched_rt_runtime_us");
+    if (!runtime)
+    {
+        report.checks.push_back({ "rt_throttling", CheckStatus::WARNING,
+            "failed to read sched_rt_runtime_us" });
+    }
+    else if (*runtime == "-1")
+    {
+        report.checks.push_back({ "rt_throttling", CheckStatus::OK, "" });
+    }
+    else
+    {
+        report.checks.push_back({ "rt_throttling", CheckStatus::WARNING,
+            "real-time tasks are throttled to " + *runtime +
+                "us per sched_rt_period_us" });
+    }
+}
+
+
+void IsolationVerifier::check_cpu_governors(IsolationReport& report) const
+{
+    std::vector<uint32_t> slow;
+    for (const auto core : m_reserved_cores)
+    {
+        const auto governor = read_file(m_root /
+            std::format("sys/devices/system/cpu/cpu{}/cpufreq/scaling_governor",
+                core));
+        if (governor && *governor != "performance")
+        {
+            slow.push_back(core);
+        }
+    }
+
+    if (slow.empty())
+    {
+        report.checks.push_back({ "cpu_governor", CheckStatus::OK, "" });
+    }
+    else
+    {
+        report.checks.push_back({ "cpu_governor", CheckStatus::WARNING,
+            "no 'performance' governor on cores " + format_cpu_list(slow) });
+    }
+}
+
+
+void IsolationVerifier::check_thread_affinity(IsolationReport& report,
+    const std::string& name, const std::vector<uint32_t>& expected_cores)
+{
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    if (sched_getaffinity(0, sizeof(cpuset), &cpuset) != 0)
+    {
+        report.checks.push_back({ name + ".affinity", CheckStatus::WARNING,
+            "failed to get thread affinity" });
+        return;
+    }
+
+    std::vector<uint32_t> actual;
+    for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, &cpuset))
+        {
+            actual.push_back(cpu);
+        }
+    }
+
+    auto expected = expected_cores;
+    std::sort(expected.begin(), expected.end());
+    if (actual == expected)
+    {
+        report.checks.push_back({ name + ".affinity", CheckStatus::OK, "" });
+        return;
+    }
+    report.checks.push_back({ name + ".affinity", CheckStatus::FAILED,
+        "running on cores " + format_cpu_list(actual) + ", expected " +
+            format_cpu_list(expected) });
+}
+
+
+static bool write_mask(const std::filesystem::path& path, const std::string& mask)
+{
+    FILE* f = fopen(path.c_str(), "w");
+    if (f == nullptr)
+    {
+        return false;
+    }
+    const bool written = fprintf(f, "%s\n", mask.c_str()) >= 0;
+    return fclose(f) == 0 && written;
+}
+
+
+size_t IsolationVerifier::steer_irqs_away(
+    std::vector<std::pair<std::filesystem::path, std::string>>* previous) const
+{
+    size_t steered = 0;
+    for (const auto& irq : irqs_on_reserved_cores())
+    {
+        const auto path = m_root / "proc/irq" / irq / "smp_affinity";
+        const auto mask = read_file(path);
+        if (!mask)
+        {
+            continue;
+        }
+
+        auto cpus = parse_cpu_mask(*mask);
+        std::erase_if(cpus, [this](uint32_t cpu) {
+            return std::find(m_reserved_cores.begin(), m_reserved_cores.end(),
+                       cpu) != m_reserved_cores.end();
+        });
+        if (cpus.empty())
+        {
+            LOG_ERROR(get_logger(), "irq {} can only go to reserved cores", irq);
+            continue;
+        }
+
+        const auto groups = (size_t) std::count(mask->begin(), mask->end(), ',') + 1;
+        const auto new_mask = format_cpu_mask(cpus, groups);
+        if (!write_mask(path, new_mask))
+        {
+            // some irqs (e.g. per-cpu timers) can't be moved:
+            LOG_ERROR(get_logger(), "failed to steer irq {} to {}", irq, new_mask);
+            continue;
+        }
+        LOG_INFO(get_logger(), "steered irq {} to {}", irq, new_mask);
+        if (previous)
+        {
+            previous->emplace_back(path, *mask);
+        }
+        steered++;
+    }
+    return steered;
+}
+
+
+IrqSteering::IrqSteering(const IsolationVerifier& verifier)
+    : m_logger(verifier.get_logger())
+{
+    verifier.steer_irqs_away(&m_saved);
+}
+
+
+void IrqSteering::release()
+{
+    for (const auto& [path, previous] : m_saved)
+    {
+        if (!write_mask(path, previous))
+        {
+            LOG_ERROR(get_logger(), "failed to restore {} to {}", path.string(),
+                previous);
+        }
+    }
+    m_saved.clear();
+}
+
+
+void IsolationVerifier::log(const IsolationReport& report) const
+{
+    for (const auto& c : report.checks)
+    {
+        if (c.status != CheckStatus::OK)
+        {
+            LOG_ERROR(get_logger(), "isolation check {}: {} - {}", c.name,
+                to_string(c.status), c.detail);
+        }
+    }
+}
+
+} // namespace realtime
@@ -22,31 +22,112 @@ namespace realtime
  * the /sys/fs/cgroup/cpuset virtual file system.
  */
 
-void echo(const std::string& value, const std::string& filename,
-    logging::ILogger& logger)
+static error::Error echo(const std::string& value,
+    const std::filesystem::path& filename, logging::ILogger& logger)
 {
-    LOG_INFO(logger, "writing {} to {}", value, filename);
+    LOG_INFO(logger, "writing {} to {}", value, filename.string());
     FILE* f = fopen(filename.c_str(), "w");
     if (!f)
     {
-        LOG_ERROR(logger, "failed to open {} for writing", filename);
-        assert(f);
+        LOG_ERROR(logger, "failed to open {} for writing", filename.string());
+        return error::Error::FAILED;
     }
-    fprintf(f, "%s\n", value.c_str());
-    fclose(f);
+    const bool written = fprintf(f, "%s\n", value.c_str()) >= 0;
+    if (fclose(f) != 0 || !written)
+    {
+        LOG_ERROR(logger, "failed to write {} to {}", value, filename.string());
+        return error::Error::FAILED;
+    }
+    return error::Error::OK;
+}
+
+
+std::vector<uint32_t> MultiCoreRealtimeKernel::get_reserved_cores() const
+{
+    std::vector<uint32_t> cores;
+    for (size_t i = 0; i < m_kernels.size(); i++)
+    {
+        cores.push_back(core_of(i));
+    }
+    return cores;
+}
+
+
+std::string MultiCoreRealtimeKernel::get_reserved_mems() const
+{
+    const auto nodes = m_numa.nodes_of_cpus(get_reserved_cores());
+    if (nodes.empty())
+    {
+        // no numa info, assume a single node:
+        return "0";
+    }
+    return format_cpu_list(nodes);
 }
 
-void echo(
-    const pid_t value, const std::string& filename, logging::ILogger& logger)
+
+error::Error MultiCoreRealtimeKernel::reserve_cores_using_cgroups()
 {
-    echo(std::to_string(value), filename, logger);
+    if (std::filesystem::exists(m_host_root / "sys/fs/cgroup/cgroup.controllers"))
+    {
+        return reserve_cores_using_cgroups_v2();
+    }
+    return reserve_cores_using_cgroups_v1();
+}
+
+
+error::Error MultiCoreRealtimeKernel::reserve_cores_using_cgroups_v2()
+{
+    const auto CGROUP_ROOT = m_host_root / "sys/fs/cgroup";
+    const auto URTSCHED_PATH = CGROUP_ROOT / "urtsched";
+
+    if (echo("+cpuset", CGROUP_ROOT / "cgroup.subtree_control", get_logger()) !=
+        error::Error::OK)
+    {
+        return error::Error::FAILED;
+    }
+
+    if (!std::filesystem::exists(URTSCHED_PATH))
+    {
+        if (!std::filesystem::create_directories(URTSCHED_PATH))
+        {
+            LOG_ERROR(get_logger(), "failed to create path: {}",
+                URTSCHED_PATH.string());
+            return error::Error::FAILED;
+        }
+    }
+    else
+    {
+        LOG_INFO(get_logger(), "already created {}", URTSCHED_PATH.string());
+    }
+
+    if (echo(format_cpu_list(get_reserved_cores()),
+            URTSCHED_PATH / "cpuset.cpus", get_logger()) != error::Error::OK ||
+        echo(get_reserved_mems(), URTSCHED_PATH / "cpuset.mems",
+            get_logger()) != error::Error::OK ||
+        // takes the cpus away from the load balancer and all other cgroups:
+        echo("isolated", URTSCHED_PATH / "cpuset.cpus.partition",
+            get_logger()) != error::Error::OK)
+    {
+        return error::Error::FAILED;
+    }
+    if (const auto partition =
+            read_file(URTSCHED_PATH / "cpuset.cpus.partition");
+        !partition || *partition != "isolated")
+    {
+        LOG_ERROR(get_logger(), "cpuset partition is not isolated: {}",
+            partition.value_or("?"));
+        return error::Error::FAILED;
+    }
+
+    return echo(std::to_string(getpid()), URTSCHED_PATH / "cgroup.procs",
+        get_logger());
 }
 
 
-void MultiCoreRealtimeKernel::reserve_cores_using_cgroups()
+error::Error MultiCoreRealtimeKernel::reserve_cores_using_cgroups_v1()
 {
-    std::string CPUSET_PATH = "/sys/fs/cgroup/cpuset/urtsched";
-    std::string URTSCHED_PATH = CPUSET_PATH + "/urtsched";
+    const auto CPUSET_PATH = m_host_root / "sys/fs/cgroup/cpuset/urtsched";
+    const auto URTSCHED_PATH = CPUSET_PATH / "urtsched";
 
     if (!std::filesystem::exists(URTSCHED_PATH))
     {
@@ -54,46 +135,61 @@ void MultiCoreRealtimeKernel::reserve_cores_using_cgroups()
         {
             if (!std::filesystem::create_directories(CPUSET_PATH))
             {
-                LOG_ERROR(
-                    get_logger(), "failed to create path: {}", CPUSET_PATH);
+                LOG_ERROR(get_logger(), "failed to create path: {}",
+                    CPUSET_PATH.string());
                 abort();
             }
         }
 
-        shell::run_cmd("mount -t cgroup -ocpuset cpuset " + CPUSET_PATH,
+        shell::run_cmd(
+            "mount -t cgroup -ocpuset cpuset " + CPUSET_PATH.string(),
             get_logger(), shell::RunOpt::ABORT_ON_ERROR);
 
         if (!std::filesystem::exists(URTSCHED_PATH))
         {
             if (!std::filesystem::create_directories(URTSCHED_PATH))
             {
-                LOG_ERROR(
-                    get_logger(), "failed to create path: {}", URTSCHED_PATH);
+                LOG_ERROR(get_logger(), "failed to create path: {}",
+                    URTSCHED_PATH.string());
                 abort();
             }
         }
     }
     else
     {
-        LOG_INFO(get_logger(), "already created {}", URTSCHED_PATH);
+        LOG_INFO(get_logger(), "already created {}", URTSCHED_PATH.string());
     }
 
-    echo("2-3", URTSCHED_PATH + "/cpuset.cpus", get_logger());
-    echo("1", URTSCHED_PATH + "/cpuset.cpu_exclusive", get_logger());
-    echo("0", URTSCHED_PATH + "/cpuset.mems", get_logger());
-    echo(getpid(), URTSCHED_PATH + "/tasks", get_logger());
+    for (const auto& [value, file] :
+        { std::pair<std::string, const char*>{
+              format_cpu_list(get_reserved_cores()), "cpuset.cpus" },
+            { "1", "cpuset.cpu_exclusive" },
+            { get_reserved_mems(), "cpuset.mems" },
+            { std::to_string(getpid()), "tasks" } })
+    {
+        if (echo(value, URTSCHED_PATH / file, get_logger()) != error::Error::OK)
+        {
+            return error::Error::FAILED;
+        }
+    }
+    return error::Error::OK;
 }
 
 
-void MultiCoreRealtimeKernel::run(const std::chrono::milliseconds& max_runtime)
+error::Error MultiCoreRealtimeKernel::run(const std::chrono::milliseconds& max_runtime)
 {
+    m_startup_result = error::Error::OK;
+    m_numa = NumaTopology::discover(m_host_root);
+
     switch (m_reserve_cores)
     {
     case CoreReservationMechanism::CGROUPS:
-        reserve_cores_using_cgroups();
+        // the kernels still run, but not on reserved cores:
+        m_startup_result = reserve_cores_using_cgroups();
         break;
     case CoreReservationMechanism::TASKSET:
-        // todo: check that we're actually on the cores we expect to be
+        // verify_isolation() checks that we're actually on the cores we
+        // expect to be
         LOG_INFO(get_logger(), "pls use taskset cmd to pre-place the service");
         break;
     case CoreReservationMechanism::NONE:
@@ -104,24 +200,225 @@ void MultiCoreRealtimeKernel::run(const std::chrono::milliseconds& max_runtime)
 
     assert(!m_kernels.empty());
 
+    // only while we run, the host's irq routing is put back afterwards:
+    std::optional<IrqSteering> irq_steering;
+    if (m_isolation_config.steer_irqs)
+    {
+        irq_steering.emplace(
+            IsolationVerifier(m_host_root, get_reserved_cores(), get_logger()));
+    }
+
+    if (m_isolation_config.verify)
+    {
+        verify_isolation();
+    }
+
+    std::optional<PowerLatencyRequest> power_latency;
+    if (m_power_config)
+    {
+        power_latency.emplace(
+            m_host_root, *m_power_config, get_reserved_cores(), get_logger());
+        if (!power_latency->ok())
+        {
+            m_startup_result = error::Error::FAILED;
+        }
+    }
+
+    if (m_stats_name)
+    {
+        create_stats_segment();
+    }
+
+    for (auto& k : m_kernels)
+    {
+        k->clear_stop_request();
+    }
+
+    std::unique_ptr<Watchdog> watchdog;
+    if (m_watchdog_config)
+    {
+        watchdog = std::make_unique<Watchdog>(
+            m_timer, get_logger(), *m_watchdog_config, m_kernels);
+        watchdog->start();
+    }
+
+    if (m_memory_config && m_memory_config->lock_memory)
+    {
+        // MCL_FUTURE also covers the stacks of the threads started below.
+        if (!lock_all_memory(get_logger()))
+        {
+            m_startup_result = error::Error::FAILED;
+        }
+    }
+
     std::vector<std::thread> threads;
     for (unsigned i = 1; i < m_kernels.size(); i++)
     {
         threads.emplace_back(
             [this, max_runtime, i]() {
-
-                m_kernels[i]->set_sched_affinity(m_first_reserved_core + i);
-
+                setup_kernel_thread(i);
                 m_kernels[i]->run(max_runtime);
+                // when one core stops, e.g. on a request from the
+                // watchdog, the others should too:
+                request_stop();
                 });
     }
 
+    // kernel 0 runs on our thread, so pin and schedule it like the others
+    // and put the caller back the way it was afterwards:
+    const auto caller_scheduling = save_thread_scheduling();
+    setup_kernel_thread(0);
     m_kernels[0]->run(max_runtime);
+    restore_thread_scheduling(caller_scheduling);
+    request_stop();
 
     for (auto& t : threads)
     {
         t.join();
     }
+
+    if (watchdog)
+    {
+        watchdog->stop();
+    }
+
+    if (power_latency)
+    {
+        power_latency->release();
+    }
+
+    if (irq_steering)
+    {
+        irq_steering->release();
+    }
+
+    if (m_memory_config)
+    {
+        log_memory_reports();
+    }
+
+    std::lock_guard<std::mutex> lock(m_startup_mutex);
+    return m_startup_result;
+}
+
+
+void MultiCoreRealtimeKernel::setup_kernel_thread(size_t kernel_index)
+{
+    auto& kernel = *m_kernels[kernel_index];
+    if (const auto result = kernel.apply_scheduling(core_of(kernel_index));
+        result != error::Error::OK)
+    {
+        std::lock_guard<std::mutex> lock(m_startup_mutex);
+        if (m_startup_result == error::Error::OK)
+        {
+            m_startup_result = result;
+        }
+    }
+
+    if (m_isolation_config.verify)
+    {
+        verify_thread_affinity(kernel_index);
+    }
+    bind_memory_to_local_node(kernel_index);
+
+    // after setting the affinity so the memory is local to the core:
+    if (m_memory_config)
+    {
+        kernel.prepare_memory(*m_memory_config);
+    }
+
+    // counts the calling thread, so on the kernel's own:
+    if (m_perf_config &&
+        kernel.enable_perf_counters(*m_perf_config) != error::Error::OK)
+    {
+        LOG_INFO(get_logger(), "{} runs without perf counters",
+            kernel.get_name());
+    }
+}
+
+
+void MultiCoreRealtimeKernel::verify_isolation()
+{
+    IsolationVerifier verifier(m_host_root, get_reserved_cores(), get_logger());
+    IsolationReport report = verifier.verify();
+    if (m_reserve_cores != CoreReservationMechanism::NONE)
+    {
+        // taskset or the cpuset should have placed us on the reserved cores
+        IsolationVerifier::check_thread_affinity(
+            report, "process", get_reserved_cores());
+    }
+    verifier.log(report);
+
+    std::lock_guard<std::mutex> lock(m_startup_mutex);
+    m_isolation_report = report;
+}
+
+
+void MultiCoreRealtimeKernel::verify_thread_affinity(size_t kernel_index)
+{
+    IsolationReport report;
+    IsolationVerifier::check_thread_affinity(
+        report, m_kernels[kernel_index]->get_name(), { core_of(kernel_index) });
+    IsolationVerifier(m_host_root, get_reserved_cores(), get_logger())
+        .log(report);
+
+    std::lock_guard<std::mutex> lock(m_startup_mutex);
+    m_isolation_report.checks.insert(m_isolation_report.checks.end(),
+        report.checks.begin(), report.checks.end());
+}
+
+
+void MultiCoreRealtimeKernel::bind_memory_to_local_node(size_t kernel_index)
+{
+    if (m_numa.get_nodes().size() <= 1)
+    {
+        // nothing to gain
+        return;
+    }
+
+    const auto core = core_of(kernel_index);
+    if (const auto node = m_numa.node_of_cpu(core))
+    {
+        if (bind_memory_to_node(*node, get_logger()))
+        {
+            LOG_INFO(get_logger(), "{} - memory bound to numa node {}",
+                m_kernels[kernel_index]->get_name(), *node);
+        }
+    }
+}
+
+
+void MultiCoreRealtimeKernel::create_stats_segment()
+{
+    m_stats.reset();
+    m_stats = std::make_unique<StatsSegment>(
+        *m_stats_name, (uint32_t) m_kernels.size(), get_logger());
+    if (!m_stats->ok())
+    {
+        std::lock_guard<std::mutex> lock(m_startup_mutex);
+        m_startup_result = error::Error::FAILED;
+        return;
+    }
+    for (size_t i = 0; i < m_kernels.size(); i++)
+    {
+        m_kernels[i]->set_stats_slot(
+            m_stats->kernel_slot((uint32_t) i), core_of(i), m_stats_interval);
+    }
+}
+
+
+void MultiCoreRealtimeKernel::log_memory_reports()
+{
+    for (const auto& k : m_kernels)
+    {
+        const auto& r = k->get_memory_report();
+        LOG_INFO(get_logger(),
+            "{} - page faults: {} at start, {} after prefault, {} at exit "
+            "({} major), state memory: {} bytes{}",
+            k->get_name(), r.before_prefault.minor, r.after_prefault.minor,
+            r.at_exit.minor, r.at_exit.major, k->get_state_memory().size(),
+            k->get_state_memory().is_hugepage_backed() ? " (hugepages)" : "");
+    }
 }
 
 
@@ -0,0 +1,328 @@
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <urtsched/PerfCounters.hpp>
+#include <urtsched/RealtimeKernel.hpp>
+
+
+namespace realtime
+{
+
+const char* to_string(PerfEvent e)
+{
+    switch (e)
+    {
+    case PerfEvent::CYCLES:
+        return "cycles";
+    case PerfEvent::INSTRUCTIONS:
+        return "instructions";
+    case PerfEvent::LLC_MISSES:
+        return "llc_misses";
+    case PerfEvent::BRANCH_MISSES:
+        return "branch_misses";
+    case PerfEvent::CONTEXT_SWITCHES:
+        return "context_switches";
+    case PerfEvent::TASK_CLOCK:
+        return "task_clock";
+    case PerfEvent::PAGE_FAULTS:
+        return "page_faults";
+    }
+    return "unknown";
+}
+
+
+const char* to_string(PerfMode m)
+{
+    switch (m)
+    {
+    case PerfMode::OFF:
+        return "off";
+    case PerfMode::HARDWARE:
+        return "hardware";
+    case PerfMode::SOFTWARE:
+        return "software";
+    }
+    return "unknown";
+}
+
+
+static bool is_hardware(PerfEvent e)
+{
+    return e == PerfEvent::CYCLES || e == PerfEvent::INSTRUCTIONS ||
+        e == PerfEvent::LLC_MISSES || e == PerfEvent::BRANCH_MISSES;
+}
+
+
+static void set_type(perf_event_attr& attr, PerfEvent e)
+{
+    attr.type = is_hardware(e) ? PERF_TYPE_HARDWARE : PERF_TYPE_SOFTWARE;
+    switch (e)
+    {
+    case PerfEvent::CYCLES:
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PerfEvent::INSTRUCTIONS:
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PerfEvent::LLC_MISSES:
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case PerfEvent::BRANCH_MISSES:
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    case PerfEvent::CONTEXT_SWITCHES:
+        attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+        break;
+    case PerfEvent::TASK_CLOCK:
+        attr.config = PERF_COUNT_SW_TASK_CLOCK;
+        break;
+    case PerfEvent::PAGE_FAULTS:
+        attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+        break;
+    }
+}
+
+
+bool PerfCounterGroup::add(PerfEvent e)
+{
+    if (m_num_counters == MAX_COUNTERS)
+    {
+        return false;
+    }
+
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    set_type(attr, e);
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_hv = 1;
+
+    const int leader = m_num_counters == 0 ? -1 : m_counters[0].fd;
+    int fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+    if (fd < 0 && errno == EACCES)
+    {
+        // perf_event_paranoid >= 2 only allows counting user space:
+        attr.exclude_kernel = 1;
+        fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+    }
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    m_counters[m_num_counters++] = Counter{ e, fd, nullptr };
+    return true;
+}
+
+
+bool PerfCounterGroup::map_for_rdpmc()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    const auto page_size = (size_t) sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < m_num_counters; i++)
+    {
+        auto& c = m_counters[i];
+        void* p = mmap(nullptr, page_size, PROT_READ, MAP_SHARED, c.fd, 0);
+        if (p == MAP_FAILED)
+        {
+            return false;
+        }
+        c.page = static_cast<perf_event_mmap_page*>(p);
+        if (!c.page->cap_user_rdpmc)
+        {
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+bool PerfCounterGroup::open(const PerfConfig& config, logging::ILogger& logger)
+{
+    close();
+
+    if (config.hardware && add(PerfEvent::CYCLES))
+    {
+        for (const auto e : { PerfEvent::INSTRUCTIONS, PerfEvent::LLC_MISSES,
+                 PerfEvent::BRANCH_MISSES })
+        {
+            if (!add(e))
+            {
+                LOG_INFO(logger, "perf counter {} is not available", to_string(e));
+            }
+        }
+        m_mode = PerfMode::HARDWARE;
+        m_rdpmc = config.use_rdpmc && map_for_rdpmc();
+        if (!m_rdpmc)
+        {
+            const auto page_size = (size_t) sysconf(_SC_PAGESIZE);
+            for (size_t i = 0; i < m_num_counters; i++)
+            {
+                if (m_counters[i].page)
+                {
+                    munmap(m_counters[i].page, page_size);
+                    m_counters[i].page = nullptr;
+                }
+            }
+            (void) add(PerfEvent::CONTEXT_SWITCHES);
+        }
+    }
+    else
+    {
+        // page faults lead the group, as a member of a task clock group
+        // they are often not counted at all:
+        (void) add(PerfEvent::PAGE_FAULTS);
+        if (add(PerfEvent::TASK_CLOCK))
+        {
+            (void) add(PerfEvent::CONTEXT_SWITCHES);
+            m_mode = PerfMode::SOFTWARE;
+        }
+        else
+        {
+            close();
+        }
+    }
+
+    if (m_mode == PerfMode::OFF)
+    {
+        LOG_ERROR(logger, "failed to open perf counters: {}", strerror(errno));
+        return false;
+    }
+
+    measure_read_overhead();
+    LOG_INFO(logger, "{} perf counters ({} events{}), {}ns per read",
+        to_string(m_mode), m_num_counters, m_rdpmc ? ", rdpmc" : "",
+        m_read_overhead.count());
+    return true;
+}
+
+
+void PerfCounterGroup::close()
+{
+    const auto page_size = (size_t) sysconf(_SC_PAGESIZE);
+    // members before the leader:
+    for (size_t i = m_num_counters; i-- > 0;)
+    {
+        auto& c = m_counters[i];
+        if (c.page)
+        {
+            munmap(c.page, page_size);
+        }
+        ::close(c.fd);
+        c = Counter{};
+    }
+    m_num_counters = 0;
+    m_mode = PerfMode::OFF;
+    m_rdpmc = false;
+}
+
+
+bool PerfCounterGroup::has(PerfEvent e) const
+{
+    for (size_t i = 0; i < m_num_counters; i++)
+    {
+        if (m_counters[i].event == e)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+/** the self-monitoring loop of perf_event_open(2) */
+static uint64_t read_with_rdpmc(const perf_event_mmap_page* page)
+{
+    uint32_t seq;
+    uint64_t count;
+    do
+    {
+        seq = page->lock;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        const uint32_t index = page->index;
+        count = (uint64_t) page->offset;
+        if (index != 0)
+        {
+            uint32_t lo;
+            uint32_t hi;
+            asm volatile("rdpmc" : "=a"(lo), "=d"(hi) : "c"(index - 1));
+            const auto shift = 64 - page->pmc_width;
+            // sign-extend the counter's width:
+            count += (uint64_t) (((int64_t) (((uint64_t) hi << 32) | lo)
+                                     << shift) >> shift);
+        }
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    } while (page->lock != seq);
+    return count;
+}
+#endif
+
+
+void PerfCounterGroup::read(PerfSample& out) const
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (m_rdpmc)
+    {
+        for (size_t i = 0; i < m_num_counters; i++)
+        {
+            out.values[(size_t) m_counters[i].event] =
+                read_with_rdpmc(m_counters[i].page);
+        }
+        return;
+    }
+#endif
+
+    if (m_num_counters == 0)
+    {
+        return;
+    }
+
+    // PERF_FORMAT_GROUP: the number of counters, then their values
+    uint64_t buf[1 + MAX_COUNTERS];
+    const auto n = ::read(m_counters[0].fd, buf, sizeof(buf));
+    if (n < (ssize_t) sizeof(uint64_t))
+    {
+        return;
+    }
+    for (size_t i = 0; i < buf[0] && i < m_num_counters; i++)
+    {
+        out.values[(size_t) m_counters[i].event] = buf[1 + i];
+    }
+}
+
+
+void PerfCounterGroup::measure_read_overhead()
+{
+    constexpr int N = 1000;
+    PerfSample sample;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++)
+    {
+        read(sample);
+    }
+    m_read_overhead = (std::chrono::steady_clock::now() - start) / N;
+}
+
+
+error::Error RealtimeKernel::enable_perf_counters(const PerfConfig& config)
+{
+    auto perf = std::make_unique<PerfCounterGroup>();
+    if (!perf->open(config, get_logger()))
+    {
+        return error::Error::FAILED;
+    }
+    m_perf = std::move(perf);
+    return error::Error::OK;
+}
+
+} // namespace realtime
@@ -0,0 +1,98 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <urtsched/HostTopology.hpp>
+#include <urtsched/PowerManagement.hpp>
+
+
+namespace realtime
+{
+
+static bool write_sysfs(const std::filesystem::path& path, const std::string& value)
+{
+    FILE* f = fopen(path.c_str(), "w");
+    if (f == nullptr)
+    {
+        return false;
+    }
+    const bool written = fprintf(f, "%s\n", value.c_str()) >= 0;
+    return fclose(f) == 0 && written;
+}
+
+
+PowerLatencyRequest::PowerLatencyRequest(const std::filesystem::path& root,
+    const PowerLatencyConfig& config, const std::vector<uint32_t>& cores,
+    logging::ILogger& logger)
+    : m_logger(logger)
+{
+    if (config.cpu_dma_latency)
+    {
+        const auto path = root / "dev/cpu_dma_latency";
+        const auto latency = (int32_t) config.cpu_dma_latency->count();
+        m_dma_latency_fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        if (m_dma_latency_fd < 0 ||
+            write(m_dma_latency_fd, &latency, sizeof(latency)) !=
+                (ssize_t) sizeof(latency))
+        {
+            LOG_ERROR(get_logger(), "failed to request {}us cpu dma latency: {}",
+                latency, strerror(errno));
+            m_ok = false;
+        }
+        else
+        {
+            LOG_INFO(get_logger(), "holding {}us cpu dma latency request", latency);
+        }
+    }
+
+    if (config.resume_latency)
+    {
+        // in this file 0 means 'no restriction' and "n/a" means 'no latency
+        // at all':
+        const auto value = config.resume_latency->count() == 0
+            ? std::string("n/a")
+            : std::to_string(config.resume_latency->count());
+
+        for (const auto core : cores)
+        {
+            const auto path = root / "sys/devices/system/cpu" /
+                ("cpu" + std::to_string(core)) / "power/pm_qos_resume_latency_us";
+            const auto previous = read_file(path);
+            if (!previous || !write_sysfs(path, value))
+            {
+                LOG_ERROR(get_logger(), "failed to set {} to {}", path.string(),
+                    value);
+                m_ok = false;
+                continue;
+            }
+            LOG_INFO(get_logger(), "core {} resume latency: {} (was {})", core,
+                value, *previous);
+            m_saved.emplace_back(path, *previous);
+        }
+    }
+}
+
+
+void PowerLatencyRequest::release()
+{
+    if (m_dma_latency_fd >= 0)
+    {
+        close(m_dma_latency_fd);
+        m_dma_latency_fd = -1;
+    }
+
+    for (const auto& [path, previous] : m_saved)
+    {
+        if (!write_sysfs(path, previous))
+        {
+            LOG_ERROR(get_logger(), "failed to restore {} to {}", path.string(),
+                previous);
+        }
+    }
+    m_saved.clear();
+}
+
+} // namespace realtime
@@ -21,20 +21,47 @@ using namespace std::chrono_literals;
 
 namespace realtime
 {
-void RealtimeKernel::set_sched_affinity(uint32_t core)
+error::Error RealtimeKernel::set_sched_affinity(uint32_t core)
 {
     cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);      // clears the cpuset
-    CPU_SET(core, &cpuset); // set CPU 2 on cpuset
-
-    /* bind process to processor 0 */
-    if (int status =
+    CPU_ZERO(&cpuset);
+    CPU_SET(core, &cpuset);
+    // returns an errno value instead of setting errno:
+    if (const int status =
             pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
-        status < 0)
+        status != 0)
+    {
+        LOG_ERROR(get_logger(), "{} - failed to set thread affinity to core {}: {}",
+            m_name, core, strerror(status));
+        return error::Error::FAILED;
+    }
+    return error::Error::OK;
+}
+
+
+void RealtimeKernel::prepare_memory(const MemoryHardeningConfig& config)
+{
+    m_memory_report.before_prefault = get_thread_page_faults();
+
+    prefault_stack(config.prefault_stack_bytes);
+    if (config.state_memory_bytes > 0)
+    {
+        m_state_memory =
+            RtMemoryRegion(config.state_memory_bytes, get_logger());
+    }
+    if (config.arena.total_bytes() > 0)
     {
-        LOG_ERROR(get_logger(), "failed to set thread affinity: %s",
-            strerror(-status));
+        create_arena(config.arena);
     }
+
+    m_memory_report.after_prefault = get_thread_page_faults();
+    m_memory_prepared = true;
+}
+
+
+void RealtimeKernel::create_arena(const ArenaConfig& config)
+{
+    m_arena = std::make_unique<CoreArena>(config, get_logger());
 }
 
 
@@ -42,30 +69,104 @@ void RealtimeKernel::set_sched_affinity(uint32_t core)
     TaskType tt, const std::string& name,
     const std::chrono::microseconds& interval, const task_func_t& callback)
 {
+    if (!take_slot(m_periodic_slots, MAX_PERIODIC_TASKS))
+    {
+        return nullptr;
+    }
     auto s = std::make_shared<PeriodicTask>(
         m_timer, tt, "periodic: " + name, interval, callback, m_logger, this);
+    s->disable();
+    task_created(*s, RecordedTaskKind::PERIODIC);
+    if (!insert_periodic(s))
+    {
+        m_periodic_slots.fetch_sub(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return s;
+}
+
+
+void RealtimeKernel::set_recorder(const std::shared_ptr<TaskRecorder>& recorder)
+{
+    m_recorder = recorder;
+    for (const auto& t : m_periodic_list)
+    {
+        if (!t)
+        {
+            continue;
+        }
+        if (const auto* g = t->as_release_group())
+        {
+            g->for_each_member([this](const BaseTask& m) {
+                register_with_recorder(m, RecordedTaskKind::PERIODIC);
+            });
+        }
+        else
+        {
+            register_with_recorder(*t, RecordedTaskKind::PERIODIC);
+        }
+    }
+    for (const auto& t : m_idle_list)
+    {
+        if (t)
+        {
+            register_with_recorder(*t, RecordedTaskKind::IDLE);
+        }
+    }
+    for (const auto& t : m_server_list)
+    {
+        register_with_recorder(*t, RecordedTaskKind::SERVER);
+    }
+}
+
+
+bool RealtimeKernel::insert_periodic(const std::shared_ptr<PeriodicTask>& s)
+{
     for (size_t i = 0; i < m_periodic_list.size(); i++)
     {
         if (m_periodic_list[i] == nullptr)
         {
             m_periodic_list[i] = s;
-            s->disable();
-            return s;
+            return true;
         }
     }
+    if (m_periodic_list.size() == m_periodic_list.capacity())
+    {
+        LOG_ERROR(get_logger(), "{} - no room for {}", m_name, s->get_name());
+        return false;
+    }
     m_periodic_list.push_back(s);
-    s->disable();
-    return s;
+    return true;
 }
 
 
 bool RealtimeKernel::remove(const std::shared_ptr<PeriodicTask>& task_ptr)
 {
+    if (!task_ptr)
+    {
+        // a failed add, which must not match an empty slot:
+        return false;
+    }
     for (size_t ix = 0; ix < m_periodic_list.size(); ix++)
     {
         if (m_periodic_list[ix] == task_ptr)
         {
             m_periodic_list[ix] = nullptr;
+            m_periodic_slots.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    for (auto& t : m_periodic_list)
+    {
+        if (auto* g = t ? t->as_release_group() : nullptr;
+            g && g->remove_member(task_ptr))
+        {
+            if (g->get_num_members() == 0)
+            {
+                // its last member, the group goes with it:
+                t = nullptr;
+                m_periodic_slots.fetch_sub(1, std::memory_order_relaxed);
+            }
             return true;
         }
     }
@@ -75,37 +176,137 @@ bool RealtimeKernel::remove(const std::shared_ptr<PeriodicTask>& task_ptr)
 std::shared_ptr<IdleTask> RealtimeKernel::add_idle_task(
     const std::string& name, const task_func_t& callback)
 {
+    if (!take_slot(m_idle_slots, MAX_IDLE_TASKS))
+    {
+        return nullptr;
+    }
     auto s = std::make_shared<IdleTask>(
         m_timer, "idle: " + name, 0us, callback, m_logger, this);
+    s->enable();
+    task_created(*s, RecordedTaskKind::IDLE);
+    if (!insert_idle_task(s))
+    {
+        m_idle_slots.fetch_sub(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return s;
+}
+
 
+bool RealtimeKernel::insert_idle_task(const std::shared_ptr<IdleTask>& s)
+{
     for (size_t i = 0; i < m_idle_list.size(); i++)
     {
         if (m_idle_list[i] == nullptr)
         {
             m_idle_list[i] = s;
-            s->enable();
-            return s;
+            return true;
         }
     }
-
+    if (m_idle_list.size() == m_idle_list.capacity())
+    {
+        LOG_ERROR(get_logger(), "{} - no room for {}", m_name, s->get_name());
+        return false;
+    }
     m_idle_list.push_back(s);
+    return true;
+}
+
+
+std::shared_ptr<AperiodicServer> RealtimeKernel::add_aperiodic_server(
+    const std::string& name, const std::chrono::microseconds& budget,
+    const std::chrono::microseconds& period)
+{
+    if (m_server_list.size() == m_server_list.capacity())
+    {
+        return nullptr;
+    }
+    auto s = std::make_shared<AperiodicServer>(
+        m_timer, "server: " + name, budget, period, m_logger, this);
+    task_created(*s, RecordedTaskKind::SERVER);
+    m_server_list.push_back(s);
     s->enable();
     return s;
 }
 
 
-void RealtimeKernel::run_idle_tasks()
+std::shared_ptr<CpuReservation> RealtimeKernel::add_reservation(
+    const std::string& name, const std::chrono::microseconds& budget,
+    const std::chrono::microseconds& period)
+{
+    auto r = std::make_shared<CpuReservation>(m_timer, name, budget, period);
+    for (auto& slot : m_reservation_list)
+    {
+        if (slot == nullptr)
+        {
+            slot = r;
+            return r;
+        }
+    }
+    if (m_reservation_list.size() == m_reservation_list.capacity())
+    {
+        return nullptr;
+    }
+    m_reservation_list.push_back(r);
+    return r;
+}
+
+
+bool RealtimeKernel::remove_reservation(const std::shared_ptr<CpuReservation>& r)
+{
+    for (auto& slot : m_reservation_list)
+    {
+        if (slot && slot == r)
+        {
+            slot = nullptr;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool RealtimeKernel::serve_aperiodic_jobs(const PeriodicTask* next)
 {
+    bool ran_some_jobs = false;
+    for (auto& s : m_server_list)
+    {
+        if (s->has_pending() && admit(*s))
+        {
+            ran_some_jobs |= s->serve(next);
+        }
+    }
+    return ran_some_jobs;
+}
+
+
+bool RealtimeKernel::run_idle_tasks()
+{
+    bool ran = false;
     for (auto& t : m_idle_list)
     {
         if (t)
         {
-            if (t->is_enabled())
+            if (t->is_enabled() && admit(*t))
             {
                 t->run();
+                ran = true;
             }
         }
     }
+    return ran;
+}
+
+
+/** disabled, held and release groups without enabled members aren't */
+static bool is_schedulable(const PeriodicTask& t)
+{
+    if (!t.is_enabled() || t.is_held())
+    {
+        return false;
+    }
+    const auto* g = t.as_release_group();
+    return g == nullptr || g->has_enabled_members();
 }
 
 
@@ -119,7 +320,7 @@ std::shared_ptr<PeriodicTask> RealtimeKernel::get_earliest_next_periodic()
         {
             continue;
         }
-        if (!t->is_enabled())
+        if (!is_schedulable(*t))
         {
             // LOG_INFO(get_logger() "discarding: {} = disabled\n",
             //     t->get_name());
@@ -162,7 +363,7 @@ RealtimeKernel::get_periodics_that_can_overlap(
         {
             continue;
         }
-        if (!t->is_enabled())
+        if (!is_schedulable(*t))
         {
             // LOG_INFO(get_logger() "discarding: {} = disabled\n",
             //     t->get_name());
@@ -236,18 +437,165 @@ std::vector<PeriodicTask*> RealtimeKernel::get_sorted_realtime_tasks(
 
 
 void RealtimeKernel::step()
+{
+    const auto now = m_timer.get_time_ns();
+    close_step_accounting(now);
+    m_step = StepAccounting{ now, m_busy_time };
+
+    apply_control_commands();
+    check_mode_change();
+    release_chain_stages();
+    for (const auto& r : m_reservation_list)
+    {
+        if (r)
+        {
+            r->replenish_if_due();
+        }
+    }
+
+    run_next();
+
+    m_num_steps++;
+    m_published_steps.store(m_num_steps, std::memory_order_relaxed);
+    m_published_deadline_misses.store(
+        m_num_deadline_misses, std::memory_order_relaxed);
+
+    if (m_profile_store && now >= m_next_profile_capture)
+    {
+        m_profile_store->capture(*this, false);
+        m_next_profile_capture = now + m_profile_interval;
+    }
+
+    if (m_stats_slot)
+    {
+        if (const auto now = m_timer.get_time_ns(); now >= m_next_stats_publish)
+        {
+            publish_stats(now);
+            m_next_stats_publish = now + m_stats_interval;
+        }
+    }
+}
+
+
+void RealtimeKernel::close_step_accounting(std::chrono::nanoseconds now)
+{
+    if (!m_step.started_at)
+    {
+        return;
+    }
+    const auto total = now - *m_step.started_at;
+    const auto tasks = m_busy_time - m_step.busy_at_start;
+    auto& a = m_accounting;
+    a.total += total;
+    a.tasks += tasks;
+    a.spin += m_step.spin;
+    a.idle_sweeps += m_step.idle_sweeps;
+    a.sleep += m_step.sleep;
+
+    const auto rest = std::max(total - tasks - m_step.spin -
+            m_step.idle_sweeps - m_step.sleep,
+        std::chrono::nanoseconds(0));
+    (m_step.idle ? a.idle_sweeps : a.overhead) += rest;
+    m_step.started_at.reset();
+}
+
+
+KernelHeartbeat RealtimeKernel::get_heartbeat() const
+{
+    KernelHeartbeat hb;
+    hb.steps = m_published_steps.load(std::memory_order_relaxed);
+    hb.deadline_misses =
+        m_published_deadline_misses.load(std::memory_order_relaxed);
+    hb.running_task_id = m_running_task_id.load(std::memory_order_acquire);
+    hb.running_since = std::chrono::nanoseconds(
+        m_running_since_ns.load(std::memory_order_relaxed));
+    return hb;
+}
+
+
+void RealtimeKernel::run_next()
 {
     auto next_up = get_next_periodics();
     if (next_up.empty())
     {
-        run_idle_tasks();
+        const auto before = m_timer.get_time_ns();
+        const bool fired = run_due_timers(nullptr);
+        const bool served = serve_aperiodic_jobs(nullptr);
+        m_step.idle = !run_idle_tasks() && !served && !fired;
+        if (m_simulation && m_timer.get_time_ns() == before)
+        {
+            // nothing to run, don't let virtual time stand still:
+            m_simulation->advance(m_simulation_config.default_cost);
+        }
         return;
     }
 
     bool ran_some_idle_tasks = false;
 
-    while (next_up[0]->have_time_left_before_deadline())
+    if (m_stats_slot)
+    {
+        m_last_slack = next_up[0]->time_left_until_deadline();
+        m_min_slack = std::min(m_min_slack, m_last_slack);
+    }
+
+    const auto prefetch_window = m_wait_strategy.prefetch_window;
+    bool want_prefetch = false;
+    if (prefetch_window > std::chrono::nanoseconds(0))
+    {
+        for (const auto& t : next_up)
+        {
+            want_prefetch = want_prefetch ||
+                (t->get_task_type() == TaskType::HARD_REALTIME &&
+                    t->has_prefetch());
+        }
+    }
+
+    // the time left before the first release also tells how long each
+    // pass of this loop took, without reading the timer again:
+    auto time_left = next_up[0]->time_left_until_deadline();
+    while (time_left > std::chrono::nanoseconds(0))
     {
+        if (m_has_remote_chain_stages && release_chain_stages())
+        {
+            // a predecessor on another core completed, the next step
+            // runs the stage it released:
+            return;
+        }
+
+        if (want_prefetch && time_left <= prefetch_window)
+        {
+            for (const auto& t : next_up)
+            {
+                if (t->get_task_type() == TaskType::HARD_REALTIME)
+                {
+                    t->prefetch();
+                }
+            }
+            // from now on only spin, idle work would evict what we loaded:
+            auto left = next_up[0]->time_left_until_deadline();
+            if (m_simulation)
+            {
+                m_simulation->advance(left);
+                left = std::chrono::nanoseconds(0);
+            }
+            while (left > std::chrono::nanoseconds(0))
+            {
+                left = next_up[0]->time_left_until_deadline();
+            }
+            m_step.spin += time_left - left;
+            break;
+        }
+
+        // timers are due already, so they go first:
+        bool ran_something = run_due_timers(next_up[0].get());
+
+        // aperiodic jobs go before the idle tasks, their servers bound how
+        // much of the slack they can take:
+        if (serve_aperiodic_jobs(next_up[0].get()))
+        {
+            ran_something = true;
+        }
+
         for (auto& t : m_idle_list)
         {
             if (!t)
@@ -257,13 +605,35 @@ void RealtimeKernel::step()
             if (t->is_enabled())
             {
                 if (next_up[0]->time_left_until_deadline() >
-                    t->max_time_taken_ns())
+                        t->max_time_taken_ns() &&
+                    admit(*t))
                 {
-                    ran_some_idle_tasks = true;
+                    ran_something = true;
                     t->run();
                 }
             }
         }
+
+        if (ran_something)
+        {
+            ran_some_idle_tasks = true;
+        }
+        auto slept = std::chrono::nanoseconds(0);
+        // stages released from other cores are only noticed when awake:
+        if ((!ran_something && (!m_has_remote_chain_stages || m_simulation)) ||
+            (m_simulation && m_simulation_config.idle_once_per_release))
+        {
+            slept = idle_until_close_to(*next_up[0], time_until_next_timer());
+            m_step.sleep += slept;
+        }
+
+        const auto left_after = next_up[0]->time_left_until_deadline();
+        if (!ran_something)
+        {
+            m_step.idle_sweeps += std::max(
+                time_left - left_after - slept, std::chrono::nanoseconds(0));
+        }
+        time_left = left_after;
     }
 
 
@@ -304,7 +674,8 @@ void RealtimeKernel::step()
         }
         for (auto& it : realtime_tasks)
         {
-            it->wait_for_deadline();
+            m_step.sleep += idle_until_close_to(*it);
+            m_step.spin += it->wait_for_deadline();
             it->run_elapsed();
         }
     }
@@ -314,15 +685,72 @@ void RealtimeKernel::step()
     {
         if (it->get_task_type() != TaskType::HARD_REALTIME)
         {
-            it->run_elapsed();
+            if (admit(*it))
+            {
+                it->run_elapsed();
+            }
+            else
+            {
+                it->skip_release();
+            }
         }
     }
 }
 
+std::chrono::nanoseconds RealtimeKernel::idle_until_close_to(
+    const BaseTask& next, std::chrono::nanoseconds limit)
+{
+    auto left = next.time_left_until_deadline();
+    if (limit.count() > 0 && limit < left)
+    {
+        left = limit;
+    }
+
+    if (m_simulation)
+    {
+        m_simulation->advance(left);
+        return std::max(left, std::chrono::nanoseconds(0));
+    }
+
+    if (m_wait_strategy.kind != WaitKind::HYBRID)
+    {
+        return std::chrono::nanoseconds(0);
+    }
+
+    const auto sleep = left - m_wait_strategy.spin_window;
+    if (sleep < m_wait_strategy.min_sleep)
+    {
+        return std::chrono::nanoseconds(0);
+    }
+
+    const auto before = m_timer.get_time_ns();
+    std::this_thread::sleep_for(sleep);
+    const auto slept = m_timer.get_time_ns() - before;
+
+    m_wait_stats.num_sleeps++;
+    m_wait_stats.total_slept += slept;
+    m_wait_stats.max_oversleep =
+        std::max(m_wait_stats.max_oversleep, slept - sleep);
+    if (!next.have_time_left_before_deadline())
+    {
+        m_wait_stats.num_late_wakeups++;
+    }
+    return slept;
+}
+
+
 void RealtimeKernel::run(std::optional<const std::chrono::milliseconds> runtime)
 {
     time_utils::Timeout t{ m_timer,
         runtime.value_or(std::chrono::milliseconds(0)) };
+    m_run_started_at = m_timer.get_time_ns();
+    m_busy_time = std::chrono::nanoseconds(0);
+    m_accounting = CoreAccounting();
+    m_step = StepAccounting();
+    m_min_slack = std::chrono::nanoseconds::max();
+    m_next_stats_publish = m_run_started_at;
+    m_running = true;
+
     while (!should_exit())
     {
         step();
@@ -335,45 +763,239 @@ void RealtimeKernel::run(std::optional<const std::chrono::milliseconds> runtime)
             }
         }
     }
+
+    // don't lose what was posted while we were finishing our last step:
+    apply_control_commands();
+    m_running = false;
+
+    const auto end = m_timer.get_time_ns();
+    close_step_accounting(end);
+    if (m_profile_store)
+    {
+        m_profile_store->capture(*this);
+    }
+    if (m_stats_slot)
+    {
+        publish_stats(end);
+    }
+
+    if (m_memory_prepared)
+    {
+        m_memory_report.at_exit = get_thread_page_faults();
+    }
 }
 
 
 std::string BaseTask::get_service_status_as_json() const
 {
-    const auto warmup_micros_max = warmup_max_time_taken_us();
-    const double warmup_max_flt =
-        (warmup_micros_max.count() / (1000.0 * 1000.0));
-
-    const auto micros_max = max_time_taken_us();
-    const double max_flt = (micros_max.count() / (1000.0 * 1000.0));
+    return service::write_status_to_string(
+        [this](service::StatusWriter& w) { write_status(w); });
+}
 
-    const auto micros_avg = average_time_taken_us();
-    const double avg_flt = (micros_avg.count() / (1000.0 * 1000.0));
 
-    return std::format(
-        "{{ \"name\": \"{}\", \"max\": {},  \"warmup\": {},  \"avg\": {} }}",
-        get_name(), max_flt, warmup_max_flt, avg_flt);
+void BaseTask::write_status(service::StatusWriter& w) const
+{
+    w.begin_object();
+    w.value("name", get_name());
+    w.seconds("max", max_time_taken_us());
+    w.seconds("warmup", warmup_max_time_taken_us());
+    w.seconds("avg", average_time_taken_us());
+    w.value("misses", m_num_deadline_misses);
+
+    if (const auto* perf = m_kernel ? m_kernel->m_perf.get() : nullptr;
+        perf && m_perf_stats.samples > 0)
+    {
+        // averages per run:
+        w.begin_object("perf");
+        for (size_t i = 0; i < NUM_PERF_EVENTS; i++)
+        {
+            const auto e = (PerfEvent) i;
+            if (perf->has(e))
+            {
+                w.value(to_string(e), m_perf_stats.average(e));
+            }
+        }
+        if (const auto cycles = m_perf_stats.total[PerfEvent::CYCLES];
+            cycles > 0)
+        {
+            w.value("ipc",
+                (double) m_perf_stats.total[PerfEvent::INSTRUCTIONS] /
+                    (double) cycles);
+        }
+        w.end_object();
+    }
+    w.end_object();
 }
 
 
 std::string RealtimeKernel::get_service_status_as_json() const
 {
-    std::string ret = "\"tasks\": [";
-    const char* comma = "";
+    return service::write_status_to_string(
+        [this](service::StatusWriter& w) { write_status(w); });
+}
+
+
+void RealtimeKernel::write_status(service::StatusWriter& w) const
+{
+    w.begin_object();
+    w.value("name", m_name);
+
+    // remove() leaves empty slots behind:
+    w.begin_array("tasks");
+    bool have_groups = false;
     for (const auto& p : m_periodic_list)
     {
-        ret += comma;
-        ret += p->get_service_status_as_json() + "\n";
-        comma = ",";
+        if (!p)
+        {
+            continue;
+        }
+        if (const auto* g = p->as_release_group())
+        {
+            g->for_each_member(
+                [&w](const BaseTask& m) { m.write_status(w); });
+            have_groups = true;
+        }
+        else
+        {
+            p->write_status(w);
+        }
     }
     for (const auto& p : m_idle_list)
     {
-        ret += comma;
-        ret += p->get_service_status_as_json() + "\n";
-        comma = ",";
+        if (p)
+        {
+            p->write_status(w);
+        }
     }
-    ret += "]";
-    return ret;
+    w.end_array();
+
+    if (have_groups)
+    {
+        w.begin_array("release_groups");
+        for (const auto& p : m_periodic_list)
+        {
+            if (const auto* g = p ? p->as_release_group() : nullptr)
+            {
+                w.begin_object();
+                w.value("name", g->get_name());
+                w.seconds("period", g->get_period());
+                w.value("members", g->get_num_members());
+                w.value("releases", g->get_num_releases());
+                w.seconds("max", g->max_time_taken_ns());
+                w.seconds("max_lateness", g->get_max_release_lateness());
+                w.end_object();
+            }
+        }
+        w.end_array();
+    }
+
+    if (!m_server_list.empty())
+    {
+        w.begin_array("servers");
+        for (const auto& s : m_server_list)
+        {
+            if (s)
+            {
+                s->write_status(w);
+            }
+        }
+        w.end_array();
+    }
+
+    if (!m_reservation_list.empty())
+    {
+        w.begin_array("reservations");
+        for (const auto& r : m_reservation_list)
+        {
+            if (r)
+            {
+                r->write_status(w);
+            }
+        }
+        w.end_array();
+    }
+
+    if (!m_latest_values.empty())
+    {
+        w.begin_array("values");
+        for (const auto& v : m_latest_values)
+        {
+            v->write_status(w);
+        }
+        w.end_array();
+    }
+
+    if (m_timers)
+    {
+        const auto& s = m_timers->get_stats();
+        w.begin_object("timers");
+        w.value("pending", m_timers->size());
+        w.value("capacity", m_timers->capacity());
+        w.seconds("tick", m_timers->get_tick());
+        w.value("scheduled", s.scheduled);
+        w.value("fired", s.fired);
+        w.value("cancelled", s.cancelled);
+        w.value("full", s.full);
+        w.value("max_pending", s.max_pending);
+        w.seconds("max_lateness", s.max_lateness);
+        w.seconds("max_callback", m_max_timer_callback);
+        w.end_object();
+    }
+
+    if (m_accounting.total.count() > 0)
+    {
+        const auto& a = m_accounting;
+        w.begin_object("accounting");
+        w.seconds("total", a.total);
+        w.seconds("tasks", a.tasks);
+        w.seconds("spin", a.spin);
+        w.seconds("idle_sweeps", a.idle_sweeps);
+        w.seconds("sleep", a.sleep);
+        w.seconds("overhead", a.overhead);
+        w.end_object();
+    }
+
+    if (m_memory_prepared)
+    {
+        const auto& r = m_memory_report;
+        w.begin_object("page_faults");
+        w.value("before_prefault", r.before_prefault.minor);
+        w.value("after_prefault", r.after_prefault.minor);
+        w.value("at_exit", r.at_exit.minor);
+        w.value("major", r.at_exit.major);
+        w.end_object();
+    }
+
+    if (m_wait_strategy.kind == WaitKind::HYBRID)
+    {
+        const auto& s = m_wait_stats;
+        w.begin_object("wait");
+        w.value("sleeps", s.num_sleeps);
+        w.seconds("slept", s.total_slept);
+        w.seconds("max_oversleep", s.max_oversleep);
+        w.value("late_wakeups", s.num_late_wakeups);
+        w.end_object();
+    }
+
+    if (m_perf)
+    {
+        w.begin_object("perf");
+        w.value("mode", to_string(m_perf->get_mode()));
+        w.value("rdpmc", m_perf->uses_rdpmc());
+        w.seconds("read_overhead", m_perf->get_read_overhead());
+        w.end_object();
+    }
+
+    if (!m_modes.empty())
+    {
+        w.begin_object("mode");
+        w.value("current", get_current_mode());
+        w.value("changes", m_num_mode_changes);
+        w.seconds("last_latency", m_last_mode_change_latency);
+        w.seconds("max_latency", m_max_mode_change_latency);
+        w.end_object();
+    }
+    w.end_object();
 }
 
 
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <numeric>
+#include <string>
+
+#include <urtsched/RealtimeKernel.hpp>
+#include <urtsched/ReleaseGroup.hpp>
+
+
+namespace realtime
+{
+
+static task_func_t no_callback()
+{
+    // the group's own callback never runs, see BaseTask::run_elapsed():
+    return [](BaseTask&) { return TaskStatus::TASK_OK; };
+}
+
+
+ReleaseGroup::ReleaseGroup(time_utils::ITimer& timer, TaskType tt,
+    const std::string& name, const std::chrono::microseconds& t,
+    logging::ILogger& logger, RealtimeKernel* kernel)
+    : PeriodicTask(timer, tt, name, t, no_callback(), logger, kernel)
+{
+    m_release_group = this;
+}
+
+
+bool ReleaseGroup::can_take(
+    TaskType tt, const std::chrono::microseconds& t) const
+{
+    const auto period = get_period();
+    return tt == get_task_type() && get_num_members() < MAX_MEMBERS &&
+        t.count() > 0 && period.count() > 0 &&
+        (t % period == std::chrono::microseconds(0) ||
+            period % t == std::chrono::microseconds(0));
+}
+
+
+void ReleaseGroup::rebase(const std::chrono::microseconds& t)
+{
+    const auto factor = (uint64_t) (get_period() / t);
+    assert(factor > 0 && get_period() % t == std::chrono::microseconds(0));
+    // so a member with k times the old period still runs at multiples of
+    // k * factor:
+    m_num_releases *= factor;
+    set_period(t);
+}
+
+
+bool ReleaseGroup::add_member(const std::shared_ptr<PeriodicTask>& task)
+{
+    for (auto& m : m_members)
+    {
+        if (m == nullptr)
+        {
+            m = task;
+            return true;
+        }
+    }
+    if (m_members.size() == m_members.capacity())
+    {
+        return false;
+    }
+    m_members.push_back(task);
+    return true;
+}
+
+
+bool ReleaseGroup::remove_member(const std::shared_ptr<PeriodicTask>& task)
+{
+    for (auto& m : m_members)
+    {
+        if (m && m == task)
+        {
+            m = nullptr;
+            fit_period();
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void ReleaseGroup::fit_period()
+{
+    int64_t gcd = 0;
+    for (const auto& m : m_members)
+    {
+        if (m)
+        {
+            gcd = std::gcd(gcd, (int64_t) m->get_period().count());
+        }
+    }
+    const auto period = get_period();
+    if (gcd == 0 || gcd == period.count())
+    {
+        return;
+    }
+    if (gcd < period.count())
+    {
+        rebase(std::chrono::microseconds(gcd));
+        return;
+    }
+    // the members' periods are multiples of ours, so is their divisor:
+    const auto factor = (uint64_t) (gcd / period.count());
+    m_num_releases /= factor;
+    set_period(std::chrono::microseconds(gcd));
+}
+
+
+bool ReleaseGroup::has_enabled_members() const
+{
+    return std::any_of(m_members.begin(), m_members.end(),
+        [](const auto& m) { return m && m->is_enabled(); });
+}
+
+
+size_t ReleaseGroup::get_num_members() const
+{
+    return std::count_if(m_members.begin(), m_members.end(),
+        [](const auto& m) { return m != nullptr; });
+}
+
+
+std::chrono::nanoseconds ReleaseGroup::run_members()
+{
+    const auto period = get_period();
+    const auto release = m_num_releases++;
+    m_num_calls++;
+
+    auto took = std::chrono::nanoseconds(0);
+    auto worst_case = std::chrono::nanoseconds(0);
+    for (const auto& m : m_members)
+    {
+        if (!m || !m->is_enabled())
+        {
+            continue;
+        }
+        worst_case += m->max_time_taken_ns();
+        const auto every = (uint64_t) std::max<int64_t>(
+            m->get_period() / period, 1);
+        if (release % every != 0)
+        {
+            continue;
+        }
+        auto* r = m->get_reservation();
+        if (r != nullptr && !r->admit())
+        {
+            continue;
+        }
+        // released with the group, so it waited for the members before it:
+        m->m_last_release_lateness = m_last_release_lateness + took;
+        m->m_max_release_lateness =
+            std::max(m->m_max_release_lateness, m->m_last_release_lateness);
+        const auto t = m->run();
+        m->count_deadline_miss_if_late(t);
+        took += t;
+    }
+
+    // what the scheduler plans with: all members due at once
+    m_max_time_taken = std::max(worst_case, took);
+    m_total_time_taken_us +=
+        std::chrono::duration_cast<std::chrono::microseconds>(took);
+    return took;
+}
+
+
+std::shared_ptr<PeriodicTask> RealtimeKernel::add_periodic_grouped(TaskType tt,
+    const std::string& name, const std::chrono::microseconds& interval,
+    const task_func_t& callback)
+{
+    ReleaseGroup* group = nullptr;
+    size_t num_groups = 0;
+    for (const auto& t : m_periodic_list)
+    {
+        auto* g = t ? t->as_release_group() : nullptr;
+        num_groups += g != nullptr;
+        if (g == nullptr || !g->can_take(tt, interval))
+        {
+            continue;
+        }
+        // joining without a rebase keeps the group's releases as they are:
+        if (group == nullptr ||
+            interval % g->get_period() == std::chrono::microseconds(0))
+        {
+            group = g;
+        }
+    }
+    if (group == nullptr)
+    {
+        if (!take_slot(m_periodic_slots, MAX_PERIODIC_TASKS))
+        {
+            return nullptr;
+        }
+        auto g = std::make_shared<ReleaseGroup>(m_timer, tt,
+            "release group " + std::to_string(num_groups), interval, m_logger,
+            this);
+        g->enable();
+        if (!insert_periodic(g))
+        {
+            m_periodic_slots.fetch_sub(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        group = g.get();
+    }
+    else if (interval < group->get_period())
+    {
+        group->rebase(interval);
+    }
+
+    auto s = std::make_shared<PeriodicTask>(
+        m_timer, tt, "periodic: " + name, interval, callback, m_logger, this);
+    s->disable();
+    task_created(*s, RecordedTaskKind::PERIODIC);
+    group->add_member(s);
+    return s;
+}
+
+} // namespace realtime
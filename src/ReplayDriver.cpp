@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include <urtsched/RealtimeKernel.hpp>
+#include <urtsched/ReplayDriver.hpp>
+#include <urtsched/StatusWriter.hpp>
+
+
+namespace realtime
+{
+
+/** the name as given to the kernel, without its "periodic: " etc. prefix */
+static std::string plain_name(const std::string& name)
+{
+    for (const char* prefix : { "periodic: ", "idle: ", "server: " })
+    {
+        if (name.starts_with(prefix))
+        {
+            return name.substr(strlen(prefix));
+        }
+    }
+    return name;
+}
+
+
+const ReplayTaskResult* ReplayReport::find(const std::string& name) const
+{
+    for (const auto& t : tasks)
+    {
+        if (t.name == name)
+        {
+            return &t;
+        }
+    }
+    return nullptr;
+}
+
+
+std::string ReplayReport::to_json() const
+{
+    return service::write_status_to_string([this](service::StatusWriter& w) {
+        w.begin_object();
+        w.value("deadline_misses", total_deadline_misses);
+        w.begin_array("tasks");
+        for (const auto& t : tasks)
+        {
+            w.begin_object();
+            w.value("name", t.name);
+            w.value("core", t.core);
+            w.value("hard_realtime", t.type == TaskType::HARD_REALTIME);
+            w.value("runs", t.runs);
+            w.value("misses", t.deadline_misses);
+            w.seconds("max_lateness", t.max_release_lateness);
+            w.end_object();
+        }
+        w.end_array();
+        w.end_object();
+    });
+}
+
+
+ReplayReport ReplayDriver::run(const ReplayConfig& config) const
+{
+    struct Core
+    {
+        SimulatedTimer timer;
+        std::unique_ptr<RealtimeKernel> kernel;
+    };
+
+    struct Replayed
+    {
+        std::shared_ptr<BaseTask> task;
+        ReplayTaskResult result;
+    };
+
+    std::vector<std::unique_ptr<Core>> cores;
+    const auto get_core = [&](size_t ix) -> RealtimeKernel& {
+        while (cores.size() <= ix)
+        {
+            auto c = std::make_unique<Core>();
+            c->kernel = std::make_unique<RealtimeKernel>(c->timer, m_logger,
+                "replay-" + std::to_string(cores.size()));
+            c->kernel->enable_simulation(c->timer, config.simulation);
+            cores.push_back(std::move(c));
+        }
+        return *cores[ix]->kernel;
+    };
+
+    std::chrono::nanoseconds duration = std::chrono::nanoseconds(0);
+
+    // stable addresses, the task callbacks refer to their result:
+    std::vector<std::unique_ptr<Replayed>> replayed;
+    for (size_t core_ix = 0; core_ix < m_recordings.size(); core_ix++)
+    {
+        const auto& recording = m_recordings[core_ix];
+        duration = std::max(duration, recording.span());
+
+        for (const auto& recorded : recording.tasks)
+        {
+            const auto name = plain_name(recorded.name);
+            const auto placed = config.placement.find(name);
+            const auto core =
+                placed != config.placement.end() ? placed->second : core_ix;
+            auto& kernel = get_core(core);
+
+            auto r = std::make_unique<Replayed>();
+            r->result.name = name;
+            r->result.core = core;
+            auto& result = r->result;
+            const auto callback = [&result](BaseTask& t) {
+                result.runs++;
+                result.max_release_lateness = std::max(
+                    result.max_release_lateness, t.get_last_release_lateness());
+                return TaskStatus::TASK_OK;
+            };
+
+            if (recorded.kind == RecordedTaskKind::PERIODIC)
+            {
+                const auto period = config.periods.contains(name)
+                    ? config.periods.at(name)
+                    : std::chrono::duration_cast<std::chrono::microseconds>(
+                          recorded.period);
+                const auto type = config.task_types.contains(name)
+                    ? config.task_types.at(name)
+                    : recorded.type;
+                r->result.type = type;
+                auto t = kernel.add_periodic(type, name, period, callback);
+                if (t)
+                {
+                    t->enable();
+                }
+                r->task = t;
+            }
+            else
+            {
+                r->task = kernel.add_idle_task(name, callback);
+            }
+            if (!r->task)
+            {
+                // more tasks placed on this core than it takes:
+                continue;
+            }
+            r->task->set_cost_model(std::make_shared<ReplayCost>(
+                recording.durations_of(recorded.id)));
+            replayed.push_back(std::move(r));
+        }
+    }
+
+    const auto runtime = std::max(std::chrono::milliseconds(1),
+        std::chrono::ceil<std::chrono::milliseconds>(
+            config.duration.value_or(duration)));
+    for (auto& c : cores)
+    {
+        c->kernel->run(runtime);
+    }
+
+    ReplayReport report;
+    for (auto& r : replayed)
+    {
+        r->result.deadline_misses = r->task->get_num_deadline_misses();
+        report.total_deadline_misses += r->result.deadline_misses;
+        report.tasks.push_back(r->result);
+    }
+    return report;
+}
+
+} // namespace realtime
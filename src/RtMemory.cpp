@@ -0,0 +1,155 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <alloca.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <urtsched/CoreArena.hpp>
+#include <urtsched/RtMemory.hpp>
+
+#include <slogger/ILogger.hpp>
+
+
+namespace realtime
+{
+
+size_t ArenaConfig::total_bytes() const
+{
+    size_t pools = 0;
+    for (size_t i = 0; i < CoreArena::NUM_POOLS; i++)
+    {
+        pools += (CoreArena::MIN_BLOCK_SIZE << i) * blocks_per_pool;
+    }
+    return scratch_bytes + pools;
+}
+
+
+static constexpr size_t HUGEPAGE_SIZE = 2 * 1024 * 1024;
+
+
+PageFaultCounts get_thread_page_faults()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) != 0)
+    {
+        return {};
+    }
+    return PageFaultCounts{ (uint64_t) usage.ru_minflt,
+        (uint64_t) usage.ru_majflt };
+}
+
+
+bool lock_all_memory(logging::ILogger& logger)
+{
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        LOG_ERROR(logger, "failed to lock memory: {}", strerror(errno));
+        return false;
+    }
+    LOG_INFO(logger, "locked all current and future memory");
+    return true;
+}
+
+
+__attribute__((noinline)) void prefault_stack(size_t bytes)
+{
+    if (bytes == 0)
+    {
+        return;
+    }
+
+    auto* stack = static_cast<char*>(alloca(bytes));
+    const auto page_size = (size_t) sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < bytes; i += page_size)
+    {
+        stack[i] = 0;
+    }
+    // keep the compiler from optimizing the stores away:
+    asm volatile("" : : "r"(stack) : "memory");
+}
+
+
+RtMemoryRegion::RtMemoryRegion(size_t bytes, logging::ILogger& logger)
+{
+    if (bytes == 0)
+    {
+        return;
+    }
+
+    const auto huge_size = (bytes + HUGEPAGE_SIZE - 1) & ~(HUGEPAGE_SIZE - 1);
+    void* p = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    if (p != MAP_FAILED)
+    {
+        m_data = p;
+        m_size = huge_size;
+        m_hugepages = true;
+    }
+    else
+    {
+        LOG_INFO(logger, "no hugepages available ({}), using normal pages",
+            strerror(errno));
+
+        p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+        {
+            LOG_ERROR(logger, "failed to map {} bytes: {}", bytes,
+                strerror(errno));
+            return;
+        }
+        m_data = p;
+        m_size = bytes;
+        madvise(m_data, m_size, MADV_HUGEPAGE);
+    }
+
+    // fault everything in now instead of in the real-time loop:
+    memset(m_data, 0, m_size);
+}
+
+
+RtMemoryRegion::~RtMemoryRegion()
+{
+    release();
+}
+
+
+RtMemoryRegion::RtMemoryRegion(RtMemoryRegion&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr))
+    , m_size(std::exchange(other.m_size, 0))
+    , m_hugepages(std::exchange(other.m_hugepages, false))
+{
+}
+
+
+RtMemoryRegion& RtMemoryRegion::operator=(RtMemoryRegion&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_hugepages = std::exchange(other.m_hugepages, false);
+    }
+    return *this;
+}
+
+
+void RtMemoryRegion::release()
+{
+    if (m_data != nullptr)
+    {
+        munmap(m_data, m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+} // namespace realtime
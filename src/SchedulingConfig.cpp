@@ -0,0 +1,200 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <urtsched/RealtimeKernel.hpp>
+#include <urtsched/SchedulingConfig.hpp>
+
+#include <slogger/ILogger.hpp>
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+
+namespace realtime
+{
+namespace
+{
+    // glibc has no wrapper for sched_setattr() and sched_getattr() (yet)
+    struct sched_attr
+    {
+        uint32_t size;
+        uint32_t sched_policy;
+        uint64_t sched_flags;
+        int32_t sched_nice;
+        uint32_t sched_priority;
+        uint64_t sched_runtime;
+        uint64_t sched_deadline;
+        uint64_t sched_period;
+    };
+
+    int to_linux_policy(SchedPolicy policy)
+    {
+        switch (policy)
+        {
+        case SchedPolicy::OTHER:
+            return SCHED_OTHER;
+        case SchedPolicy::FIFO:
+            return SCHED_FIFO;
+        case SchedPolicy::RR:
+            return SCHED_RR;
+        case SchedPolicy::DEADLINE:
+            return SCHED_DEADLINE;
+        }
+        return SCHED_OTHER;
+    }
+
+    /** the sched_attr flags that need no more than the fields above
+     * (SCHED_FLAG_RESET_ON_FORK, _RECLAIM and _DL_OVERRUN) */
+    constexpr uint64_t RESTORABLE_SCHED_FLAGS = 0x07;
+} // namespace
+
+
+error::Error RealtimeKernel::apply_scheduling(uint32_t core)
+{
+    const auto& config = m_scheduling_config;
+    auto result = set_sched_affinity(config.core.value_or(core));
+
+    if (!config.policy)
+    {
+        // as the thread is
+    }
+    else if (*config.policy == SchedPolicy::DEADLINE)
+    {
+        sched_attr attr{};
+        attr.size = sizeof(attr);
+        attr.sched_policy = SCHED_DEADLINE;
+        attr.sched_runtime = (uint64_t) config.runtime.count();
+        attr.sched_deadline = (uint64_t) config.deadline.count();
+        attr.sched_period = (uint64_t) config.period.count();
+        if (syscall(SYS_sched_setattr, 0, &attr, 0) != 0)
+        {
+            LOG_ERROR(get_logger(),
+                "{} - failed to set SCHED_DEADLINE (runtime {}, deadline {}, "
+                "period {}): {}",
+                m_name, config.runtime, config.deadline, config.period,
+                strerror(errno));
+            result = error::Error::FAILED;
+        }
+    }
+    else
+    {
+        sched_param param{};
+        param.sched_priority =
+            *config.policy == SchedPolicy::OTHER ? 0 : config.priority;
+        if (const int status = pthread_setschedparam(pthread_self(),
+                to_linux_policy(*config.policy), &param);
+            status != 0)
+        {
+            LOG_ERROR(get_logger(),
+                "{} - failed to set scheduling policy {} priority {}: {}",
+                m_name, to_linux_policy(*config.policy), config.priority,
+                strerror(status));
+            result = error::Error::FAILED;
+        }
+    }
+
+    if (config.timer_slack)
+    {
+        if (prctl(PR_SET_TIMERSLACK, (unsigned long) config.timer_slack->count(),
+                0, 0, 0) != 0)
+        {
+            LOG_ERROR(get_logger(), "{} - failed to set timer slack: {}",
+                m_name, strerror(errno));
+            result = error::Error::FAILED;
+        }
+    }
+    return result;
+}
+
+
+ThreadSchedulingState save_thread_scheduling()
+{
+    ThreadSchedulingState state;
+
+    sched_attr attr{};
+    if (syscall(SYS_sched_getattr, 0, &attr, sizeof(attr), 0) == 0)
+    {
+        state.policy = (int) attr.sched_policy;
+        state.priority = (int) attr.sched_priority;
+        state.flags = attr.sched_flags & RESTORABLE_SCHED_FLAGS;
+        state.nice = attr.sched_nice;
+        state.runtime = std::chrono::nanoseconds(attr.sched_runtime);
+        state.deadline = std::chrono::nanoseconds(attr.sched_deadline);
+        state.period = std::chrono::nanoseconds(attr.sched_period);
+    }
+    else
+    {
+        sched_param param{};
+        if (pthread_getschedparam(pthread_self(), &state.policy, &param) == 0)
+        {
+            state.priority = param.sched_priority;
+        }
+    }
+
+    const auto slack = prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+    state.timer_slack_ns = slack > 0 ? (uint64_t) slack : 0;
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0)
+    {
+        std::vector<uint32_t> cpus;
+        for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET(cpu, &cpuset))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        state.cpus = cpus;
+    }
+    return state;
+}
+
+
+void restore_thread_scheduling(const ThreadSchedulingState& state)
+{
+    // sched_setattr() also takes SCHED_DEADLINE's runtime, deadline and
+    // period, which pthread_setschedparam() can't set:
+    sched_attr attr{};
+    attr.size = sizeof(attr);
+    attr.sched_policy = (uint32_t) state.policy;
+    attr.sched_flags = state.flags;
+    attr.sched_nice = state.nice;
+    attr.sched_priority = (uint32_t) state.priority;
+    attr.sched_runtime = (uint64_t) state.runtime.count();
+    attr.sched_deadline = (uint64_t) state.deadline.count();
+    attr.sched_period = (uint64_t) state.period.count();
+    if (syscall(SYS_sched_setattr, 0, &attr, 0) != 0)
+    {
+        sched_param param{};
+        param.sched_priority = state.priority;
+        pthread_setschedparam(pthread_self(), state.policy, &param);
+    }
+
+    prctl(PR_SET_TIMERSLACK, (unsigned long) state.timer_slack_ns, 0, 0, 0);
+
+    if (state.cpus)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        for (const auto cpu : *state.cpus)
+        {
+            CPU_SET(cpu, &cpuset);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+    }
+}
+
+} // namespace realtime
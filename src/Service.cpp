@@ -21,10 +21,68 @@ void Service::run_oneshot_idle_task(
             t.disable();
             return f(t);
         });
+    if (!task)
+    {
+        LOG_ERROR(get_logger(), "no room for idle task {}", name);
+        return;
+    }
 
     m_tasks[name] = task;
+    own(task);
 
     task->enable();
 }
 
+
+void Service::set_cpu_reservation(const std::string& name,
+    const std::chrono::microseconds& budget,
+    const std::chrono::microseconds& period)
+{
+    if (m_reservation)
+    {
+        // replaced, the tasks move over below:
+        get_rt_kernel()->remove_reservation(m_reservation);
+    }
+    m_reservation = get_rt_kernel()->add_reservation(name, budget, period);
+    if (!m_reservation)
+    {
+        LOG_ERROR(get_logger(), "no room for cpu reservation {}", name);
+    }
+    for (auto& t : m_own_tasks)
+    {
+        t->set_reservation(m_reservation.get());
+    }
+}
+
+
+std::shared_ptr<realtime::PeriodicTask> Service::add_periodic(
+    realtime::TaskType tt, const std::string& name,
+    const std::chrono::microseconds& interval,
+    const realtime::task_func_t& callback)
+{
+    auto task = get_rt_kernel()->add_periodic(tt, name, interval, callback);
+    own(task);
+    return task;
+}
+
+
+std::shared_ptr<realtime::IdleTask> Service::add_idle_task(
+    const std::string& name, const realtime::task_func_t& callback)
+{
+    auto task = get_rt_kernel()->add_idle_task(name, callback);
+    own(task);
+    return task;
+}
+
+
+void Service::own(const std::shared_ptr<realtime::BaseTask>& task)
+{
+    if (!task)
+    {
+        return;
+    }
+    task->set_reservation(m_reservation.get());
+    m_own_tasks.push_back(task);
+}
+
 } // namespace service
\ No newline at end of file
@@ -6,24 +6,31 @@ namespace service
 {
     std::string ServiceBus::get_service_status_as_json()
     {
-        std::string ret;
-        const char* comma = "";
-        for (auto& s : m_services)
+        return write_status_to_string(
+            [this](StatusWriter& w) { write_status(w); });
+    }
+
+
+    size_t ServiceBus::write_status(
+        std::span<char> buffer, StatusFormat format) const
+    {
+        StatusWriter w(buffer, format);
+        write_status(w);
+        return w.bytes_needed();
+    }
+
+
+    void ServiceBus::write_status(StatusWriter& w) const
+    {
+        w.begin_array();
+        for (const auto& s : m_services)
         {
-            if (const auto& k = s->get_service_status_as_json(); ! k.empty())
+            if (s)
             {
-                ret += comma;
-
-                if (ret.empty())
-                {
-                    ret = k;
-                } else {
-                    ret += k;
-                }
-                comma = ",";
+                s->write_status(w);
             }
         }
-        return ret;
+        w.end_array();
     }
 
-} // namespace service
\ No newline at end of file
+} // namespace service
@@ -0,0 +1,32 @@
+#include <algorithm>
+#include <cmath>
+
+#include <urtsched/Simulation.hpp>
+
+
+namespace realtime
+{
+
+std::chrono::nanoseconds NormalCost::next_cost()
+{
+    const auto cost =
+        std::chrono::nanoseconds((int64_t) std::llround(m_dist(m_rng)));
+    return std::clamp(cost, m_min, m_max);
+}
+
+
+std::chrono::nanoseconds ReplayCost::next_cost()
+{
+    if (m_costs.empty())
+    {
+        return std::chrono::nanoseconds(0);
+    }
+    if (m_next == m_costs.size())
+    {
+        m_next = 0;
+        m_num_wraps++;
+    }
+    return m_costs[m_next++];
+}
+
+} // namespace realtime
@@ -0,0 +1,324 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <urtsched/RealtimeKernel.hpp>
+#include <urtsched/StatsSegment.hpp>
+
+
+namespace realtime
+{
+using namespace stats_layout;
+
+static void copy_name(char (&dest)[NAME_LEN], const std::string& name)
+{
+    const auto len = std::min(name.size(), NAME_LEN - 1);
+    memcpy(dest, name.data(), len);
+    dest[len] = '\0';
+}
+
+
+/** whether the segment 'name' was left behind by a process that is gone,
+ * one that is still being set up counts as in use */
+static bool is_stale(const std::string& name)
+{
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        // removed in the meantime:
+        return errno == ENOENT;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header))
+    {
+        close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        return false;
+    }
+    const auto pid = static_cast<const Header*>(p)->pid;
+    munmap(p, sizeof(Header));
+    return pid > 0 && (pid_t) pid != getpid() && kill((pid_t) pid, 0) != 0 &&
+        errno == ESRCH;
+}
+
+
+StatsSegment::StatsSegment(
+    const std::string& name, uint32_t num_kernels, logging::ILogger& logger)
+    : m_name(name)
+{
+    if (num_kernels > MAX_KERNELS)
+    {
+        LOG_ERROR(logger, "stats segment {}: {} kernels, at most {} supported",
+            name, num_kernels, MAX_KERNELS);
+        return;
+    }
+
+    // never take over (and later remove) a segment that is in use:
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && errno == EEXIST && is_stale(name))
+    {
+        LOG_INFO(logger, "replacing stats segment {} of a dead process", name);
+        shm_unlink(name.c_str());
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd < 0)
+    {
+        LOG_ERROR(logger, "failed to create stats segment {}: {}", name,
+            errno == EEXIST ? "in use by another process" : strerror(errno));
+        return;
+    }
+    if (ftruncate(fd, sizeof(Segment)) != 0)
+    {
+        LOG_ERROR(logger, "failed to size stats segment {}: {}", name,
+            strerror(errno));
+        close(fd);
+        shm_unlink(name.c_str());
+        return;
+    }
+    void* p = mmap(
+        nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        LOG_ERROR(logger, "failed to map stats segment {}: {}", name,
+            strerror(errno));
+        shm_unlink(name.c_str());
+        return;
+    }
+
+    m_segment = static_cast<Segment*>(p);
+    memset(static_cast<void*>(m_segment), 0, sizeof(Segment));
+    auto& h = m_segment->header;
+    h.version = VERSION;
+    h.header_size = sizeof(Header);
+    h.kernel_stats_size = sizeof(KernelStats);
+    h.task_stats_size = sizeof(TaskStats);
+    h.num_kernels = num_kernels;
+    h.pid = getpid();
+    // readers check the magic last:
+    std::atomic_ref<uint32_t>(h.magic).store(MAGIC, std::memory_order_release);
+}
+
+
+StatsSegment::~StatsSegment()
+{
+    if (m_segment)
+    {
+        munmap(m_segment, sizeof(Segment));
+        shm_unlink(m_name.c_str());
+    }
+}
+
+
+KernelStats* StatsSegment::kernel_slot(uint32_t ix)
+{
+    if (!m_segment || ix >= m_segment->header.num_kernels)
+    {
+        return nullptr;
+    }
+    return &m_segment->kernels[ix];
+}
+
+
+StatsReader::StatsReader(const std::string& name)
+{
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header))
+    {
+        close(fd);
+        return;
+    }
+    void* p = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        return;
+    }
+
+    const auto* segment = static_cast<const Segment*>(p);
+    const auto& h = segment->header;
+    const auto magic = std::atomic_ref<uint32_t>(const_cast<uint32_t&>(h.magic))
+                           .load(std::memory_order_acquire);
+    // older writers have a shorter KernelStats, newer ones a longer one:
+    if (magic != MAGIC || h.version == 0 ||
+        h.header_size < sizeof(Header) ||
+        h.kernel_stats_size < kernel_stats_size(std::min(h.version, VERSION)) ||
+        h.kernel_stats_size % alignof(KernelStats) != 0 ||
+        h.header_size % alignof(KernelStats) != 0 ||
+        h.task_stats_size != sizeof(TaskStats) ||
+        (size_t) st.st_size <
+            h.header_size + (size_t) h.num_kernels * h.kernel_stats_size)
+    {
+        munmap(p, (size_t) st.st_size);
+        return;
+    }
+    m_segment = segment;
+    m_size = (size_t) st.st_size;
+}
+
+
+StatsReader::~StatsReader()
+{
+    if (m_segment)
+    {
+        munmap(const_cast<Segment*>(m_segment), m_size);
+    }
+}
+
+
+uint32_t StatsReader::get_num_kernels() const
+{
+    return m_segment ? m_segment->header.num_kernels : 0;
+}
+
+
+int64_t StatsReader::get_pid() const
+{
+    return m_segment ? m_segment->header.pid : 0;
+}
+
+
+const KernelStats& StatsReader::kernel(uint32_t ix) const
+{
+    const auto& h = m_segment->header;
+    const auto* base = reinterpret_cast<const char*>(m_segment);
+    return *reinterpret_cast<const KernelStats*>(
+        base + h.header_size + (size_t) ix * h.kernel_stats_size);
+}
+
+
+bool StatsReader::read_kernel(uint32_t ix, KernelStats& out) const
+{
+    if (ix >= get_num_kernels())
+    {
+        return false;
+    }
+    const auto& slot = kernel(ix);
+    std::atomic_ref<uint64_t> seq(const_cast<uint64_t&>(slot.seq));
+    // only the fields the writer's version has:
+    const auto size = kernel_stats_size(std::min(get_version(), VERSION));
+
+    for (int attempt = 0; attempt < 100; attempt++)
+    {
+        const auto before = seq.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            continue;
+        }
+        memcpy(static_cast<void*>(&out), &slot, size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq.load(std::memory_order_relaxed) == before)
+        {
+            memset(reinterpret_cast<char*>(&out) + size, 0, sizeof(out) - size);
+            out.seq = before;
+            if (get_version() < 3)
+            {
+                out.total_tasks = out.num_tasks;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static void publish_task(TaskStats& out, const BaseTask& t, TaskKind kind)
+{
+    copy_name(out.name, t.get_name());
+    out.id = t.get_id();
+    out.kind = kind;
+    out.period_ns = std::chrono::nanoseconds(t.get_period()).count();
+    out.runs = t.get_num_calls();
+    out.deadline_misses = t.get_num_deadline_misses();
+    out.max_exec_ns = t.max_time_taken_ns().count();
+    out.total_exec_ns = t.get_total_time_taken().count();
+    out.last_release_lateness_ns = t.get_last_release_lateness().count();
+    out.max_release_lateness_ns = t.get_max_release_lateness().count();
+    const auto& hist = t.get_exec_histogram();
+    std::copy(hist.begin(), hist.end(), out.exec_histogram);
+}
+
+
+void RealtimeKernel::publish_stats(std::chrono::nanoseconds now)
+{
+    auto& s = *m_stats_slot;
+    std::atomic_ref<uint64_t> seq(s.seq);
+    const auto start = seq.load(std::memory_order_relaxed);
+    seq.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    copy_name(s.name, m_name);
+    s.core = m_stats_core;
+    s.published_at_ns = now.count();
+    s.steps = m_num_steps;
+    s.deadline_misses = m_num_deadline_misses;
+    s.elapsed_ns = (now - m_run_started_at).count();
+    s.busy_ns = m_busy_time.count();
+    s.last_slack_ns = m_last_slack.count();
+    s.min_slack_ns = m_min_slack == std::chrono::nanoseconds::max()
+        ? 0
+        : m_min_slack.count();
+    s.spin_ns = m_accounting.spin.count();
+    s.idle_sweep_ns = m_accounting.idle_sweeps.count();
+    s.sleep_ns = m_accounting.sleep.count();
+    s.overhead_ns = m_accounting.overhead.count();
+
+    uint32_t n = 0;
+    uint32_t total = 0;
+    const auto add = [&](const BaseTask& t, TaskKind kind) {
+        total++;
+        if (n < MAX_TASKS)
+        {
+            publish_task(s.tasks[n++], t, kind);
+        }
+    };
+    for (const auto& t : m_periodic_list)
+    {
+        if (!t)
+        {
+            continue;
+        }
+        if (const auto* g = t->as_release_group())
+        {
+            g->for_each_member([&](const BaseTask& m) { add(m, PERIODIC); });
+        }
+        else
+        {
+            add(*t, PERIODIC);
+        }
+    }
+    for (const auto& t : m_idle_list)
+    {
+        if (t)
+        {
+            add(*t, IDLE);
+        }
+    }
+    for (const auto& t : m_server_list)
+    {
+        add(*t, SERVER);
+    }
+    s.num_tasks = n;
+    s.total_tasks = total;
+
+    seq.store(start + 2, std::memory_order_release);
+}
+
+} // namespace realtime
@@ -0,0 +1,459 @@
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <format>
+
+#include <urtsched/StatusWriter.hpp>
+
+
+namespace service
+{
+
+static constexpr char BINARY_MAGIC[4] = { 'U', 'R', 'S', 'B' };
+
+
+StatusWriter::StatusWriter(std::span<char> buffer, StatusFormat format)
+    : m_buffer(buffer)
+    , m_format(format)
+{
+    if (m_format == StatusFormat::BINARY)
+    {
+        put(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        put_raw(BINARY_VERSION);
+    }
+}
+
+
+void StatusWriter::put(const void* data, size_t n)
+{
+    if (m_pos < m_buffer.size())
+    {
+        memcpy(m_buffer.data() + m_pos, data,
+            std::min(n, m_buffer.size() - m_pos));
+    }
+    m_pos += n;
+}
+
+
+void StatusWriter::put_escaped(std::string_view s)
+{
+    put_char('"');
+    for (const char c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            put_char('\\');
+            put_char(c);
+        }
+        else if ((unsigned char) c < 0x20)
+        {
+            char buf[8];
+            const auto r = std::format_to_n(
+                buf, sizeof(buf), "\\u{:04x}", (unsigned) (unsigned char) c);
+            put(buf, (size_t) r.size);
+        }
+        else
+        {
+            put_char(c);
+        }
+    }
+    put_char('"');
+}
+
+
+bool StatusWriter::element(std::string_view key, Tag tag)
+{
+    if (m_skipped_depth > 0)
+    {
+        return false;
+    }
+    const bool keyed = m_in_object[m_depth];
+    if (m_format == StatusFormat::JSON)
+    {
+        if (m_need_comma[m_depth])
+        {
+            put_char(',');
+        }
+        if (keyed)
+        {
+            put_escaped(key);
+            put_char(':');
+        }
+    }
+    else
+    {
+        put_raw(tag);
+        if (keyed)
+        {
+            const auto len = (uint8_t) std::min<size_t>(key.size(), UINT8_MAX);
+            put_raw(len);
+            put(key.data(), len);
+        }
+    }
+    m_need_comma[m_depth] = true;
+    return true;
+}
+
+
+void StatusWriter::begin(std::string_view key, Tag tag, bool object)
+{
+    if (m_skipped_depth > 0 || m_depth + 1 >= MAX_DEPTH)
+    {
+        m_skipped_depth++;
+        m_too_deep = true;
+        return;
+    }
+    element(key, tag);
+    if (m_format == StatusFormat::JSON)
+    {
+        put_char(object ? '{' : '[');
+    }
+    m_depth++;
+    m_in_object[m_depth] = object;
+    m_need_comma[m_depth] = false;
+}
+
+
+void StatusWriter::end(Tag tag)
+{
+    if (m_skipped_depth > 0)
+    {
+        m_skipped_depth--;
+        return;
+    }
+    assert(m_depth > 0);
+    if (m_format == StatusFormat::JSON)
+    {
+        put_char(m_in_object[m_depth] ? '}' : ']');
+    }
+    else
+    {
+        put_raw(tag);
+    }
+    m_depth--;
+}
+
+
+void StatusWriter::begin_object()
+{
+    begin({}, TAG_OBJECT_BEGIN, true);
+}
+
+
+void StatusWriter::begin_object(std::string_view key)
+{
+    begin(key, TAG_OBJECT_BEGIN, true);
+}
+
+
+void StatusWriter::end_object()
+{
+    end(TAG_OBJECT_END);
+}
+
+
+void StatusWriter::begin_array()
+{
+    begin({}, TAG_ARRAY_BEGIN, false);
+}
+
+
+void StatusWriter::begin_array(std::string_view key)
+{
+    begin(key, TAG_ARRAY_BEGIN, false);
+}
+
+
+void StatusWriter::end_array()
+{
+    end(TAG_ARRAY_END);
+}
+
+
+void StatusWriter::value(std::string_view key, std::string_view v)
+{
+    if (!element(key, TAG_STRING))
+    {
+        return;
+    }
+    if (m_format == StatusFormat::JSON)
+    {
+        put_escaped(v);
+    }
+    else
+    {
+        const auto len = (uint16_t) std::min<size_t>(v.size(), UINT16_MAX);
+        put_raw(len);
+        put(v.data(), len);
+    }
+}
+
+
+void StatusWriter::value(std::string_view key, bool v)
+{
+    if (!element(key, TAG_BOOL))
+    {
+        return;
+    }
+    if (m_format == StatusFormat::JSON)
+    {
+        put(v ? "true" : "false", v ? 4 : 5);
+    }
+    else
+    {
+        put_raw((uint8_t) v);
+    }
+}
+
+
+void StatusWriter::value(std::string_view key, double v)
+{
+    if (!element(key, TAG_DOUBLE))
+    {
+        return;
+    }
+    if (m_format == StatusFormat::JSON)
+    {
+        if (!std::isfinite(v))
+        {
+            // json has no inf or nan:
+            put("null", 4);
+            return;
+        }
+        char buf[32];
+        const auto r = std::format_to_n(buf, sizeof(buf), "{}", v);
+        put(buf, (size_t) r.size);
+    }
+    else
+    {
+        put_raw(v);
+    }
+}
+
+
+void StatusWriter::put_int(std::string_view key, int64_t v)
+{
+    if (!element(key, TAG_INT))
+    {
+        return;
+    }
+    if (m_format == StatusFormat::JSON)
+    {
+        char buf[24];
+        const auto r = std::format_to_n(buf, sizeof(buf), "{}", v);
+        put(buf, (size_t) r.size);
+    }
+    else
+    {
+        put_raw(v);
+    }
+}
+
+
+void StatusWriter::put_uint(std::string_view key, uint64_t v)
+{
+    if (!element(key, TAG_UINT))
+    {
+        return;
+    }
+    if (m_format == StatusFormat::JSON)
+    {
+        char buf[24];
+        const auto r = std::format_to_n(buf, sizeof(buf), "{}", v);
+        put(buf, (size_t) r.size);
+    }
+    else
+    {
+        put_raw(v);
+    }
+}
+
+
+void StatusWriter::raw_json(std::string_view json)
+{
+    if (!element({}, TAG_RAW_JSON))
+    {
+        return;
+    }
+    if (m_format == StatusFormat::JSON)
+    {
+        put(json.data(), json.size());
+    }
+    else
+    {
+        put_raw((uint32_t) json.size());
+        put(json.data(), json.size());
+    }
+}
+
+
+namespace
+{
+    class BinaryDecoder
+    {
+    public:
+        explicit BinaryDecoder(std::span<const char> data)
+            : m_data(data)
+        {
+        }
+
+        template <typename T> bool get(T& v)
+        {
+            return get_bytes(&v, sizeof(v));
+        }
+
+        bool get_bytes(void* out, size_t n)
+        {
+            if (m_pos + n > m_data.size())
+            {
+                return false;
+            }
+            memcpy(out, m_data.data() + m_pos, n);
+            m_pos += n;
+            return true;
+        }
+
+        bool get_string(size_t n, std::string_view& out)
+        {
+            if (m_pos + n > m_data.size())
+            {
+                return false;
+            }
+            out = std::string_view(m_data.data() + m_pos, n);
+            m_pos += n;
+            return true;
+        }
+
+        bool at_end() const
+        {
+            return m_pos == m_data.size();
+        }
+
+    private:
+        std::span<const char> m_data;
+        size_t m_pos = 0;
+    };
+} // namespace
+
+
+bool status_to_json(std::span<const char> binary, std::string& json)
+{
+    BinaryDecoder in(binary);
+    char magic[sizeof(BINARY_MAGIC)];
+    uint8_t version = 0;
+    if (!in.get_bytes(magic, sizeof(magic)) ||
+        memcmp(magic, BINARY_MAGIC, sizeof(magic)) != 0 || !in.get(version) ||
+        version != StatusWriter::BINARY_VERSION)
+    {
+        return false;
+    }
+
+    bool ok = true;
+    json = write_status_to_string([&](StatusWriter& w) {
+        BinaryDecoder d = in;
+        bool in_object[StatusWriter::MAX_DEPTH] = {};
+        size_t depth = 0;
+        ok = true;
+        uint8_t tag = 0;
+        while (ok && d.get(tag))
+        {
+            std::string_view key;
+            if (in_object[depth] && tag != StatusWriter::TAG_OBJECT_END &&
+                tag != StatusWriter::TAG_ARRAY_END)
+            {
+                uint8_t len = 0;
+                ok = d.get(len) && d.get_string(len, key);
+                if (!ok)
+                {
+                    break;
+                }
+            }
+
+            switch (tag)
+            {
+            case StatusWriter::TAG_OBJECT_BEGIN:
+            case StatusWriter::TAG_ARRAY_BEGIN:
+            {
+                const bool object = tag == StatusWriter::TAG_OBJECT_BEGIN;
+                if (depth + 1 >= StatusWriter::MAX_DEPTH)
+                {
+                    ok = false;
+                    break;
+                }
+                if (in_object[depth])
+                {
+                    object ? w.begin_object(key) : w.begin_array(key);
+                }
+                else
+                {
+                    object ? w.begin_object() : w.begin_array();
+                }
+                in_object[++depth] = object;
+                break;
+            }
+            case StatusWriter::TAG_OBJECT_END:
+            case StatusWriter::TAG_ARRAY_END:
+                if (depth == 0 ||
+                    in_object[depth] != (tag == StatusWriter::TAG_OBJECT_END))
+                {
+                    ok = false;
+                    break;
+                }
+                in_object[depth] ? w.end_object() : w.end_array();
+                depth--;
+                break;
+            case StatusWriter::TAG_INT:
+            {
+                int64_t v = 0;
+                ok = d.get(v);
+                w.value(key, v);
+                break;
+            }
+            case StatusWriter::TAG_UINT:
+            {
+                uint64_t v = 0;
+                ok = d.get(v);
+                w.value(key, v);
+                break;
+            }
+            case StatusWriter::TAG_DOUBLE:
+            {
+                double v = 0;
+                ok = d.get(v);
+                w.value(key, v);
+                break;
+            }
+            case StatusWriter::TAG_BOOL:
+            {
+                uint8_t v = 0;
+                ok = d.get(v);
+                w.value(key, v != 0);
+                break;
+            }
+            case StatusWriter::TAG_STRING:
+            {
+                uint16_t len = 0;
+                std::string_view v;
+                ok = d.get(len) && d.get_string(len, v);
+                w.value(key, v);
+                break;
+            }
+            case StatusWriter::TAG_RAW_JSON:
+            {
+                uint32_t len = 0;
+                std::string_view v;
+                ok = d.get(len) && d.get_string(len, v);
+                w.raw_json(v);
+                break;
+            }
+            default:
+                ok = false;
+                break;
+            }
+        }
+        ok = ok && depth == 0 && d.at_end();
+    });
+    return ok;
+}
+
+} // namespace service
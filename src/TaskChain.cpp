@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <cstdint>
+#include <format>
+
+#include <urtsched/RealtimeKernel.hpp>
+#include <urtsched/StatusWriter.hpp>
+#include <urtsched/TaskChain.hpp>
+
+
+namespace realtime
+{
+
+TaskChain::TaskChain(const std::string& name,
+    std::chrono::microseconds period, std::chrono::microseconds deadline)
+    : m_name(name)
+    , m_period(period)
+    , m_deadline(deadline.count() > 0 ? deadline : period)
+{
+}
+
+
+std::shared_ptr<PeriodicTask> TaskChain::add_source(RealtimeKernel& kernel,
+    TaskType tt, const std::string& name, const task_func_t& callback,
+    std::chrono::nanoseconds wcet)
+{
+    if (!m_stages.empty())
+    {
+        return nullptr;
+    }
+    return add(kernel, tt, name, callback, {}, wcet);
+}
+
+
+std::shared_ptr<PeriodicTask> TaskChain::add_stage(RealtimeKernel& kernel,
+    TaskType tt, const std::string& name, const task_func_t& callback,
+    const std::vector<std::shared_ptr<PeriodicTask>>& after,
+    std::chrono::nanoseconds wcet)
+{
+    if (after.empty())
+    {
+        return nullptr;
+    }
+    std::vector<size_t> ixs;
+    for (const auto& t : after)
+    {
+        const auto it = std::find_if(m_stages.begin(), m_stages.end(),
+            [&t](const auto& s) { return t && s->task == t; });
+        if (it == m_stages.end())
+        {
+            return nullptr;
+        }
+        ixs.push_back(it - m_stages.begin());
+    }
+    return add(kernel, tt, name, callback, std::move(ixs), wcet);
+}
+
+
+std::shared_ptr<PeriodicTask> TaskChain::add(RealtimeKernel& kernel,
+    TaskType tt, const std::string& name, const task_func_t& callback,
+    std::vector<size_t> after, std::chrono::nanoseconds wcet)
+{
+    if (m_stages.size() == MAX_STAGES)
+    {
+        return nullptr;
+    }
+    bool remote = false;
+    for (const auto ix : after)
+    {
+        remote = remote || m_stages[ix]->kernel != &kernel;
+    }
+    if (!kernel.add_chain(shared_from_this(), remote))
+    {
+        return nullptr;
+    }
+
+    auto stage = std::make_unique<Stage>();
+    stage->kernel = &kernel;
+    stage->after = std::move(after);
+    stage->wcet = wcet;
+    stage->task = kernel.add_periodic(tt, name, m_period, callback);
+    if (!stage->task)
+    {
+        return nullptr;
+    }
+    stage->task->set_release_gated(!stage->after.empty());
+    stage->task->set_completion_hook(
+        [this, s = stage.get()](BaseTask& t, std::chrono::nanoseconds end) {
+            stage_completed(*s, t, end);
+        });
+    for (const auto ix : stage->after)
+    {
+        m_stages[ix]->is_last = false;
+    }
+    m_stages.push_back(std::move(stage));
+    return m_stages.back()->task;
+}
+
+
+void TaskChain::stage_completed(
+    Stage& stage, const BaseTask& task, std::chrono::nanoseconds completed_at)
+{
+    if (stage.after.empty())
+    {
+        // the source is released by its period, so it counts them:
+        stage.released_period++;
+        m_release_ns[stage.released_period % RELEASE_HISTORY].store(
+            task.get_last_release().count(), std::memory_order_relaxed);
+    }
+    if (stage.is_last)
+    {
+        const auto released =
+            m_release_ns[stage.released_period % RELEASE_HISTORY].load(
+                std::memory_order_relaxed);
+        record_latency(completed_at - std::chrono::nanoseconds(released));
+    }
+    // publishes the release time above to the successors too:
+    stage.completed_period.store(
+        stage.released_period, std::memory_order_release);
+}
+
+
+bool TaskChain::release_ready_stages(const RealtimeKernel& kernel)
+{
+    bool released = false;
+    for (auto& s : m_stages)
+    {
+        // stages that are released already wait for their run:
+        if (s->kernel != &kernel || !s->task->is_held())
+        {
+            continue;
+        }
+        const auto next = s->released_period + 1;
+        const bool ready = std::all_of(
+            s->after.begin(), s->after.end(), [this, next](size_t ix) {
+                return m_stages[ix]->completed_period.load(
+                           std::memory_order_acquire) >= next;
+            });
+        if (ready)
+        {
+            s->released_period = next;
+            s->task->open_gate();
+            released = true;
+        }
+    }
+    return released;
+}
+
+
+void TaskChain::record_latency(std::chrono::nanoseconds latency)
+{
+    const auto ns = latency.count();
+    m_latency_last_ns.store(ns, std::memory_order_relaxed);
+    m_latency_total_ns.fetch_add(ns, std::memory_order_relaxed);
+    auto max = m_latency_max_ns.load(std::memory_order_relaxed);
+    while (ns > max &&
+        !m_latency_max_ns.compare_exchange_weak(
+            max, ns, std::memory_order_relaxed))
+    {
+    }
+    if (latency > m_deadline)
+    {
+        m_latency_misses.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_latency_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+ChainLatency TaskChain::get_latency() const
+{
+    ChainLatency l;
+    l.count = m_latency_count.load(std::memory_order_relaxed);
+    l.deadline_misses = m_latency_misses.load(std::memory_order_relaxed);
+    l.last = std::chrono::nanoseconds(
+        m_latency_last_ns.load(std::memory_order_relaxed));
+    l.max = std::chrono::nanoseconds(
+        m_latency_max_ns.load(std::memory_order_relaxed));
+    l.total = std::chrono::nanoseconds(
+        m_latency_total_ns.load(std::memory_order_relaxed));
+    return l;
+}
+
+
+ChainAnalysis TaskChain::analyze() const
+{
+    ChainAnalysis a;
+    if (m_stages.empty())
+    {
+        a.problems.push_back(m_name + ": no stages");
+        return a;
+    }
+
+    const auto wcet_of = [&a](const Stage& s) {
+        if (s.wcet.count() > 0)
+        {
+            return s.wcet;
+        }
+        const auto measured = std::max(
+            s.task->max_time_taken_ns(), s.task->warmup_max_time_taken_ns());
+        if (measured.count() == 0)
+        {
+            a.warnings.push_back(
+                s.task->get_name() + ": execution time unknown, it never ran");
+        }
+        return measured;
+    };
+
+    // the kernels don't preempt, so a released stage may first have to
+    // wait for whatever else of its kernel started before it, a release
+    // group as a whole:
+    const auto blocking_of = [](const Stage& s) {
+        auto longest = std::chrono::nanoseconds(0);
+        const auto add = [&](const BaseTask* t) {
+            if (t && t != s.task.get())
+            {
+                longest = std::max(longest, t->max_time_taken_ns());
+            }
+        };
+        for (const auto& t : s.kernel->m_periodic_list)
+        {
+            add(t.get());
+        }
+        for (const auto& t : s.kernel->m_idle_list)
+        {
+            add(t.get());
+        }
+        for (const auto& t : s.kernel->m_server_list)
+        {
+            add(t.get());
+        }
+        return longest;
+    };
+
+    // stages come after their predecessors, so one pass finds the
+    // longest path to each of them:
+    std::vector<std::chrono::nanoseconds> wcet(m_stages.size());
+    std::vector<std::chrono::nanoseconds> finish(m_stages.size());
+    std::vector<size_t> via(m_stages.size(), SIZE_MAX);
+    for (size_t i = 0; i < m_stages.size(); i++)
+    {
+        const auto& s = *m_stages[i];
+        wcet[i] = wcet_of(s);
+        auto start = std::chrono::nanoseconds(0);
+        for (const auto p : s.after)
+        {
+            if (finish[p] >= start)
+            {
+                start = finish[p];
+                via[i] = p;
+            }
+        }
+        finish[i] = start + blocking_of(s) + wcet[i];
+        if (wcet[i] > m_period)
+        {
+            a.problems.push_back(std::format(
+                "{}: worst-case execution time {} exceeds the period {}",
+                s.task->get_name(), wcet[i], m_period));
+        }
+    }
+
+    size_t last = 0;
+    for (size_t i = 0; i < m_stages.size(); i++)
+    {
+        if (m_stages[i]->is_last && finish[i] > finish[last])
+        {
+            last = i;
+        }
+    }
+    a.worst_case_latency = finish[last];
+    for (auto i = last; i != SIZE_MAX; i = via[i])
+    {
+        a.critical_path.insert(
+            a.critical_path.begin(), m_stages[i]->task->get_name());
+    }
+    if (a.worst_case_latency > m_deadline)
+    {
+        a.problems.push_back(std::format(
+            "{}: worst-case end-to-end latency {} exceeds the deadline {}",
+            m_name, a.worst_case_latency, m_deadline));
+    }
+
+    // every period, each kernel has to fit all of its stages:
+    for (size_t i = 0; i < m_stages.size(); i++)
+    {
+        const auto* kernel = m_stages[i]->kernel;
+        auto load = std::chrono::nanoseconds(0);
+        bool first = true;
+        for (size_t j = 0; j < m_stages.size(); j++)
+        {
+            if (m_stages[j]->kernel == kernel)
+            {
+                first = first && j >= i;
+                load += wcet[j];
+            }
+        }
+        if (first && load > m_period)
+        {
+            a.problems.push_back(std::format(
+                "{}: the stages on {} take {}, more than the period {}",
+                m_name, kernel->get_name(), load, m_period));
+        }
+    }
+    return a;
+}
+
+
+std::string TaskChain::get_service_status_as_json() const
+{
+    return service::write_status_to_string(
+        [this](service::StatusWriter& w) { write_status(w); });
+}
+
+
+void TaskChain::write_status(service::StatusWriter& w) const
+{
+    const auto latency = get_latency();
+    w.begin_object();
+    w.value("chain", m_name);
+    w.seconds("period", m_period);
+    w.seconds("deadline", m_deadline);
+    w.begin_object("latency");
+    w.value("count", latency.count);
+    w.seconds("last", latency.last);
+    w.seconds("max", latency.max);
+    w.seconds("avg", latency.average());
+    w.value("deadline_misses", latency.deadline_misses);
+    w.end_object();
+    w.begin_array("stages");
+    for (const auto& s : m_stages)
+    {
+        w.begin_object();
+        w.value("name", s->task->get_name());
+        w.value("kernel", s->kernel->get_name());
+        w.value("completed",
+            s->completed_period.load(std::memory_order_relaxed));
+        w.end_object();
+    }
+    w.end_array();
+    w.end_object();
+}
+
+
+bool RealtimeKernel::add_chain(
+    const std::shared_ptr<TaskChain>& chain, bool remote)
+{
+    if (std::find(m_chains.begin(), m_chains.end(), chain) == m_chains.end())
+    {
+        if (m_chains.size() == m_chains.capacity())
+        {
+            return false;
+        }
+        m_chains.push_back(chain);
+    }
+    m_has_remote_chain_stages = m_has_remote_chain_stages || remote;
+    return true;
+}
+
+
+bool RealtimeKernel::release_chain_stages()
+{
+    bool released = false;
+    for (const auto& c : m_chains)
+    {
+        released = c->release_ready_stages(*this) || released;
+    }
+    return released;
+}
+
+} // namespace realtime
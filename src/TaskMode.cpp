@@ -0,0 +1,191 @@
+#include <atomic>
+#include <numeric>
+#include <thread>
+
+#include <urtsched/RealtimeKernel.hpp>
+
+#include <slogger/ILogger.hpp>
+
+using namespace std::chrono_literals;
+
+
+namespace realtime
+{
+
+bool RealtimeKernel::define_mode(
+    const std::string& name, const std::vector<ModeTask>& tasks)
+{
+    TaskMode mode{ name, tasks, 0us };
+    for (const auto& mt : tasks)
+    {
+        assert(mt.task != nullptr);
+        const auto period =
+            mt.period.count() > 0 ? mt.period : mt.task->get_period();
+        if (period.count() <= 0)
+        {
+            // idle tasks do not contribute to the hyperperiod
+            continue;
+        }
+        mode.hyperperiod = mode.hyperperiod.count() == 0
+            ? period
+            : std::chrono::microseconds(
+                  std::lcm(mode.hyperperiod.count(), period.count()));
+    }
+
+    for (auto& m : m_modes)
+    {
+        if (m.name == name)
+        {
+            m = mode;
+            return true;
+        }
+    }
+    if (m_modes.size() == m_modes.capacity())
+    {
+        return false;
+    }
+    m_modes.push_back(mode);
+    return true;
+}
+
+
+bool RealtimeKernel::request_mode_change(
+    const std::string& name, ModeChangeBoundary boundary)
+{
+    for (size_t i = 0; i < m_modes.size(); i++)
+    {
+        if (m_modes[i].name != name)
+        {
+            continue;
+        }
+
+        // a seqlock: an odd sequence number marks a request being written,
+        // which also keeps other requesters out until it's published
+        auto request = m_mode_request.load(std::memory_order_relaxed);
+        uint64_t seq = 0;
+        for (;;)
+        {
+            if ((request >> 16) & 1)
+            {
+                std::this_thread::yield();
+                request = m_mode_request.load(std::memory_order_relaxed);
+                continue;
+            }
+            seq = (request >> 16) + 1;
+            if (m_mode_request.compare_exchange_weak(request,
+                    (seq << 16) | (request & 0xffff),
+                    std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        m_mode_requested_at_ns.store(
+            m_timer.get_time_ns().count(), std::memory_order_relaxed);
+        m_mode_request.store(
+            ((seq + 1) << 16) | ((uint64_t) boundary << 8) | (uint64_t) i,
+            std::memory_order_release);
+        return true;
+    }
+    return false;
+}
+
+
+const std::string& RealtimeKernel::get_current_mode() const
+{
+    static const std::string no_mode;
+    if (m_current_mode == NO_MODE)
+    {
+        return no_mode;
+    }
+    return m_modes[m_current_mode].name;
+}
+
+
+void RealtimeKernel::check_mode_change()
+{
+    const auto request = m_mode_request.load(std::memory_order_acquire);
+    // an odd sequence number is a request still being written:
+    if (request != m_mode_request_seen && ((request >> 16) & 1) == 0)
+    {
+        const auto requested_at =
+            m_mode_requested_at_ns.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // otherwise a newer one came in meanwhile, taken at the next step:
+        if (m_mode_request.load(std::memory_order_relaxed) == request)
+        {
+            m_mode_request_seen = request;
+            m_pending_mode = (int) (request & 0xff);
+            m_pending_boundary = (ModeChangeBoundary) ((request >> 8) & 0xff);
+            m_pending_requested_at = std::chrono::nanoseconds(requested_at);
+        }
+    }
+
+    if (m_pending_mode == NO_MODE)
+    {
+        return;
+    }
+
+    if (m_pending_boundary == ModeChangeBoundary::HYPERPERIOD &&
+        m_current_mode != NO_MODE)
+    {
+        const std::chrono::nanoseconds hyperperiod =
+            m_modes[m_current_mode].hyperperiod;
+        if (hyperperiod.count() > 0)
+        {
+            // the first hyperperiod boundary after the request:
+            const auto since_start = m_pending_requested_at - m_mode_started_at;
+            const auto boundary =
+                m_mode_started_at + (since_start / hyperperiod + 1) * hyperperiod;
+            if (m_timer.get_time_ns() < boundary)
+            {
+                return;
+            }
+        }
+    }
+
+    apply_mode(m_pending_mode);
+}
+
+
+void RealtimeKernel::apply_mode(int mode)
+{
+    const auto now = m_timer.get_time_ns();
+
+    for (auto& m : m_modes)
+    {
+        for (auto& mt : m.tasks)
+        {
+            mt.task->disable();
+        }
+    }
+
+    // all tasks of the new mode are released together so the mode starts
+    // at the beginning of its hyperperiod:
+    for (auto& mt : m_modes[mode].tasks)
+    {
+        if (mt.period.count() > 0)
+        {
+            mt.task->set_period(mt.period);
+        }
+        mt.task->enable();
+        mt.task->release_now();
+    }
+
+    m_last_mode_change_latency = now - m_pending_requested_at;
+    if (m_last_mode_change_latency > m_max_mode_change_latency)
+    {
+        m_max_mode_change_latency = m_last_mode_change_latency;
+    }
+
+    LOG_INFO(get_logger(), "{} - mode change: '{}' -> '{}', latency = {}",
+        m_name, get_current_mode(), m_modes[mode].name,
+        m_last_mode_change_latency);
+
+    m_current_mode = mode;
+    m_pending_mode = NO_MODE;
+    m_mode_started_at = now;
+    m_num_mode_changes++;
+}
+
+} // namespace realtime
@@ -0,0 +1,398 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <urtsched/RealtimeKernel.hpp>
+#include <urtsched/TaskProfile.hpp>
+
+
+namespace realtime
+{
+
+static constexpr char MAGIC[8] = { 'U', 'R', 'T', 'P', 'R', 'F', 0, 0 };
+
+
+void BaseTask::seed_profile(const TaskProfile& profile)
+{
+    auto seed = std::make_shared<TaskProfile>(profile);
+    if (seed->num_calls > MAX_SEEDED_CALLS)
+    {
+        const double scale =
+            (double) MAX_SEEDED_CALLS / (double) seed->num_calls;
+        seed->num_calls = MAX_SEEDED_CALLS;
+        seed->total_time_taken = std::chrono::microseconds(
+            (int64_t) ((double) seed->total_time_taken.count() * scale));
+        for (auto& n : seed->exec_histogram)
+        {
+            n = (uint64_t) ((double) n * scale);
+        }
+    }
+
+    m_seeded_max_time_taken = seed->max_time_taken;
+    m_seeded_warmup_max_time_taken = seed->warmup_max_time_taken;
+    m_seeded_calls = seed->num_calls;
+    m_seeded_time_taken = seed->total_time_taken;
+    m_seed = std::move(seed);
+}
+
+
+void BaseTask::get_profile(TaskProfile& out) const
+{
+    out.name = m_name;
+    out.period = m_interval;
+    out.num_calls = m_num_calls + m_seeded_calls;
+    out.max_time_taken = max_time_taken_ns();
+    out.warmup_max_time_taken = warmup_max_time_taken_ns();
+    out.total_time_taken = m_total_time_taken_us + m_seeded_time_taken;
+    out.exec_histogram = m_exec_histogram;
+    if (m_seed)
+    {
+        for (size_t i = 0; i < EXEC_HISTOGRAM_BUCKETS; i++)
+        {
+            out.exec_histogram[i] += m_seed->exec_histogram[i];
+        }
+    }
+}
+
+
+void RealtimeKernel::set_profile_store(
+    const std::shared_ptr<TaskProfileStore>& store,
+    std::chrono::milliseconds interval)
+{
+    m_profile_store = store;
+    m_profile_interval = interval;
+    m_next_profile_capture = std::chrono::nanoseconds(0);
+    if (m_profile_store)
+    {
+        for_each_task([this](BaseTask& t) { m_profile_store->seed(t); });
+    }
+}
+
+
+/** FNV-1a */
+static uint64_t hash_of(const std::string& data)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (const char c : data)
+    {
+        h ^= (uint8_t) c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+
+template <typename T> static void put(std::string& out, const T& value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+
+static void put_string(std::string& out, const std::string& s)
+{
+    const auto len = (uint16_t) std::min<size_t>(s.size(), UINT16_MAX);
+    put(out, len);
+    out.append(s.data(), len);
+}
+
+
+namespace
+{
+    /** reads what put() wrote, all reads fail once one did */
+    class Reader
+    {
+    public:
+        explicit Reader(const std::string& data)
+            : m_data(data)
+        {
+        }
+
+        template <typename T> bool get(T& value)
+        {
+            if (!m_ok || m_pos + sizeof(value) > m_data.size())
+            {
+                m_ok = false;
+                return false;
+            }
+            memcpy(&value, m_data.data() + m_pos, sizeof(value));
+            m_pos += sizeof(value);
+            return true;
+        }
+
+        bool get_string(std::string& s)
+        {
+            uint16_t len = 0;
+            if (!get(len) || m_pos + len > m_data.size())
+            {
+                m_ok = false;
+                return false;
+            }
+            s.assign(m_data.data() + m_pos, len);
+            m_pos += len;
+            return true;
+        }
+
+        bool ok() const
+        {
+            return m_ok;
+        }
+
+        size_t pos() const
+        {
+            return m_pos;
+        }
+
+    private:
+        const std::string& m_data;
+        size_t m_pos = 0;
+        bool m_ok = true;
+    };
+} // namespace
+
+
+bool TaskProfileStore::load(const std::filesystem::path& path)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr)
+    {
+        return false;
+    }
+    std::string data;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    {
+        data.append(buf, n);
+    }
+    fclose(f);
+
+    if (data.size() < sizeof(MAGIC) + sizeof(uint64_t) ||
+        memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+    {
+        return false;
+    }
+    uint64_t stored_hash = 0;
+    memcpy(&stored_hash, data.data() + data.size() - sizeof(stored_hash),
+        sizeof(stored_hash));
+    data.resize(data.size() - sizeof(stored_hash));
+    if (hash_of(data) != stored_hash)
+    {
+        return false;
+    }
+
+    Reader in(data);
+    char magic[sizeof(MAGIC)];
+    uint32_t version = 0;
+    std::string kernel_name;
+    uint32_t num_buckets = 0;
+    uint32_t count = 0;
+    in.get(magic);
+    if (!in.get(version) || version != VERSION || !in.get_string(kernel_name) ||
+        kernel_name != m_kernel_name || !in.get(num_buckets) ||
+        num_buckets != BaseTask::EXEC_HISTOGRAM_BUCKETS || !in.get(count))
+    {
+        return false;
+    }
+
+    std::vector<TaskProfile> profiles(count);
+    for (auto& p : profiles)
+    {
+        int64_t period_us = 0;
+        int64_t max_ns = 0;
+        int64_t warmup_max_ns = 0;
+        int64_t total_us = 0;
+        in.get_string(p.name);
+        in.get(period_us);
+        in.get(p.num_calls);
+        in.get(max_ns);
+        in.get(warmup_max_ns);
+        in.get(total_us);
+        for (auto& b : p.exec_histogram)
+        {
+            in.get(b);
+        }
+        if (!in.ok() || period_us < 0 || max_ns < 0 || warmup_max_ns < 0 ||
+            total_us < 0)
+        {
+            return false;
+        }
+        p.period = std::chrono::microseconds(period_us);
+        p.max_time_taken = std::chrono::nanoseconds(max_ns);
+        p.warmup_max_time_taken = std::chrono::nanoseconds(warmup_max_ns);
+        p.total_time_taken = std::chrono::microseconds(total_us);
+    }
+    if (in.pos() != data.size())
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_profiles = std::move(profiles);
+    return true;
+}
+
+
+bool TaskProfileStore::save(const std::filesystem::path& path) const
+{
+    std::string data;
+    data.append(MAGIC, sizeof(MAGIC));
+    put(data, VERSION);
+    put_string(data, m_kernel_name);
+    put(data, (uint32_t) BaseTask::EXEC_HISTOGRAM_BUCKETS);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        put(data, (uint32_t) m_profiles.size());
+        for (const auto& p : m_profiles)
+        {
+            put_string(data, p.name);
+            put(data, (int64_t) p.period.count());
+            put(data, p.num_calls);
+            put(data, (int64_t) p.max_time_taken.count());
+            put(data, (int64_t) p.warmup_max_time_taken.count());
+            put(data, (int64_t) p.total_time_taken.count());
+            for (const auto b : p.exec_histogram)
+            {
+                put(data, b);
+            }
+        }
+    }
+    put(data, hash_of(data));
+
+    auto tmp = path;
+    tmp += ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (f == nullptr)
+    {
+        return false;
+    }
+    const bool written = fwrite(data.data(), 1, data.size(), f) == data.size();
+    if (fclose(f) != 0 || !written)
+    {
+        std::filesystem::remove(tmp);
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    return !ec;
+}
+
+
+void TaskProfileStore::start(
+    const std::filesystem::path& path, std::chrono::milliseconds interval)
+{
+    assert(!m_thread.joinable());
+    m_stop = false;
+    m_thread = std::thread([this, path, interval]() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stop)
+        {
+            if (m_cond.wait_for(lock, interval, [this] { return m_stop; }))
+            {
+                break;
+            }
+            lock.unlock();
+            save(path);
+            lock.lock();
+        }
+    });
+}
+
+
+void TaskProfileStore::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+
+bool TaskProfileStore::capture(const RealtimeKernel& kernel, bool wait)
+{
+    std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+    if (wait)
+    {
+        lock.lock();
+    }
+    else if (!lock.try_lock())
+    {
+        return false;
+    }
+    kernel.for_each_task(
+        [this, wait](const BaseTask& t) { capture_locked(t, wait); });
+    return true;
+}
+
+
+void TaskProfileStore::capture_locked(const BaseTask& task, bool allocate)
+{
+    for (auto& p : m_profiles)
+    {
+        if (p.name == task.get_name())
+        {
+            // same name, so no allocation:
+            task.get_profile(p);
+            return;
+        }
+    }
+    if (allocate)
+    {
+        m_profiles.emplace_back();
+        task.get_profile(m_profiles.back());
+    }
+}
+
+
+bool TaskProfileStore::seed(BaseTask& task)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto* p = find_locked(task.get_name());
+    if (p == nullptr)
+    {
+        m_profiles.emplace_back();
+        task.get_profile(m_profiles.back());
+        return false;
+    }
+    task.seed_profile(*p);
+    return true;
+}
+
+
+size_t TaskProfileStore::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_profiles.size();
+}
+
+
+bool TaskProfileStore::find(const std::string& name, TaskProfile& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto* p = find_locked(name);
+    if (p == nullptr)
+    {
+        return false;
+    }
+    out = *p;
+    return true;
+}
+
+
+const TaskProfile* TaskProfileStore::find_locked(const std::string& name) const
+{
+    for (const auto& p : m_profiles)
+    {
+        if (p.name == name)
+        {
+            return &p;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace realtime
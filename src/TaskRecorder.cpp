@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <cstring>
+
+#include <urtsched/BaseTask.hpp>
+#include <urtsched/TaskRecorder.hpp>
+
+
+namespace realtime
+{
+
+static constexpr char MAGIC[8] = { 'U', 'R', 'T', 'R', 'E', 'C', 0, 0 };
+
+
+template <typename T> static void put(FILE* f, const T& value)
+{
+    fwrite(&value, sizeof(value), 1, f);
+}
+
+
+static void put_string(FILE* f, const std::string& s)
+{
+    const auto len = (uint16_t) std::min<size_t>(s.size(), UINT16_MAX);
+    put(f, len);
+    fwrite(s.data(), 1, len, f);
+}
+
+
+template <typename T> static bool get(FILE* f, T& value)
+{
+    return fread(&value, sizeof(value), 1, f) == 1;
+}
+
+
+static bool get_string(FILE* f, std::string& s)
+{
+    uint16_t len = 0;
+    if (!get(f, len))
+    {
+        return false;
+    }
+    s.resize(len);
+    return fread(s.data(), 1, len, f) == len;
+}
+
+
+const RecordedTask* Recording::find_task(uint32_t id) const
+{
+    for (const auto& t : tasks)
+    {
+        if (t.id == id)
+        {
+            return &t;
+        }
+    }
+    return nullptr;
+}
+
+
+std::vector<std::chrono::nanoseconds> Recording::durations_of(uint32_t id) const
+{
+    std::vector<std::chrono::nanoseconds> ret;
+    for (const auto& r : records)
+    {
+        if (r.task_id == id)
+        {
+            ret.emplace_back(r.duration_ns);
+        }
+    }
+    return ret;
+}
+
+
+std::chrono::nanoseconds Recording::span() const
+{
+    if (records.empty())
+    {
+        return std::chrono::nanoseconds(0);
+    }
+    int64_t first = records.front().release_ns;
+    int64_t last = first;
+    for (const auto& r : records)
+    {
+        first = std::min(first, r.release_ns);
+        last = std::max(last, r.start_ns + r.duration_ns);
+    }
+    return std::chrono::nanoseconds(last - first);
+}
+
+
+bool TaskRecorder::open(const std::filesystem::path& path)
+{
+    close();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file = fopen(path.c_str(), "wb");
+    if (m_file == nullptr)
+    {
+        return false;
+    }
+    fwrite(MAGIC, 1, sizeof(MAGIC), m_file);
+    put(m_file, VERSION);
+    put_string(m_file, m_kernel_name);
+    m_tasks_written = 0;
+    return true;
+}
+
+
+void TaskRecorder::close()
+{
+    stop();
+    drain();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file)
+    {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+
+void TaskRecorder::start(std::chrono::milliseconds interval)
+{
+    assert(!m_thread.joinable());
+    m_stop = false;
+    m_thread = std::thread([this, interval]() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stop)
+        {
+            if (m_cond.wait_for(lock, interval, [this] { return m_stop; }))
+            {
+                break;
+            }
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
+    });
+}
+
+
+void TaskRecorder::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+
+void TaskRecorder::register_task(const BaseTask& task, RecordedTaskKind kind)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& t : m_tasks)
+    {
+        if (t.id == task.get_id())
+        {
+            return;
+        }
+    }
+    m_tasks.push_back(RecordedTask{ task.get_id(), kind, task.get_task_type(),
+        task.get_period(), task.get_name() });
+}
+
+
+void TaskRecorder::write_new_tasks()
+{
+    for (; m_tasks_written < m_tasks.size(); m_tasks_written++)
+    {
+        const auto& t = m_tasks[m_tasks_written];
+        put(m_file, (uint8_t) TAG_TASK);
+        put(m_file, t.id);
+        put(m_file, (uint8_t) t.kind);
+        put(m_file, (uint8_t) t.type);
+        put(m_file, (int64_t) t.period.count());
+        put_string(m_file, t.name);
+    }
+}
+
+
+size_t TaskRecorder::drain()
+{
+    std::lock_guard<std::mutex> drain_lock(m_drain_mutex);
+    // tasks are registered before they run, so popping the records before
+    // writing the task table keeps each task ahead of its records:
+    m_batch.clear();
+    TaskRecord r;
+    while (m_ring.try_pop(r))
+    {
+        m_batch.push_back(r);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file == nullptr)
+    {
+        return 0;
+    }
+    write_new_tasks();
+    if (!m_batch.empty())
+    {
+        put(m_file, (uint8_t) TAG_RECORDS);
+        put(m_file, (uint32_t) m_batch.size());
+        fwrite(m_batch.data(), sizeof(TaskRecord), m_batch.size(), m_file);
+        m_num_written += m_batch.size();
+    }
+    fflush(m_file);
+    return m_batch.size();
+}
+
+
+std::optional<Recording> TaskRecorder::load(const std::filesystem::path& path)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    // to check record counts against before allocating for them:
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0)
+    {
+        size = ftell(f);
+    }
+    if (size < 0 || fseek(f, 0, SEEK_SET) != 0)
+    {
+        fclose(f);
+        return std::nullopt;
+    }
+
+    Recording ret;
+    char magic[sizeof(MAGIC)];
+    uint32_t version = 0;
+    if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) ||
+        memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !get(f, version) ||
+        version != VERSION || !get_string(f, ret.kernel_name))
+    {
+        fclose(f);
+        return std::nullopt;
+    }
+
+    uint8_t tag = 0;
+    bool ok = true;
+    while (ok && get(f, tag))
+    {
+        switch (tag)
+        {
+        case TAG_TASK:
+        {
+            RecordedTask t;
+            uint8_t kind = 0;
+            uint8_t type = 0;
+            int64_t period = 0;
+            ok = get(f, t.id) && get(f, kind) && get(f, type) &&
+                get(f, period) && get_string(f, t.name);
+            if (ok)
+            {
+                t.kind = (RecordedTaskKind) kind;
+                t.type = (TaskType) type;
+                t.period = std::chrono::nanoseconds(period);
+                ret.tasks.push_back(t);
+            }
+            break;
+        }
+        case TAG_RECORDS:
+        {
+            uint32_t count = 0;
+            ok = get(f, count);
+            const auto left = size - ftell(f);
+            if (ok && (uint64_t) count * sizeof(TaskRecord) > (uint64_t) left)
+            {
+                // a corrupted count, don't let it size the allocation:
+                fclose(f);
+                return std::nullopt;
+            }
+            if (ok)
+            {
+                const auto start = ret.records.size();
+                ret.records.resize(start + count);
+                const auto read = fread(
+                    ret.records.data() + start, sizeof(TaskRecord), count, f);
+                ret.records.resize(start + read);
+                ok = read == count;
+            }
+            break;
+        }
+        default:
+            ok = false;
+            break;
+        }
+    }
+    fclose(f);
+
+    // a file truncated after a batch (e.g. after a crash) gives what
+    // could be read
+    return ret;
+}
+
+} // namespace realtime
@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+#include <urtsched/RealtimeKernel.hpp>
+#include <urtsched/TimingWheel.hpp>
+
+
+namespace realtime
+{
+
+TimingWheel::TimingWheel(
+    const TimerConfig& config, std::chrono::nanoseconds now)
+    : m_tick(std::max(config.tick, std::chrono::nanoseconds(1)))
+    , m_nodes(std::min<size_t>(config.capacity, NIL))
+{
+    for (size_t i = m_nodes.size(); i-- > 0;)
+    {
+        m_nodes[i].next = m_free;
+        m_free = (uint32_t) i;
+    }
+    m_current = now.count() > 0 ? (uint64_t) (now / m_tick) : 0;
+}
+
+
+TimerHandle TimingWheel::schedule_at(
+    std::chrono::nanoseconds time, timer_func_t fn)
+{
+    if (m_free == NIL)
+    {
+        m_stats.full++;
+        return TimerHandle();
+    }
+    const auto ix = m_free;
+    auto& n = m_nodes[ix];
+    m_free = n.next;
+
+    n.fn = std::move(fn);
+    // rounded up, a timer never fires early:
+    n.tick = time.count() > 0
+        ? (uint64_t) ((time.count() + m_tick.count() - 1) / m_tick.count())
+        : 0;
+    place(ix);
+
+    m_size++;
+    m_stats.scheduled++;
+    m_stats.max_pending = std::max(m_stats.max_pending, m_size);
+    return TimerHandle{ ix, n.generation };
+}
+
+
+bool TimingWheel::is_pending(TimerHandle h) const
+{
+    return h.index < m_nodes.size() &&
+        m_nodes[h.index].generation == h.generation &&
+        m_nodes[h.index].list != NO_LIST;
+}
+
+
+bool TimingWheel::cancel(TimerHandle h)
+{
+    if (!is_pending(h))
+    {
+        return false;
+    }
+    unlink(h.index);
+    auto& n = m_nodes[h.index];
+    n.fn = nullptr;
+    n.generation++;
+    n.next = m_free;
+    m_free = h.index;
+    m_size--;
+    m_stats.cancelled++;
+    return true;
+}
+
+
+size_t TimingWheel::expire(std::chrono::nanoseconds now, size_t max)
+{
+    begin_expire(now);
+    size_t ran = 0;
+    while (ran < max && expire_next(now))
+    {
+        ran++;
+    }
+    return ran;
+}
+
+
+void TimingWheel::begin_expire(std::chrono::nanoseconds now)
+{
+    const auto target =
+        now.count() > 0 ? (uint64_t) (now / m_tick) : (uint64_t) 0;
+    while (m_current < target)
+    {
+        if (m_in_wheel == 0 && m_lists[OVERFLOW_LIST].head == NIL)
+        {
+            m_current = target;
+            break;
+        }
+        const auto t = next_work_tick();
+        if (t > target)
+        {
+            m_current = target;
+            break;
+        }
+        advance_to(t);
+    }
+    move_all(DUE_LIST, EXPIRING_LIST);
+}
+
+
+bool TimingWheel::expire_next(std::chrono::nanoseconds now)
+{
+    const auto ix = m_lists[EXPIRING_LIST].head;
+    if (ix == NIL)
+    {
+        return false;
+    }
+    unlink(ix);
+    auto& n = m_nodes[ix];
+    const auto lateness = now - (int64_t) n.tick * m_tick;
+    m_stats.max_lateness = std::max(m_stats.max_lateness, lateness);
+    auto fn = std::move(n.fn);
+    n.fn = nullptr;
+    n.generation++;
+    n.next = m_free;
+    m_free = ix;
+    m_size--;
+    m_stats.fired++;
+    // may schedule into the node it just freed:
+    fn();
+    return true;
+}
+
+
+std::chrono::nanoseconds TimingWheel::next_expiry_bound() const
+{
+    if (m_size == 0)
+    {
+        return std::chrono::nanoseconds::max();
+    }
+    if (m_lists[DUE_LIST].head != NIL || m_lists[EXPIRING_LIST].head != NIL)
+    {
+        return (int64_t) m_current * m_tick;
+    }
+    return (int64_t) next_work_tick() * m_tick;
+}
+
+
+uint64_t TimingWheel::next_work_tick() const
+{
+    // the next occupied slot of the lowest level that has one left in its
+    // current turn, everything below that is empty until then:
+    for (size_t l = 0; l < LEVELS; l++)
+    {
+        const auto shift = SLOT_BITS * l;
+        const auto digit = (m_current >> shift) & (SLOTS - 1);
+        const auto later =
+            digit + 1 < SLOTS ? m_occupied[l] & (~0ULL << (digit + 1)) : 0;
+        if (later != 0)
+        {
+            const auto turn = shift + SLOT_BITS;
+            return ((m_current >> turn) << turn) +
+                ((uint64_t) std::countr_zero(later) << shift);
+        }
+    }
+    // the next turn of the top level, which takes the overflow:
+    constexpr auto top = SLOT_BITS * LEVELS;
+    return ((m_current >> top) + 1) << top;
+}
+
+
+void TimingWheel::advance_to(uint64_t t)
+{
+    m_current = t;
+    constexpr auto top = SLOT_BITS * LEVELS;
+    if ((t & ((1ULL << top) - 1)) == 0)
+    {
+        replace_all(OVERFLOW_LIST);
+    }
+    // from the top, a timer may move down several levels at once:
+    for (size_t l = LEVELS - 1; l > 0; l--)
+    {
+        const auto shift = SLOT_BITS * l;
+        if ((t & ((1ULL << shift) - 1)) == 0)
+        {
+            replace_all((uint16_t) (l * SLOTS + ((t >> shift) & (SLOTS - 1))));
+        }
+    }
+    move_all((uint16_t) (t & (SLOTS - 1)), DUE_LIST);
+}
+
+
+void TimingWheel::place(uint32_t ix)
+{
+    const auto t = m_nodes[ix].tick;
+    if (t <= m_current)
+    {
+        link(ix, DUE_LIST);
+        return;
+    }
+    // the lowest level whose current turn 't' falls into, there its slot
+    // lies ahead of us:
+    for (size_t l = 0; l < LEVELS; l++)
+    {
+        const auto turn = SLOT_BITS * (l + 1);
+        if ((t >> turn) == (m_current >> turn))
+        {
+            link(ix,
+                (uint16_t) (l * SLOTS + ((t >> (SLOT_BITS * l)) & (SLOTS - 1))));
+            return;
+        }
+    }
+    link(ix, OVERFLOW_LIST);
+}
+
+
+void TimingWheel::link(uint32_t ix, uint16_t list)
+{
+    auto& n = m_nodes[ix];
+    auto& l = m_lists[list];
+    n.list = list;
+    n.next = NIL;
+    n.prev = l.tail;
+    if (l.tail != NIL)
+    {
+        m_nodes[l.tail].next = ix;
+    }
+    else
+    {
+        l.head = ix;
+    }
+    l.tail = ix;
+    if (list < DUE_LIST)
+    {
+        m_occupied[list / SLOTS] |= 1ULL << (list % SLOTS);
+        m_in_wheel++;
+    }
+}
+
+
+void TimingWheel::unlink(uint32_t ix)
+{
+    auto& n = m_nodes[ix];
+    assert(n.list != NO_LIST);
+    auto& l = m_lists[n.list];
+    (n.prev != NIL ? m_nodes[n.prev].next : l.head) = n.next;
+    (n.next != NIL ? m_nodes[n.next].prev : l.tail) = n.prev;
+    if (n.list < DUE_LIST)
+    {
+        m_in_wheel--;
+        if (l.head == NIL)
+        {
+            m_occupied[n.list / SLOTS] &= ~(1ULL << (n.list % SLOTS));
+        }
+    }
+    n.list = NO_LIST;
+    n.prev = NIL;
+    n.next = NIL;
+}
+
+
+void TimingWheel::replace_all(uint16_t list)
+{
+    // the overflow may take timers back, stop at its old tail:
+    const auto last = m_lists[list].tail;
+    auto ix = m_lists[list].head;
+    while (ix != NIL)
+    {
+        const auto next = m_nodes[ix].next;
+        unlink(ix);
+        place(ix);
+        if (ix == last)
+        {
+            break;
+        }
+        ix = next;
+    }
+}
+
+
+void TimingWheel::move_all(uint16_t list, uint16_t to)
+{
+    while (m_lists[list].head != NIL)
+    {
+        const auto ix = m_lists[list].head;
+        unlink(ix);
+        link(ix, to);
+    }
+}
+
+
+void RealtimeKernel::create_timers(const TimerConfig& config)
+{
+    m_timers = std::make_unique<TimingWheel>(config, m_timer.get_time_ns());
+}
+
+
+TimerHandle RealtimeKernel::schedule_at(
+    std::chrono::nanoseconds time, timer_func_t fn)
+{
+    if (!m_timers)
+    {
+        // the wheel is too big to allocate on the kernel's thread:
+        assert(!m_running);
+        if (m_running)
+        {
+            return TimerHandle();
+        }
+        create_timers(TimerConfig());
+    }
+    return m_timers->schedule_at(time, std::move(fn));
+}
+
+
+TimerHandle RealtimeKernel::schedule_after(
+    std::chrono::nanoseconds delay, timer_func_t fn)
+{
+    return schedule_at(m_timer.get_time_ns() + delay, std::move(fn));
+}
+
+
+bool RealtimeKernel::cancel_timer(TimerHandle h)
+{
+    return m_timers && m_timers->cancel(h);
+}
+
+
+bool RealtimeKernel::run_due_timers(const PeriodicTask* next)
+{
+    if (!m_timers || m_timers->empty())
+    {
+        return false;
+    }
+    auto now = m_timer.get_time_ns();
+    if (m_timers->next_expiry_bound() > now)
+    {
+        return false;
+    }
+
+    // only the timers due now, ones their callbacks schedule for right
+    // away wait for the next call:
+    m_timers->begin_expire(now);
+    bool ran = false;
+    while (next == nullptr ||
+        next->time_left_until_deadline() > m_max_timer_callback)
+    {
+        if (!m_timers->expire_next(now))
+        {
+            break;
+        }
+        const auto end = m_timer.get_time_ns();
+        m_max_timer_callback = std::max(m_max_timer_callback, end - now);
+        m_busy_time += end - now;
+        now = end;
+        ran = true;
+    }
+    return ran;
+}
+
+
+std::chrono::nanoseconds RealtimeKernel::time_until_next_timer() const
+{
+    if (!m_timers || m_timers->empty())
+    {
+        return std::chrono::nanoseconds::max();
+    }
+    return m_timers->next_expiry_bound() - m_timer.get_time_ns();
+}
+
+} // namespace realtime
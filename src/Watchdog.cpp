@@ -0,0 +1,162 @@
+#include <urtsched/Watchdog.hpp>
+
+#include <slogger/ILogger.hpp>
+
+
+namespace realtime
+{
+
+static const char* to_string(WatchdogEvent::Kind kind)
+{
+    switch (kind)
+    {
+    case WatchdogEvent::Kind::STALLED_CORE:
+        return "stalled core";
+    case WatchdogEvent::Kind::RUNAWAY_TASK:
+        return "runaway task";
+    case WatchdogEvent::Kind::DEADLINE_MISSES:
+        return "deadline misses";
+    }
+    return "?";
+}
+
+
+void Watchdog::start()
+{
+    assert(!m_thread.joinable());
+    m_stop = false;
+    m_thread = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stop)
+        {
+            if (m_cond.wait_for(
+                    lock, m_config.check_interval, [this] { return m_stop; }))
+            {
+                break;
+            }
+            lock.unlock();
+            check();
+            lock.lock();
+        }
+    });
+}
+
+
+void Watchdog::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+
+void Watchdog::check()
+{
+    const auto now = m_timer.get_time_ns();
+    if (m_state.size() != m_kernels.size())
+    {
+        m_state.assign(m_kernels.size(), KernelState{ {}, now, 0, false });
+    }
+
+    for (size_t i = 0; i < m_kernels.size(); i++)
+    {
+        auto& k = m_kernels[i];
+        auto& state = m_state[i];
+        const auto hb = k->get_heartbeat();
+
+        if (hb.steps != state.last.steps)
+        {
+            state.last_progress = now;
+            state.reported_stall = false;
+        }
+        else if (!state.reported_stall &&
+            now - state.last_progress > m_config.stall_timeout)
+        {
+            state.reported_stall = true;
+            handle(WatchdogEvent::Kind::STALLED_CORE, m_config.on_stall, k, hb);
+        }
+
+        if (hb.running_task_id != 0 &&
+            hb.running_task_id != state.reported_runaway &&
+            now - hb.running_since > m_config.runaway_timeout)
+        {
+            state.reported_runaway = hb.running_task_id;
+            handle(
+                WatchdogEvent::Kind::RUNAWAY_TASK, m_config.on_runaway, k, hb);
+        }
+        else if (hb.running_task_id == 0)
+        {
+            state.reported_runaway = 0;
+        }
+
+        if (hb.deadline_misses - state.last.deadline_misses >
+            m_config.max_deadline_misses)
+        {
+            handle(WatchdogEvent::Kind::DEADLINE_MISSES,
+                m_config.on_deadline_misses, k, hb);
+        }
+
+        state.last = hb;
+    }
+}
+
+
+void Watchdog::handle(WatchdogEvent::Kind kind, const WatchdogActions& actions,
+    const std::shared_ptr<RealtimeKernel>& kernel, const KernelHeartbeat& hb)
+{
+    m_num_events.fetch_add(1, std::memory_order_relaxed);
+    LOG_ERROR(get_logger(), "watchdog: {} on {}", to_string(kind),
+        kernel->get_name());
+
+    if (actions.log_status)
+    {
+        for (const auto& k : m_kernels)
+        {
+            const auto other = k->get_heartbeat();
+            LOG_ERROR(get_logger(),
+                "watchdog: {} - steps = {}, deadline misses = {}, running "
+                "task = {}",
+                k->get_name(), other.steps, other.deadline_misses,
+                other.running_task_id != 0
+                    ? "#" + std::to_string(other.running_task_id)
+                    : std::string("-"));
+        }
+    }
+
+    if (actions.disable_task && hb.running_task_id != 0)
+    {
+        if (!kernel->post_disable_task_id(hb.running_task_id))
+        {
+            LOG_ERROR(get_logger(), "watchdog: {} - command queue full",
+                kernel->get_name());
+        }
+    }
+
+    if (actions.dump_trace && kernel->get_recorder())
+    {
+        const auto n = kernel->get_recorder()->drain();
+        LOG_ERROR(get_logger(), "watchdog: {} - wrote {} trace records",
+            kernel->get_name(), n);
+    }
+
+    if (actions.request_shutdown)
+    {
+        for (auto& k : m_kernels)
+        {
+            k->request_stop();
+        }
+    }
+
+    if (m_config.on_event)
+    {
+        m_config.on_event(WatchdogEvent{ kind, kernel, hb });
+    }
+}
+
+} // namespace realtime
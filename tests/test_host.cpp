@@ -0,0 +1,262 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include <linux/capability.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <urtsched/HostTopology.hpp>
+#include <urtsched/IsolationVerifier.hpp>
+#include <urtsched/MonotonicTimer.hpp>
+#include <urtsched/MultiCoreRealtimeKernel.hpp>
+#include <urtsched/PowerManagement.hpp>
+
+#include <slogger/DirectConsoleLogger.hpp>
+
+using namespace testing;
+using namespace realtime;
+
+namespace unittests
+{
+
+/** a fake sysfs/procfs root in a temporary directory */
+class FakeHostTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        root = std::filesystem::temp_directory_path() /
+            ("urtsched-host-" + std::to_string(getpid()) + "-" +
+                ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::remove_all(root);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(root);
+    }
+
+    void write(const std::string& path, const std::string& content)
+    {
+        const auto p = root / path;
+        std::filesystem::create_directories(p.parent_path());
+        std::ofstream(p) << content << "\n";
+    }
+
+    std::filesystem::path root;
+    logging::DirectConsoleLogger logger{ true, true,
+        logging::LogOutput::CONSOLE };
+};
+
+static CheckStatus status_of(
+    const IsolationReport& report, const std::string& name)
+{
+    for (const auto& c : report.checks)
+    {
+        if (c.name == name)
+        {
+            return c.status;
+        }
+    }
+    ADD_FAILURE() << "no check named " << name;
+    return CheckStatus::FAILED;
+}
+
+TEST(CpuListTest, ParseAndFormat)
+{
+    EXPECT_THAT(parse_cpu_list("0-3,8,10-11"),
+        ElementsAre(0, 1, 2, 3, 8, 10, 11));
+    EXPECT_THAT(parse_cpu_list("5\n"), ElementsAre(5));
+    EXPECT_TRUE(parse_cpu_list("").empty());
+
+    EXPECT_EQ(format_cpu_list({ 11, 0, 1, 2, 3, 8, 10, 3 }), "0-3,8,10-11");
+    EXPECT_EQ(format_cpu_list({ 2 }), "2");
+    EXPECT_EQ(format_cpu_list({}), "");
+
+    EXPECT_THAT(parse_cpu_mask("00000000,0000000c"), ElementsAre(2, 3));
+    EXPECT_THAT(parse_cpu_mask("1,00000001"), ElementsAre(0, 32));
+    EXPECT_EQ(format_cpu_mask({ 0, 1 }, 2), "00000000,00000003");
+    EXPECT_EQ(format_cpu_mask({ 33 }), "00000002,00000000");
+}
+
+TEST_F(FakeHostTest, DiscoverNumaTopology)
+{
+    write("sys/devices/system/node/node0/cpulist", "0-3");
+    write("sys/devices/system/node/node1/cpulist", "4-7");
+    write("sys/devices/system/node/possible", "0-1");
+
+    const auto numa = NumaTopology::discover(root);
+    ASSERT_EQ(numa.get_nodes().size(), 2u);
+    EXPECT_EQ(numa.node_of_cpu(2), 0u);
+    EXPECT_EQ(numa.node_of_cpu(6), 1u);
+    EXPECT_EQ(numa.node_of_cpu(42), std::nullopt);
+    EXPECT_THAT(numa.nodes_of_cpus({ 3, 4, 5 }), ElementsAre(0, 1));
+}
+
+TEST_F(FakeHostTest, VerifyIsolatedHost)
+{
+    write("proc/cmdline",
+        "BOOT_IMAGE=/vmlinuz isolcpus=domain,managed_irq,2-3 nohz_full=2-3 "
+        "rcu_nocbs=2-3 quiet");
+    write("proc/irq/24/smp_affinity", "00000003");
+    write("proc/sys/kernel/sched_rt_runtime_us", "-1");
+    write("sys/devices/system/cpu/cpu2/cpufreq/scaling_governor", "performance");
+    write("sys/devices/system/cpu/cpu3/cpufreq/scaling_governor", "performance");
+
+    IsolationVerifier verifier(root, { 2, 3 }, logger);
+    const auto report = verifier.verify();
+    EXPECT_TRUE(report.ok()) << report.to_json();
+    for (const auto& c : report.checks)
+    {
+        EXPECT_EQ(c.status, CheckStatus::OK) << c.name << ": " << c.detail;
+    }
+}
+
+TEST_F(FakeHostTest, VerifyMisconfiguredHostAndSteerIrqs)
+{
+    write("proc/cmdline", "BOOT_IMAGE=/vmlinuz isolcpus=2 quiet");
+    write("proc/irq/24/smp_affinity", "00000000,0000000f");
+    write("proc/irq/25/smp_affinity", "00000003");
+    write("proc/sys/kernel/sched_rt_runtime_us", "950000");
+    write("sys/devices/system/cpu/cpu3/cpufreq/scaling_governor", "powersave");
+
+    IsolationVerifier verifier(root, { 2, 3 }, logger);
+    auto report = verifier.verify();
+    EXPECT_FALSE(report.ok());
+    EXPECT_EQ(status_of(report, "isolcpus"), CheckStatus::WARNING);
+    EXPECT_EQ(status_of(report, "nohz_full"), CheckStatus::WARNING);
+    EXPECT_EQ(status_of(report, "irq_affinity"), CheckStatus::FAILED);
+    EXPECT_EQ(status_of(report, "rt_throttling"), CheckStatus::WARNING);
+    EXPECT_EQ(status_of(report, "cpu_governor"), CheckStatus::WARNING);
+
+    EXPECT_EQ(verifier.steer_irqs_away(), 1u);
+    EXPECT_EQ(read_file(root / "proc/irq/24/smp_affinity"), "00000000,00000003");
+
+    report = verifier.verify();
+    EXPECT_EQ(status_of(report, "irq_affinity"), CheckStatus::OK);
+}
+
+
+TEST_F(FakeHostTest, SteeredIrqsAreRestored)
+{
+    write("proc/irq/24/smp_affinity", "00000000,0000000f");
+    write("proc/irq/25/smp_affinity", "00000003");
+
+    IsolationVerifier verifier(root, { 2, 3 }, logger);
+    {
+        IrqSteering steering(verifier);
+        EXPECT_EQ(steering.get_num_steered(), 1u);
+        EXPECT_EQ(
+            read_file(root / "proc/irq/24/smp_affinity"), "00000000,00000003");
+    }
+    EXPECT_EQ(read_file(root / "proc/irq/24/smp_affinity"), "00000000,0000000f");
+    EXPECT_EQ(read_file(root / "proc/irq/25/smp_affinity"), "00000003");
+}
+
+
+TEST_F(FakeHostTest, PowerLatencyIsHeldAndRestored)
+{
+    write("dev/cpu_dma_latency", "");
+    write("sys/devices/system/cpu/cpu2/power/pm_qos_resume_latency_us", "0");
+    write("sys/devices/system/cpu/cpu3/power/pm_qos_resume_latency_us", "0");
+
+    PowerLatencyConfig config;
+    config.cpu_dma_latency = std::chrono::microseconds(10);
+    config.resume_latency = std::chrono::microseconds(0);
+    {
+        PowerLatencyRequest request(root, config, { 2, 3 }, logger);
+        EXPECT_TRUE(request.ok());
+
+        int32_t latency = -1;
+        std::ifstream(root / "dev/cpu_dma_latency", std::ios::binary)
+            .read(reinterpret_cast<char*>(&latency), sizeof(latency));
+        EXPECT_EQ(latency, 10);
+        EXPECT_EQ(read_file(root /
+                      "sys/devices/system/cpu/cpu3/power/pm_qos_resume_latency_us"),
+            "n/a");
+    }
+    EXPECT_EQ(read_file(root /
+                  "sys/devices/system/cpu/cpu3/power/pm_qos_resume_latency_us"),
+        "0");
+
+    // cpu4 has no such file:
+    PowerLatencyRequest missing(root, config, { 4 }, logger);
+    EXPECT_FALSE(missing.ok());
+}
+
+
+TEST_F(FakeHostTest, ReserveCoresUsingCgroupsV2)
+{
+    write("sys/fs/cgroup/cgroup.controllers", "cpuset cpu memory");
+    write("sys/fs/cgroup/cgroup.subtree_control", "");
+
+    MonotonicTimer timer;
+    service::ServiceBus bus;
+    MultiCoreRealtimeKernel kernel(
+        timer, logger, bus, CoreReservationMechanism::CGROUPS, 0);
+    kernel.set_host_root(root);
+    kernel.set_isolation_config({ .verify = false, .steer_irqs = false });
+    kernel.add_core();
+
+    EXPECT_EQ(kernel.run(std::chrono::milliseconds(10)), error::Error::OK);
+    const auto cgroup = root / "sys/fs/cgroup/urtsched";
+    EXPECT_EQ(read_file(root / "sys/fs/cgroup/cgroup.subtree_control"),
+        "+cpuset");
+    EXPECT_EQ(read_file(cgroup / "cpuset.cpus"), "0");
+    EXPECT_EQ(read_file(cgroup / "cpuset.cpus.partition"), "isolated");
+    EXPECT_EQ(read_file(cgroup / "cgroup.procs"), std::to_string(getpid()));
+
+    // a write that fails is reported, the kernel still runs:
+    std::filesystem::remove(cgroup / "cpuset.cpus");
+    std::filesystem::create_directory(cgroup / "cpuset.cpus");
+    EXPECT_EQ(kernel.run(std::chrono::milliseconds(10)), error::Error::FAILED);
+}
+
+
+TEST_F(FakeHostTest, FailedMemoryLockIsReported)
+{
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0)
+    {
+        // no locked memory allowed, not even for root:
+        const rlimit none{ 0, 0 };
+        __user_cap_header_struct header{ _LINUX_CAPABILITY_VERSION_3, 0 };
+        __user_cap_data_struct caps[2] = {};
+        if (setrlimit(RLIMIT_MEMLOCK, &none) != 0 ||
+            syscall(SYS_capget, &header, caps) != 0)
+        {
+            _exit(2);
+        }
+        caps[CAP_IPC_LOCK / 32].effective &= ~(1u << (CAP_IPC_LOCK % 32));
+        if (syscall(SYS_capset, &header, caps) != 0)
+        {
+            _exit(2);
+        }
+
+        MonotonicTimer timer;
+        service::ServiceBus bus;
+        MultiCoreRealtimeKernel kernel(
+            timer, logger, bus, CoreReservationMechanism::NONE, 0);
+        kernel.set_host_root(root);
+        kernel.set_isolation_config({ .verify = false, .steer_irqs = false });
+        MemoryHardeningConfig config;
+        config.prefault_stack_bytes = 0;
+        kernel.set_memory_hardening(config);
+        kernel.add_core();
+        _exit(kernel.run(std::chrono::milliseconds(10)) == error::Error::FAILED
+                ? 0
+                : 1);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+} // namespace unittests
@@ -1,8 +1,29 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory_resource>
+#include <random>
+#include <thread>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
 #include <slogger/DirectConsoleLogger.hpp>
 #include <urtsched/RealtimeKernel.hpp>
+#include <urtsched/ReplayDriver.hpp>
+#include <urtsched/Service.hpp>
+#include <urtsched/ServiceBus.hpp>
+#include <urtsched/TaskChain.hpp>
+#include <urtsched/TimingWheel.hpp>
+#include <urtsched/Watchdog.hpp>
 
 #include "../simple-logger/tests/slogger_mocks.hpp"
 
@@ -40,6 +61,22 @@ protected:
     std::chrono::nanoseconds current_time{ 0 };
 };
 
+/** a kernel in virtual time, see RealtimeKernel::enable_simulation() */
+class SimulatedKernelTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        kernel.enable_simulation(timer);
+    }
+
+    SimulatedTimer timer;
+    logging::DirectConsoleLogger logger{ true, true,
+        logging::LogOutput::CONSOLE };
+    RealtimeKernel kernel{ timer, logger, "simulated" };
+};
+
+
 // Test that periodic tasks run before idle tasks and in correct order
 TEST_F(RealtimeKernelTest, PeriodicTasksRunBeforeIdleTasks)
 {
@@ -217,4 +254,1616 @@ TEST_F(RealtimeKernelTest, IdleTasksRunWhenNoPeriodicTasksReady)
         << "Idle tasks should have run when no periodic tasks were ready";
 }
 
+// Test that an aperiodic server does not run more jobs than its budget allows
+TEST_F(RealtimeKernelTest, AperiodicServerIsBoundedByBudget)
+{
+    // every job takes 1ms on the mock timer, so 2 jobs fit in every 10ms.
+    auto server = kernel->add_aperiodic_server("events", 2ms, 10ms);
+
+    int jobs_run = 0;
+    for (int i = 0; i < 40; i++)
+    {
+        ASSERT_TRUE(server->post([&](BaseTask&) {
+            jobs_run++;
+            return TaskStatus::TASK_OK;
+        }));
+    }
+
+    kernel->run(50ms);
+
+    EXPECT_GT(jobs_run, 0) << "the server should have served some jobs";
+    EXPECT_LE(jobs_run, 12) << "the server took more than its budget";
+    EXPECT_EQ(server->get_num_served(), (uint64_t) jobs_run);
+    EXPECT_EQ(server->get_num_dropped(), 0u);
+    EXPECT_TRUE(server->has_pending());
+
+    const auto status = kernel->get_service_status_as_json();
+    EXPECT_NE(status.find("\"servers\""), std::string::npos);
+}
+
+TEST_F(RealtimeKernelTest, AperiodicServersAreLimited)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_NE(kernel->add_aperiodic_server(
+                      "server " + std::to_string(i), 1ms, 10ms),
+            nullptr);
+    }
+    EXPECT_EQ(kernel->add_aperiodic_server("one too many", 1ms, 10ms), nullptr);
+}
+
+class TestService : public service::Service
+{
+public:
+    using service::Service::Service;
+
+    [[nodiscard]] error::Error init() override
+    {
+        return error::Error::OK;
+    }
+
+    [[nodiscard]] error::Error finish() override
+    {
+        return error::Error::OK;
+    }
+};
+
+// Test that a service with a slow idle task cannot starve its neighbours
+TEST_F(RealtimeKernelTest, ServiceReservationContainsNoisyNeighbour)
+{
+    TestService noisy(kernel, *logger);
+    TestService quiet(kernel, *logger);
+    noisy.set_cpu_reservation("noisy", 2ms, 20ms);
+
+    int noisy_runs = 0;
+    auto slow = noisy.add_idle_task("slow", [&](BaseTask&) {
+        current_time += 5ms;
+        noisy_runs++;
+        return TaskStatus::TASK_OK;
+    });
+
+    int quiet_runs = 0;
+    auto fast = quiet.add_idle_task("fast", [&](BaseTask&) {
+        quiet_runs++;
+        return TaskStatus::TASK_OK;
+    });
+
+    kernel->run(200ms);
+
+    const auto& reservation = noisy.get_cpu_reservation();
+    ASSERT_NE(reservation, nullptr);
+    EXPECT_GT(noisy_runs, 0);
+    EXPECT_GT(quiet_runs, noisy_runs);
+    EXPECT_GT(reservation->get_num_throttled(), 0u);
+    EXPECT_GT(reservation->get_budget().get_num_overruns(), 0u);
+    EXPECT_EQ(fast->get_reservation(), nullptr);
+    EXPECT_EQ(slow->get_reservation(), reservation.get());
+    // once per period it ran out, not per check:
+    EXPECT_LE(reservation->get_num_throttled(),
+        reservation->get_budget().get_num_periods() + 1);
+
+    noisy.set_cpu_reservation("noisier", 4ms, 20ms);
+    EXPECT_EQ(slow->get_reservation(), noisy.get_cpu_reservation().get());
+    const auto status = kernel->get_service_status_as_json();
+    EXPECT_EQ(status.find("\"noisy\""), std::string::npos) << status;
+    EXPECT_NE(status.find("\"noisier\""), std::string::npos) << status;
+}
+
+// Test that a mode change swaps the whole task set at once
+TEST_F(RealtimeKernelTest, ModeChangeSwitchesTaskSets)
+{
+    int startup_count = 0;
+    int running_count = 0;
+
+    auto startup = kernel->add_periodic(
+        TaskType::SOFT_REALTIME, "startup", 10ms, [&](BaseTask&) {
+            startup_count++;
+            return TaskStatus::TASK_OK;
+        });
+    auto running = kernel->add_periodic(
+        TaskType::SOFT_REALTIME, "running", 20ms, [&](BaseTask&) {
+            running_count++;
+            return TaskStatus::TASK_OK;
+        });
+
+    ASSERT_TRUE(kernel->define_mode("startup", { { startup } }));
+    ASSERT_TRUE(kernel->define_mode("running", { { running, 5ms } }));
+    EXPECT_FALSE(kernel->request_mode_change("no-such-mode"));
+
+    ASSERT_TRUE(kernel->request_mode_change("startup"));
+    kernel->run(50ms);
+
+    EXPECT_EQ(kernel->get_current_mode(), "startup");
+    EXPECT_GT(startup_count, 0);
+    EXPECT_EQ(running_count, 0);
+
+    const auto startup_count_before = startup_count;
+    ASSERT_TRUE(kernel->request_mode_change(
+        "running", ModeChangeBoundary::HYPERPERIOD));
+    kernel->run(50ms);
+
+    EXPECT_EQ(kernel->get_current_mode(), "running");
+    EXPECT_EQ(kernel->get_num_mode_changes(), 2u);
+    EXPECT_GT(running_count, 0);
+    EXPECT_FALSE(startup->is_enabled());
+    EXPECT_EQ(running->get_period(), 5ms);
+    EXPECT_LE(startup_count - startup_count_before, 2);
+    EXPECT_GT(kernel->get_last_mode_change_latency().count(), 0);
+
+    // the kernel has room for 8 modes, redefining one takes no more:
+    for (int i = 2; i < 8; i++)
+    {
+        EXPECT_TRUE(kernel->define_mode("mode-" + std::to_string(i), {}));
+    }
+    EXPECT_FALSE(kernel->define_mode("one-too-many", {}));
+    EXPECT_TRUE(kernel->define_mode("running", { { running, 10ms } }));
+    EXPECT_FALSE(kernel->request_mode_change("one-too-many"));
+}
+
+// Test that tasks can be reconfigured from another thread
+TEST_F(RealtimeKernelTest, ReconfigureFromManagementThread)
+{
+    int count = 0;
+    std::shared_ptr<PeriodicTask> periodic;
+
+    std::thread management([&]() {
+        periodic = kernel->post_add_periodic(
+            TaskType::SOFT_REALTIME, "managed", 10ms, [&](BaseTask&) {
+                count++;
+                return TaskStatus::TASK_OK;
+            });
+        ASSERT_NE(periodic, nullptr);
+        EXPECT_TRUE(kernel->post_set_period(periodic, 5ms));
+        EXPECT_TRUE(kernel->post_enable(periodic));
+    });
+    management.join();
+
+    EXPECT_FALSE(periodic->is_enabled()) << "applied before the kernel ran";
+
+    kernel->run(50ms);
+    EXPECT_TRUE(periodic->is_enabled());
+    EXPECT_EQ(periodic->get_period(), 5ms);
+    EXPECT_GT(count, 0);
+
+    std::thread([&]() { EXPECT_TRUE(kernel->post_remove(periodic)); }).join();
+    kernel->step();
+    EXPECT_FALSE(kernel->remove(periodic)) << "should already be removed";
+}
+
+TEST_F(RealtimeKernelTest, PostedAddsFailWhenTheKernelIsFull)
+{
+    std::vector<std::shared_ptr<PeriodicTask>> tasks;
+    std::thread management([&]() {
+        for (int i = 0; i < 64; i++)
+        {
+            tasks.push_back(kernel->post_add_periodic(TaskType::SOFT_REALTIME,
+                "managed " + std::to_string(i), 10ms,
+                [](BaseTask&) { return TaskStatus::TASK_OK; }));
+            ASSERT_NE(tasks.back(), nullptr);
+        }
+        // the queued adds took all slots already:
+        EXPECT_EQ(kernel->post_add_periodic(TaskType::SOFT_REALTIME, "full",
+                      10ms, [](BaseTask&) { return TaskStatus::TASK_OK; }),
+            nullptr);
+    });
+    management.join();
+    EXPECT_EQ(kernel->add_periodic(TaskType::SOFT_REALTIME, "full", 10ms,
+                  [](BaseTask&) { return TaskStatus::TASK_OK; }),
+        nullptr);
+
+    EXPECT_NO_THROW(kernel->step());
+    EXPECT_TRUE(kernel->remove(tasks[0]));
+    // what a failed add returned matches no empty slot:
+    EXPECT_FALSE(kernel->remove(nullptr));
+    EXPECT_FALSE(kernel->post_remove(nullptr));
+    EXPECT_NE(kernel->post_add_periodic(TaskType::SOFT_REALTIME, "again", 10ms,
+                  [](BaseTask&) { return TaskStatus::TASK_OK; }),
+        nullptr);
+    EXPECT_EQ(kernel->add_periodic(TaskType::SOFT_REALTIME, "one too many",
+                  10ms, [](BaseTask&) { return TaskStatus::TASK_OK; }),
+        nullptr);
+    kernel->step();
+    size_t scheduled = 0;
+    kernel->for_each_task([&scheduled](const BaseTask&) { scheduled++; });
+    EXPECT_EQ(scheduled, 64u);
+}
+
+class SteadyTimer : public time_utils::ITimer
+{
+public:
+    std::chrono::nanoseconds get_time_ns() override
+    {
+        return std::chrono::steady_clock::now().time_since_epoch();
+    }
+};
+
+// Test that the watchdog catches a runaway task and stops the kernel
+TEST(WatchdogTest, RunawayTaskIsDisabledAndKernelStopped)
+{
+    SteadyTimer timer;
+    logging::DirectConsoleLogger logger(
+        true, true, logging::LogOutput::CONSOLE);
+    auto kernel = std::make_shared<RealtimeKernel>(timer, logger, "core-0");
+
+    auto runaway = kernel->add_idle_task("runaway", [](BaseTask&) {
+        std::this_thread::sleep_for(200ms);
+        return TaskStatus::TASK_OK;
+    });
+
+    WatchdogConfig config;
+    config.check_interval = 2ms;
+    config.runaway_timeout = 20ms;
+    config.on_runaway = WatchdogActions{ true, true, true };
+    std::vector<WatchdogEvent::Kind> events;
+    config.on_event = [&](const WatchdogEvent& e) { events.push_back(e.kind); };
+
+    Watchdog watchdog(timer, logger, config, { kernel });
+    watchdog.start();
+    kernel->run(std::nullopt); // forever, unless stopped
+    watchdog.stop();
+
+    ASSERT_FALSE(events.empty());
+    EXPECT_EQ(events[0], WatchdogEvent::Kind::RUNAWAY_TASK);
+    EXPECT_FALSE(runaway->is_enabled());
+    EXPECT_TRUE(kernel->should_exit());
+    EXPECT_GT(kernel->get_heartbeat().steps, 0u);
+}
+
+// Test that the watchdog writes out the trace ring of a missing core
+TEST(WatchdogTest, DeadlineMissesDumpTheTrace)
+{
+    const auto path = std::filesystem::temp_directory_path() /
+        ("urtsched-watchdog-" + std::to_string(getpid()));
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+    SimulatedTimer timer;
+    auto kernel = std::make_shared<RealtimeKernel>(timer, logger, "core-0");
+    kernel->enable_simulation(timer);
+
+    auto late = kernel->add_periodic(TaskType::HARD_REALTIME, "late", 1ms,
+        [](BaseTask&) { return TaskStatus::TASK_OK; });
+    late->set_cost_model(std::make_shared<FixedCost>(1500us));
+    late->enable();
+
+    // not started, only the watchdog drains it:
+    auto recorder = std::make_shared<TaskRecorder>(kernel->get_name());
+    ASSERT_TRUE(recorder->open(path));
+    kernel->set_recorder(recorder);
+    kernel->run(20ms);
+    EXPECT_EQ(recorder->get_num_written(), 0u);
+
+    WatchdogConfig config;
+    config.max_deadline_misses = 1;
+    config.on_deadline_misses = WatchdogActions{ false, false, false, true };
+    Watchdog watchdog(timer, logger, config, { kernel });
+    watchdog.check();
+    EXPECT_EQ(watchdog.get_num_events(), 1u);
+    EXPECT_GT(recorder->get_num_written(), 1u);
+
+    recorder->close();
+    const auto recording = TaskRecorder::load(path);
+    std::filesystem::remove(path);
+    ASSERT_TRUE(recording);
+    EXPECT_EQ(recording->records.size(), recorder->get_num_written());
+}
+
+// Test that the memory preparation maps and reports the kernel's memory
+TEST_F(RealtimeKernelTest, PrepareMemoryMapsStateAndCountsFaults)
+{
+    MemoryHardeningConfig config;
+    config.lock_memory = false;
+    config.prefault_stack_bytes = 64 * 1024;
+    config.state_memory_bytes = 1024 * 1024;
+    kernel->prepare_memory(config);
+
+    auto& memory = kernel->get_state_memory();
+    ASSERT_NE(memory.data(), nullptr);
+    EXPECT_GE(memory.size(), config.state_memory_bytes);
+
+    const auto& report = kernel->get_memory_report();
+    EXPECT_GE(report.after_prefault.minor, report.before_prefault.minor);
+
+    kernel->run(10ms);
+    EXPECT_GE(report.at_exit.minor, report.after_prefault.minor);
+}
+
+// Test that tasks get scratch and pool memory from their core's arena
+TEST_F(RealtimeKernelTest, TasksAllocateFromCoreArena)
+{
+    ArenaConfig config;
+    config.scratch_bytes = 4096;
+    config.blocks_per_pool = 4;
+    kernel->create_arena(config);
+
+    int runs = 0;
+    void* long_lived = nullptr;
+    auto idle = kernel->add_idle_task("arena-user", [&](BaseTask& t) {
+        // the scratch memory is handed out again on every run:
+        std::pmr::vector<int> v(&t.get_arena().scratch_resource());
+        v.resize(512);
+        EXPECT_THROW(v.resize(2048), std::bad_alloc);
+
+        if (long_lived == nullptr)
+        {
+            long_lived = t.get_arena().allocate(100);
+        }
+        runs++;
+        return TaskStatus::TASK_OK;
+    });
+
+    kernel->run(20ms);
+
+    auto& arena = kernel->get_arena();
+    EXPECT_GT(runs, 1);
+    ASSERT_NE(long_lived, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(long_lived) % 128, 0u);
+    EXPECT_EQ(arena.pool_blocks_in_use(2), 1u); // 100 bytes -> 128 byte pool
+    EXPECT_LE(arena.scratch_high_water_mark(), arena.scratch_capacity());
+
+    arena.deallocate(long_lived, 100);
+    EXPECT_EQ(arena.pool_blocks_in_use(2), 0u);
+
+    std::pmr::vector<char> big(&arena.pool_resource());
+    big.resize(4096);
+    EXPECT_THROW(big.resize(8192), std::bad_alloc);
+}
+
+
+TEST_F(RealtimeKernelTest, SchedulingIsAppliedAndRestored)
+{
+    std::thread([this]() {
+        const auto before = save_thread_scheduling();
+        const uint32_t core = (uint32_t) sched_getcpu();
+
+        SchedulingConfig config;
+        config.timer_slack = std::chrono::nanoseconds(1000);
+        kernel->set_scheduling_config(config);
+        EXPECT_EQ(kernel->apply_scheduling(core), error::Error::OK);
+        EXPECT_EQ(prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0), 1000);
+        EXPECT_EQ(sched_getcpu(), (int) core);
+        // no policy configured, the thread keeps its own:
+        EXPECT_EQ(save_thread_scheduling().policy, before.policy);
+        EXPECT_EQ(save_thread_scheduling().priority, before.priority);
+
+        // an impossible priority is reported rather than ignored:
+        config.policy = SchedPolicy::FIFO;
+        config.priority = 1000;
+        kernel->set_scheduling_config(config);
+        EXPECT_NE(kernel->apply_scheduling(core), error::Error::OK);
+
+        restore_thread_scheduling(before);
+        EXPECT_EQ(prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0),
+            (int) before.timer_slack_ns);
+    }).join();
+}
+
+
+TEST_F(RealtimeKernelTest, DeadlineSchedulingIsRestored)
+{
+    std::thread([this]() {
+        const auto before = save_thread_scheduling();
+        const uint32_t core = (uint32_t) sched_getcpu();
+
+        SchedulingConfig config;
+        config.policy = SchedPolicy::DEADLINE;
+        config.runtime = 100us;
+        config.deadline = 1ms;
+        config.period = 2ms;
+        kernel->set_scheduling_config(config);
+        if (kernel->apply_scheduling(core) != error::Error::OK)
+        {
+            GTEST_SKIP() << "no permission for SCHED_DEADLINE";
+        }
+        const auto deadline = save_thread_scheduling();
+        EXPECT_EQ(deadline.policy, SCHED_DEADLINE);
+        EXPECT_EQ(deadline.runtime, 100us);
+        EXPECT_EQ(deadline.deadline, 1ms);
+        EXPECT_EQ(deadline.period, 2ms);
+
+        // back to the caller's policy, then to the deadline parameters:
+        restore_thread_scheduling(before);
+        EXPECT_EQ(save_thread_scheduling().policy, before.policy);
+        restore_thread_scheduling(deadline);
+        const auto restored = save_thread_scheduling();
+        EXPECT_EQ(restored.policy, SCHED_DEADLINE);
+        EXPECT_EQ(restored.runtime, 100us);
+        EXPECT_EQ(restored.deadline, 1ms);
+        EXPECT_EQ(restored.period, 2ms);
+
+        restore_thread_scheduling(before);
+        EXPECT_EQ(save_thread_scheduling().policy, before.policy);
+    }).join();
+}
+
+TEST_F(RealtimeKernelTest, HybridWaitSleepsBetweenReleases)
+{
+    WaitStrategy strategy;
+    strategy.kind = WaitKind::HYBRID;
+    strategy.spin_window = 2ms;
+    strategy.min_sleep = 1ms;
+    kernel->set_wait_strategy(strategy);
+
+    int runs = 0;
+    auto task = kernel->add_periodic(TaskType::HARD_REALTIME, "sparse", 10ms,
+        [&](BaseTask&) {
+            runs++;
+            return TaskStatus::TASK_OK;
+        });
+    task->enable();
+
+    kernel->run(100ms);
+
+    EXPECT_GT(runs, 3);
+    const auto& stats = kernel->get_wait_stats();
+    EXPECT_GT(stats.num_sleeps, 0u);
+    EXPECT_GT(stats.total_slept, 0ns);
+    EXPECT_NE(kernel->get_service_status_as_json().find("\"wait\""),
+        std::string::npos);
+}
+
+
+TEST_F(RealtimeKernelTest, PrefetchRunsRightBeforeTheRelease)
+{
+    WaitStrategy wait;
+    wait.prefetch_window = 10ms; // the mock timer takes 1ms per read
+    kernel->set_wait_strategy(wait);
+
+    std::string events;
+    std::vector<char> state(64 * 1024);
+    auto task = kernel->add_periodic(TaskType::HARD_REALTIME, "control",
+        50ms, [&](BaseTask&) {
+            events += 'R';
+            return TaskStatus::TASK_OK;
+        });
+    EXPECT_TRUE(task->add_prefetch_range(state.data(), state.size()));
+    task->set_prefetch_hook([&](BaseTask&) { events += 'P'; });
+    task->enable();
+    auto idle = kernel->add_idle_task("idle", [&](BaseTask&) {
+        events += 'I';
+        return TaskStatus::TASK_OK;
+    });
+
+    kernel->run(300ms);
+
+    const auto runs = std::count(events.begin(), events.end(), 'R');
+    EXPECT_GT(runs, 2);
+    EXPECT_GT(std::count(events.begin(), events.end(), 'I'), 0);
+    // the first release is due at once, every later run is right after its
+    // prefetch and idle tasks stay out of the window:
+    EXPECT_EQ(events.front(), 'R');
+    EXPECT_EQ(std::count(events.begin(), events.end(), 'P'), runs - 1)
+        << events;
+    for (size_t i = 1; i < events.size(); i++)
+    {
+        if (events[i] == 'R')
+        {
+            EXPECT_EQ(events[i - 1], 'P') << events;
+        }
+    }
+    EXPECT_GT(kernel->get_accounting().spin, 0ns);
+}
+
+
+/** a SimulatedTimer that counts how often it is read */
+class CountingSimulatedTimer : public SimulatedTimer
+{
+public:
+    std::chrono::nanoseconds get_time_ns() override
+    {
+        num_reads++;
+        return SimulatedTimer::get_time_ns();
+    }
+
+    uint64_t num_reads = 0;
+};
+
+/** runs 'runtime' of a schedule with a noisy task in virtual time */
+static std::string simulate(std::chrono::milliseconds runtime, uint64_t seed,
+    uint64_t& control_runs, uint64_t& timer_reads)
+{
+    CountingSimulatedTimer timer;
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+    RealtimeKernel kernel(timer, logger, "simulated");
+    kernel.enable_simulation(timer);
+
+    control_runs = 0;
+    auto control = kernel.add_periodic(TaskType::HARD_REALTIME, "control",
+        1ms, [&](BaseTask&) {
+            control_runs++;
+            return TaskStatus::TASK_OK;
+        });
+    control->set_cost_model(std::make_shared<FixedCost>(100us));
+    control->enable();
+
+    auto noisy = kernel.add_periodic(TaskType::SOFT_REALTIME, "noisy", 5ms,
+        [](BaseTask&) { return TaskStatus::TASK_OK; });
+    noisy->set_cost_model(
+        std::make_shared<NormalCost>(200us, 100us, 0us, 400us, seed));
+    noisy->enable();
+
+    auto poll = kernel.add_idle_task(
+        "poll", [](BaseTask&) { return TaskStatus::TASK_OK; });
+    poll->set_cost_model(std::make_shared<UniformCost>(1us, 10us, seed + 1));
+
+    kernel.run(runtime);
+
+    timer_reads = timer.num_reads;
+    EXPECT_GE(timer.get_time_ns(), runtime);
+    return kernel.get_service_status_as_json();
+}
+
+
+TEST(SimulationTest, VirtualTimeIsDeterministic)
+{
+    uint64_t runs_a = 0;
+    uint64_t runs_b = 0;
+    uint64_t runs_c = 0;
+    uint64_t reads_a = 0;
+    uint64_t reads_b = 0;
+    uint64_t reads_c = 0;
+    const auto runtime = std::chrono::milliseconds(10s);
+    const auto a = simulate(runtime, 42, runs_a, reads_a);
+    const auto b = simulate(runtime, 42, runs_b, reads_b);
+    const auto c = simulate(runtime, 43, runs_c, reads_c);
+
+    // one run per millisecond, give or take the last one:
+    EXPECT_NEAR((double) runs_a, 10.0 * 1000.0, 1.0);
+    EXPECT_EQ(runs_a, runs_b);
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+    // waits jump ahead instead of polling the timer, and the same
+    // schedule reads it the same number of times:
+    EXPECT_EQ(reads_a, reads_b);
+    EXPECT_LT(reads_a, 50 * runs_a);
+}
+
+
+TEST_F(SimulatedKernelTest, AccountingBreaksDownCoreTime)
+{
+    auto control = kernel.add_periodic(TaskType::HARD_REALTIME, "control",
+        1ms, [](BaseTask&) { return TaskStatus::TASK_OK; });
+    control->set_cost_model(std::make_shared<FixedCost>(250us));
+    control->enable();
+
+    kernel.run(1s);
+
+    const auto& a = kernel.get_accounting();
+    EXPECT_EQ(a.total, timer.get_time_ns());
+    EXPECT_EQ(a.total, a.tasks + a.spin + a.idle_sweeps + a.sleep + a.overhead);
+    EXPECT_EQ(a.tasks, kernel.get_busy_time());
+    // virtual time only moves in tasks and waits:
+    EXPECT_NEAR((double) a.tasks.count() / (double) a.total.count(), 0.25, 0.01);
+    EXPECT_NEAR((double) a.sleep.count() / (double) a.total.count(), 0.75, 0.01);
+    EXPECT_EQ(a.overhead, 0ns);
+    EXPECT_NE(kernel.get_service_status_as_json().find("\"accounting\""),
+        std::string::npos);
+}
+
+
+TEST(SimulationTest, CostModels)
+{
+    ReplayCost replay({ 1us, 2us });
+    EXPECT_EQ(replay.next_cost(), 1us);
+    EXPECT_EQ(replay.next_cost(), 2us);
+    EXPECT_EQ(replay.next_cost(), 1us);
+    EXPECT_EQ(replay.get_num_wraps(), 1u);
+
+    NormalCost normal(10us, 100us, 5us, 20us, 1);
+    UniformCost uniform(5us, 20us, 1);
+    for (int i = 0; i < 1000; i++)
+    {
+        const auto n = normal.next_cost();
+        EXPECT_GE(n, 5us);
+        EXPECT_LE(n, 20us);
+        const auto u = uniform.next_cost();
+        EXPECT_GE(u, 5us);
+        EXPECT_LE(u, 20us);
+    }
+
+    SimulatedTimer timer(10ns);
+    timer.advance(5ns);
+    timer.advance_to(12ns);
+    EXPECT_EQ(timer.get_time_ns(), 15ns);
+}
+
+
+TEST_F(SimulatedKernelTest, RecordedRunsReplayWithOtherPeriods)
+{
+    const auto path = std::filesystem::temp_directory_path() /
+        ("urtsched-record-" + std::to_string(getpid()));
+
+    {
+        auto control = kernel.add_periodic(TaskType::HARD_REALTIME, "control",
+            1ms, [](BaseTask&) { return TaskStatus::TASK_OK; });
+        control->set_cost_model(std::make_shared<UniformCost>(100us, 300us, 7));
+        control->enable();
+
+        auto recorder = std::make_shared<TaskRecorder>(kernel.get_name());
+        ASSERT_TRUE(recorder->open(path));
+        kernel.set_recorder(recorder);
+
+        // added after the recorder, while it drains:
+        auto poll = kernel.add_idle_task(
+            "poll", [](BaseTask&) { return TaskStatus::TASK_YIELD; });
+        poll->set_cost_model(std::make_shared<FixedCost>(50us));
+
+        recorder->start(1ms);
+        kernel.run(2s);
+        recorder->close();
+        EXPECT_EQ(recorder->get_num_dropped(), 0u);
+        EXPECT_GT(recorder->get_num_written(), 2000u);
+    }
+
+    auto recording = TaskRecorder::load(path);
+    ASSERT_TRUE(recording);
+    {
+        // a batch claiming more records than the file has is refused:
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        const uint8_t tag = 2;
+        const uint32_t count = UINT32_MAX;
+        out.write((const char*) &tag, sizeof(tag));
+        out.write((const char*) &count, sizeof(count));
+    }
+    EXPECT_FALSE(TaskRecorder::load(path));
+    std::filesystem::remove(path);
+    EXPECT_EQ(recording->kernel_name, kernel.get_name());
+    ASSERT_EQ(recording->tasks.size(), 2u);
+    EXPECT_EQ(recording->tasks[0].name, "periodic: control");
+    EXPECT_EQ(recording->tasks[0].period, 1ms);
+    EXPECT_EQ(recording->tasks[1].kind, RecordedTaskKind::IDLE);
+
+    const auto control_runs = recording->durations_of(recording->tasks[0].id);
+    ASSERT_GE(control_runs.size(), 1999u);
+    for (const auto& d : control_runs)
+    {
+        EXPECT_GE(d, 100us);
+        EXPECT_LE(d, 300us);
+    }
+    for (const auto& r : recording->records)
+    {
+        if (r.task_id == recording->tasks[1].id)
+        {
+            EXPECT_EQ(r.status, (uint32_t) TaskStatus::TASK_YIELD);
+        }
+    }
+    EXPECT_GE(recording->span(), 1999ms);
+
+    ReplayDriver driver(logger, { *recording });
+
+    const auto as_recorded = driver.run();
+    ASSERT_NE(as_recorded.find("control"), nullptr);
+    EXPECT_EQ(as_recorded.total_deadline_misses, 0u);
+    EXPECT_GE(as_recorded.find("control")->runs, 1999u);
+
+    // what if control had to run every 200us?
+    ReplayConfig faster;
+    faster.periods["control"] = 200us;
+    const auto what_if = driver.run(faster);
+    EXPECT_GT(what_if.find("control")->deadline_misses, 0u);
+
+    // and with the poller moved to a core of its own?
+    ReplayConfig moved;
+    moved.placement["poll"] = 1;
+    const auto placed = driver.run(moved);
+    EXPECT_EQ(placed.find("poll")->core, 1u);
+    EXPECT_NE(placed.to_json().find("\"deadline_misses\":0"), std::string::npos);
+
+    // and as soft real-time?
+    ReplayConfig soft = faster;
+    soft.task_types["control"] = TaskType::SOFT_REALTIME;
+    const auto softer = driver.run(soft);
+    EXPECT_EQ(as_recorded.find("control")->type, TaskType::HARD_REALTIME);
+    EXPECT_EQ(softer.find("control")->type, TaskType::SOFT_REALTIME);
+    EXPECT_GT(softer.find("control")->deadline_misses, 0u);
+
+    ReplayReport quoted;
+    quoted.tasks.push_back({ .name = "say \"hi\"" });
+    EXPECT_NE(quoted.to_json().find("\"say \\\"hi\\\"\""), std::string::npos)
+        << quoted.to_json();
+}
+
+
+class LegacyStatusService : public service::IService
+{
+public:
+    std::string get_service_status_as_json() const override
+    {
+        return "{ \"legacy\": true }";
+    }
+
+    [[nodiscard]] error::Error init() override
+    {
+        return error::Error::OK;
+    }
+
+    [[nodiscard]] error::Error finish() override
+    {
+        return error::Error::OK;
+    }
+};
+
+
+TEST_F(RealtimeKernelTest, StatusWriterSkipsRemovedTasks)
+{
+    auto removed = kernel->add_periodic(TaskType::SOFT_REALTIME, "removed",
+        1ms, [](BaseTask&) { return TaskStatus::TASK_OK; });
+    auto kept = kernel->add_periodic(TaskType::SOFT_REALTIME, "say \"hi\"",
+        2ms, [](BaseTask&) { return TaskStatus::TASK_OK; });
+    kept->enable();
+    auto idle = kernel->add_idle_task(
+        "idle", [](BaseTask&) { return TaskStatus::TASK_OK; });
+    EXPECT_TRUE(kernel->remove(removed));
+    kernel->run(20ms);
+
+    service::ServiceBus bus;
+    bus.add(kernel);
+    bus.add(std::make_shared<LegacyStatusService>());
+
+    const auto json = bus.get_service_status_as_json();
+    EXPECT_EQ(json.find("removed"), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"periodic: say \\\"hi\\\"\""),
+        std::string::npos)
+        << json;
+    EXPECT_EQ(json.front(), '[');
+    EXPECT_NE(json.find(",{ \"legacy\": true }]"), std::string::npos);
+
+    // the binary form decodes to the same json:
+    std::vector<char> buffer(64 * 1024);
+    const auto binary_size =
+        bus.write_status(buffer, service::StatusFormat::BINARY);
+    ASSERT_LE(binary_size, buffer.size());
+    std::string decoded;
+    ASSERT_TRUE(service::status_to_json(
+        std::span<const char>(buffer.data(), binary_size), decoded));
+    EXPECT_EQ(decoded, json);
+    EXPECT_FALSE(service::status_to_json(
+        std::span<const char>(buffer.data(), binary_size - 1), decoded));
+
+    // a small buffer is filled up and tells how much is needed:
+    char small[16];
+    EXPECT_EQ(bus.write_status(small), json.size());
+    EXPECT_EQ(std::string_view(small, sizeof(small)),
+        std::string_view(json).substr(0, sizeof(small)));
+}
+
+
+TEST(StatusWriterTest, NonFiniteAndTooDeepValues)
+{
+    const auto write = [](service::StatusWriter& w) {
+        w.begin_object();
+        w.value("inf", std::numeric_limits<double>::infinity());
+        w.value("nan", std::numeric_limits<double>::quiet_NaN());
+        for (size_t i = 0; i < service::StatusWriter::MAX_DEPTH; i++)
+        {
+            w.begin_array("a");
+            w.value({}, i);
+        }
+        for (size_t i = 0; i < service::StatusWriter::MAX_DEPTH; i++)
+        {
+            w.end_array();
+        }
+        w.value("after", true);
+        w.end_object();
+    };
+
+    char buffer[1024];
+    service::StatusWriter w(buffer);
+    write(w);
+    EXPECT_TRUE(w.too_deep());
+    const auto json = std::string(w.view());
+    // the object and the first 14 arrays fit:
+    std::string expected = "{\"inf\":null,\"nan\":null,\"a\":[0";
+    for (int i = 1; i < 14; i++)
+    {
+        expected += ",[" + std::to_string(i);
+    }
+    expected += std::string(14, ']') + ",\"after\":true}";
+    EXPECT_EQ(json, expected);
+
+    // and the binary form decodes to the same:
+    char binary[1024];
+    service::StatusWriter b(binary, service::StatusFormat::BINARY);
+    write(b);
+    std::string decoded;
+    ASSERT_TRUE(service::status_to_json(b.view(), decoded));
+    EXPECT_EQ(decoded, json);
+}
+
+
+TEST_F(SimulatedKernelTest, ProfilesSeedTasksAfterRestart)
+{
+    const auto path = std::filesystem::temp_directory_path() /
+        ("urtsched-profiles-" + std::to_string(getpid()));
+    const auto add_tasks = [](RealtimeKernel& kernel,
+                               std::chrono::nanoseconds cost) {
+        auto control = kernel.add_periodic(TaskType::HARD_REALTIME, "control",
+            1ms, [](BaseTask&) { return TaskStatus::TASK_OK; });
+        control->set_cost_model(std::make_shared<FixedCost>(cost));
+        control->enable();
+        auto poll = kernel.add_idle_task(
+            "poll", [](BaseTask&) { return TaskStatus::TASK_OK; });
+        poll->set_cost_model(std::make_shared<FixedCost>(50us));
+        return control;
+    };
+
+    {
+        // the same kernel, before the restart:
+        SimulatedTimer earlier_timer;
+        RealtimeKernel earlier(earlier_timer, logger, kernel.get_name());
+        earlier.enable_simulation(earlier_timer);
+        auto store = std::make_shared<TaskProfileStore>(earlier.get_name());
+        EXPECT_FALSE(store->load(path));
+        earlier.set_profile_store(store);
+        add_tasks(earlier, 300us);
+        // room is made when the tasks are added, the kernel's loop
+        // doesn't allocate for them:
+        EXPECT_EQ(store->size(), 2u);
+        earlier.run(2s);
+        ASSERT_EQ(store->size(), 2u);
+        ASSERT_TRUE(store->save(path));
+    }
+
+    auto store = std::make_shared<TaskProfileStore>(kernel.get_name());
+    ASSERT_TRUE(store->load(path));
+    kernel.set_profile_store(store);
+    // slower after the restart:
+    auto control = add_tasks(kernel, 400us);
+
+    // known before the first run:
+    EXPECT_TRUE(control->is_seeded());
+    EXPECT_EQ(control->max_time_taken_ns(), 300us);
+    EXPECT_EQ(control->average_time_taken_us(), 300us);
+    TaskProfile profile;
+    control->get_profile(profile);
+    EXPECT_EQ(profile.num_calls, BaseTask::MAX_SEEDED_CALLS);
+    EXPECT_EQ(profile.period, 1ms);
+
+    // no warm-up: the first runs count towards the maximum
+    kernel.run(3ms);
+    EXPECT_EQ(control->max_time_taken_ns(), 400us);
+    EXPECT_EQ(control->warmup_max_time_taken_ns(), 300us);
+    // while the own counters only count this process:
+    EXPECT_GT(control->get_num_calls(), 0u);
+    EXPECT_EQ(control->get_total_time_taken(),
+        (int64_t) control->get_num_calls() * 400us);
+
+    // files of other kernels, truncated or corrupted ones are refused:
+    TaskProfileStore other("staging");
+    EXPECT_FALSE(other.load(path));
+    std::string data;
+    {
+        std::ifstream in(path, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(in), {});
+    }
+    const auto write = [&](const std::string& content) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+    };
+    write(data.substr(0, data.size() - 1));
+    EXPECT_FALSE(store->load(path));
+    data[data.size() / 2] ^= 1;
+    write(data);
+    EXPECT_FALSE(store->load(path));
+    EXPECT_EQ(store->size(), 2u) << "a failed load keeps the profiles";
+    std::filesystem::remove(path);
+}
+
+
+TEST_F(SimulatedKernelTest, SeededMaximumExpires)
+{
+    auto control = kernel.add_periodic(TaskType::HARD_REALTIME, "control", 1ms,
+        [](BaseTask&) { return TaskStatus::TASK_OK; });
+    control->set_cost_model(std::make_shared<FixedCost>(100us));
+    control->enable();
+
+    // a spike of an earlier run:
+    TaskProfile seed;
+    seed.name = control->get_name();
+    seed.period = 1ms;
+    seed.num_calls = 10;
+    seed.max_time_taken = 450us;
+    seed.total_time_taken = 1000us;
+    control->seed_profile(seed);
+
+    kernel.run(100ms);
+    EXPECT_EQ(control->max_time_taken_ns(), 450us);
+    TaskProfile profile;
+    control->get_profile(profile);
+    EXPECT_EQ(profile.max_time_taken, 450us);
+
+    // until the task has run as often as the history may count:
+    kernel.run(1s);
+    ASSERT_GE(control->get_num_calls(), BaseTask::MAX_SEEDED_CALLS);
+    EXPECT_EQ(control->max_time_taken_ns(), 100us);
+    control->get_profile(profile);
+    EXPECT_EQ(profile.max_time_taken, 100us);
+}
+
+
+TEST_F(SimulatedKernelTest, KernelPublishesToSharedMemory)
+{
+    const auto name = "/urtsched-test-" + std::to_string(getpid());
+    StatsSegment segment(name, 1, logger);
+    ASSERT_TRUE(segment.ok());
+    {
+        // a segment in use is not taken over:
+        StatsSegment second(name, 1, logger);
+        EXPECT_FALSE(second.ok());
+    }
+
+    kernel.set_stats_slot(segment.kernel_slot(0), 3);
+    EXPECT_EQ(segment.kernel_slot(1), nullptr);
+
+    auto control = kernel.add_periodic(TaskType::HARD_REALTIME, "control", 1ms,
+        [](BaseTask&) { return TaskStatus::TASK_OK; });
+    control->set_cost_model(std::make_shared<FixedCost>(250us));
+    control->enable();
+
+    kernel.run(1s);
+
+    StatsReader reader(name);
+    ASSERT_TRUE(reader.ok());
+    EXPECT_EQ(reader.get_num_kernels(), 1u);
+    EXPECT_EQ(reader.get_pid(), getpid());
+    EXPECT_EQ(reader.get_version(), stats_layout::VERSION);
+
+    auto stats = std::make_unique<stats_layout::KernelStats>();
+    ASSERT_TRUE(reader.read_kernel(0, *stats));
+    EXPECT_EQ(stats->seq % 2, 0u);
+    EXPECT_STREQ(stats->name, kernel.get_name().c_str());
+    EXPECT_EQ(stats->core, 3u);
+    EXPECT_GT(stats->steps, 900u);
+    EXPECT_NEAR((double) stats->busy_ns / (double) stats->elapsed_ns, 0.25, 0.01);
+    // 1ms period - 250us:
+    EXPECT_EQ(stats->last_slack_ns, 750000);
+    ASSERT_EQ(stats->num_tasks, 1u);
+    EXPECT_EQ(stats->total_tasks, 1u);
+
+    const auto& task = stats->tasks[0];
+    EXPECT_STREQ(task.name, "periodic: control");
+    EXPECT_EQ(task.kind, stats_layout::PERIODIC);
+    EXPECT_EQ(task.period_ns, 1000000);
+    EXPECT_EQ(task.runs, control->get_num_calls());
+    // 250us = 2^17.9 ns:
+    EXPECT_EQ(task.exec_histogram[18], task.runs);
+    EXPECT_FALSE(reader.read_kernel(1, *stats));
+
+    StatsReader missing(name + "-missing");
+    EXPECT_FALSE(missing.ok());
+}
+
+
+TEST_F(SimulatedKernelTest, TasksPastMaxTasksAreCounted)
+{
+    const auto name = "/urtsched-many-" + std::to_string(getpid());
+    StatsSegment segment(name, 1, logger);
+    ASSERT_TRUE(segment.ok());
+
+    kernel.set_stats_slot(segment.kernel_slot(0), 0);
+    const size_t num_tasks = stats_layout::MAX_TASKS + 4;
+    std::vector<std::shared_ptr<PeriodicTask>> tasks;
+    for (size_t i = 0; i < num_tasks; i++)
+    {
+        tasks.push_back(kernel.add_periodic_grouped(TaskType::SOFT_REALTIME,
+            "t" + std::to_string(i), 1ms,
+            [](BaseTask&) { return TaskStatus::TASK_OK; }));
+        ASSERT_NE(tasks.back(), nullptr);
+    }
+    kernel.run(10ms);
+
+    StatsReader reader(name);
+    auto stats = std::make_unique<stats_layout::KernelStats>();
+    ASSERT_TRUE(reader.read_kernel(0, *stats));
+    EXPECT_EQ(stats->num_tasks, stats_layout::MAX_TASKS);
+    EXPECT_EQ(stats->total_tasks, num_tasks);
+}
+
+
+TEST(StatsSegmentTest, OlderVersionsAreRead)
+{
+    const auto name = "/urtsched-v1-" + std::to_string(getpid());
+    const auto size = stats_layout::kernel_stats_size(1);
+    ASSERT_LT(size, sizeof(stats_layout::KernelStats));
+
+    // as written by a version 1 kernel:
+    stats_layout::Header header{};
+    header.magic = stats_layout::MAGIC;
+    header.version = 1;
+    header.header_size = sizeof(header);
+    header.kernel_stats_size = (uint32_t) size;
+    header.task_stats_size = sizeof(stats_layout::TaskStats);
+    header.num_kernels = 1;
+    header.pid = getpid();
+    auto written = std::make_unique<stats_layout::KernelStats>();
+    strcpy(written->name, "old");
+    written->num_tasks = 2;
+    written->steps = 42;
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(write(fd, &header, sizeof(header)), (ssize_t) sizeof(header));
+    ASSERT_EQ(write(fd, written.get(), size), (ssize_t) size);
+    close(fd);
+
+    StatsReader reader(name);
+    shm_unlink(name.c_str());
+    ASSERT_TRUE(reader.ok());
+    EXPECT_EQ(reader.get_version(), 1u);
+    auto stats = std::make_unique<stats_layout::KernelStats>();
+    stats->spin_ns = 7;
+    ASSERT_TRUE(reader.read_kernel(0, *stats));
+    EXPECT_STREQ(stats->name, "old");
+    EXPECT_EQ(stats->steps, 42u);
+    EXPECT_EQ(stats->spin_ns, 0);
+    EXPECT_EQ(stats->total_tasks, 2u);
+}
+
+
+TEST(StatsSegmentTest, SegmentsOfDeadProcessesAreReplaced)
+{
+    const auto name = "/urtsched-stale-" + std::to_string(getpid());
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0)
+    {
+        _exit(0);
+    }
+    ASSERT_EQ(waitpid(child, nullptr, 0), child);
+
+    // as left behind by a process that crashed:
+    const int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    ASSERT_GE(fd, 0);
+    stats_layout::Header header{};
+    header.pid = child;
+    ASSERT_EQ(write(fd, &header, sizeof(header)), (ssize_t) sizeof(header));
+    close(fd);
+
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+    StatsSegment segment(name, 1, logger);
+    ASSERT_TRUE(segment.ok());
+    StatsReader reader(name);
+    ASSERT_TRUE(reader.ok());
+    EXPECT_EQ(reader.get_pid(), getpid());
+}
+
+
+TEST_F(RealtimeKernelTest, PerfCountersAreAggregatedPerTask)
+{
+    PerfConfig config;
+    config.hardware = false;
+    if (kernel->enable_perf_counters(config) != error::Error::OK)
+    {
+        GTEST_SKIP() << "perf_event_open() is not allowed here";
+    }
+    const auto* perf = kernel->get_perf_counters();
+    ASSERT_NE(perf, nullptr);
+    EXPECT_EQ(perf->get_mode(), PerfMode::SOFTWARE);
+    EXPECT_TRUE(perf->has(PerfEvent::TASK_CLOCK));
+    EXPECT_FALSE(perf->has(PerfEvent::CYCLES));
+    EXPECT_GT(perf->get_read_overhead(), 0ns);
+
+    // touches fresh pages on every run, the heap would hand back pages
+    // that are already mapped:
+    auto faulting = kernel->add_periodic(TaskType::SOFT_REALTIME, "faulting",
+        2ms, [](BaseTask&) {
+            constexpr size_t size = 256 * 1024;
+            auto* p = (char*) mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p != MAP_FAILED)
+            {
+                for (size_t i = 0; i < size; i += 4096)
+                {
+                    p[i] = 1;
+                }
+                munmap(p, size);
+            }
+            return TaskStatus::TASK_OK;
+        });
+    faulting->enable();
+    kernel->run(20ms);
+
+    const auto& stats = faulting->get_perf_stats();
+    EXPECT_GT(faulting->get_num_calls(), 0u);
+    EXPECT_EQ(stats.samples, faulting->get_num_calls());
+    EXPECT_GT(stats.average(PerfEvent::TASK_CLOCK), 0u);
+    EXPECT_GE(stats.max[PerfEvent::TASK_CLOCK], stats.last[PerfEvent::TASK_CLOCK]);
+    if (perf->has(PerfEvent::PAGE_FAULTS))
+    {
+        EXPECT_GT(stats.total[PerfEvent::PAGE_FAULTS], 0u);
+    }
+    EXPECT_EQ(stats.total[PerfEvent::CYCLES], 0u);
+
+    const auto status = kernel->get_service_status_as_json();
+    EXPECT_NE(status.find("\"task_clock\":"), std::string::npos) << status;
+    EXPECT_NE(status.find("\"mode\":\"software\""), std::string::npos);
+}
+
+
+TEST_F(SimulatedKernelTest, StagesRunRightAfterTheirPredecessors)
+{
+    std::string order;
+    const auto stage = [&order](char c) {
+        return [&order, c](BaseTask&) {
+            order += c;
+            return TaskStatus::TASK_OK;
+        };
+    };
+    auto chain = std::make_shared<TaskChain>("rfp", 1ms);
+    auto read = chain->add_source(
+        kernel, TaskType::HARD_REALTIME, "read", stage('r'));
+    auto filter = chain->add_stage(
+        kernel, TaskType::SOFT_REALTIME, "filter", stage('f'), { read });
+    auto publish = chain->add_stage(
+        kernel, TaskType::SOFT_REALTIME, "publish", stage('p'), { filter });
+    ASSERT_NE(publish, nullptr);
+    EXPECT_EQ(chain->add_source(kernel, TaskType::HARD_REALTIME, "again",
+                  stage('x')),
+        nullptr);
+    EXPECT_EQ(chain->add_stage(kernel, TaskType::SOFT_REALTIME, "orphan",
+                  stage('x'), {}),
+        nullptr);
+    read->set_cost_model(std::make_shared<FixedCost>(100us));
+    filter->set_cost_model(std::make_shared<FixedCost>(200us));
+    publish->set_cost_model(std::make_shared<FixedCost>(50us));
+    for (const auto& t : { read, filter, publish })
+    {
+        t->enable();
+    }
+
+    kernel.run(100ms);
+
+    EXPECT_EQ(order.substr(0, 9), "rfprfprfp");
+    // the last read may have no time left for the rest:
+    EXPECT_NEAR((double) publish->get_num_calls(),
+        (double) read->get_num_calls(), 1.0);
+    const auto latency = chain->get_latency();
+    EXPECT_EQ(latency.count, publish->get_num_calls());
+    // the stages are released without any offset:
+    EXPECT_EQ(latency.max, 350us);
+    EXPECT_EQ(latency.average(), 350us);
+    EXPECT_EQ(latency.deadline_misses, 0u);
+    EXPECT_EQ(filter->get_num_deadline_misses(), 0u);
+    EXPECT_NE(chain->get_service_status_as_json().find("\"latency\""),
+        std::string::npos);
+
+    // each stage may be blocked by the longest other task of the kernel:
+    auto analysis = chain->analyze();
+    EXPECT_TRUE(analysis.feasible());
+    EXPECT_EQ(analysis.worst_case_latency, 300us + 300us + 250us);
+    EXPECT_THAT(analysis.critical_path,
+        ElementsAre("periodic: read", "periodic: filter", "periodic: publish"));
+
+    auto tight = std::make_shared<TaskChain>("tight", 1ms, 500us);
+    auto a = tight->add_source(
+        kernel, TaskType::HARD_REALTIME, "a", stage('a'), 300us);
+    auto b = tight->add_stage(
+        kernel, TaskType::SOFT_REALTIME, "b", stage('b'), { a }, 300us);
+    ASSERT_NE(b, nullptr);
+    analysis = tight->analyze();
+    EXPECT_FALSE(analysis.feasible());
+    EXPECT_EQ(analysis.problems.size(), 1u);
+}
+
+
+TEST(TaskChainTest, StagesOnOtherKernels)
+{
+    SteadyTimer timer;
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+    RealtimeKernel producer(timer, logger, "producer");
+    RealtimeKernel consumer(timer, logger, "consumer");
+
+    uint64_t produced = 0;
+    uint64_t consumed = 0;
+    uint64_t ahead = 0;
+    auto chain = std::make_shared<TaskChain>("cross", 1ms);
+    auto source = chain->add_source(producer, TaskType::HARD_REALTIME,
+        "produce", [&](BaseTask&) {
+            produced++;
+            return TaskStatus::TASK_OK;
+        });
+    auto sink = chain->add_stage(consumer, TaskType::SOFT_REALTIME,
+        "consume", [&](BaseTask&) {
+            consumed++;
+            ahead += consumed > produced;
+            return TaskStatus::TASK_OK;
+        },
+        { source });
+    ASSERT_NE(sink, nullptr);
+    source->enable();
+    sink->enable();
+
+    std::thread other([&] { consumer.run(std::chrono::milliseconds(300)); });
+    producer.run(std::chrono::milliseconds(100));
+    other.join();
+
+    // it may lag behind (e.g. sharing a cpu) but never runs ahead:
+    EXPECT_GT(produced, 10u);
+    EXPECT_EQ(consumed, produced);
+    EXPECT_EQ(ahead, 0u);
+    EXPECT_EQ(chain->get_latency().count, consumed);
+    EXPECT_GT(chain->get_latency().max, 0ns);
+}
+
+
+TEST_F(SimulatedKernelTest, FastTaskReadsSlowTasksLatestState)
+{
+    struct Estimate
+    {
+        std::array<double, 512> state;
+        uint64_t n;
+    };
+    auto estimate = kernel.add_latest_value<Estimate>("estimate");
+    ASSERT_NE(estimate, nullptr);
+
+    uint64_t estimates = 0;
+    auto estimator = kernel.add_periodic(TaskType::HARD_REALTIME, "estimator",
+        100ms, [&](BaseTask&) {
+            auto& e = estimate->write_buffer();
+            e.n = ++estimates;
+            e.state.fill((double) e.n);
+            estimate->publish();
+            return TaskStatus::TASK_OK;
+        });
+    uint64_t inconsistent = 0;
+    auto controller = kernel.add_periodic(TaskType::SOFT_REALTIME,
+        "controller", 50ms, [&](BaseTask&) {
+            const auto& e = estimate->read();
+            inconsistent += e.state[0] != (double) e.n ||
+                e.state[511] != (double) e.n;
+            return TaskStatus::TASK_OK;
+        });
+    estimator->enable();
+    controller->enable();
+
+    kernel.run(1s);
+
+    EXPECT_EQ(inconsistent, 0u);
+    EXPECT_EQ(estimate->get_num_publishes(), estimator->get_num_calls());
+    EXPECT_EQ(estimate->get_num_reads(), controller->get_num_calls());
+    EXPECT_EQ(estimate->get_num_fresh_reads(), estimate->get_num_publishes());
+    EXPECT_EQ(estimate->get_num_overwritten(), 0u);
+    EXPECT_EQ(estimate->get_read_sequence(), estimates);
+    // every other read gets the estimate of the previous 100ms:
+    EXPECT_NEAR((double) estimate->get_max_age().count(), 50e6, 1e6);
+
+    const auto status = kernel.get_service_status_as_json();
+    EXPECT_NE(status.find("\"values\":[{\"name\":\"estimate\""),
+        std::string::npos)
+        << status;
+}
+
+
+TEST(LatestValueTest, ReaderOnAnotherThreadNeverSeesATornValue)
+{
+    SteadyTimer timer;
+    struct Block
+    {
+        std::array<uint64_t, 64> words;
+    };
+    latest_value<Block> value(&timer, "block");
+
+    constexpr uint64_t N = 200000;
+    std::thread writer([&] {
+        for (uint64_t i = 1; i <= N; i++)
+        {
+            value.write_buffer().words.fill(i);
+            value.publish();
+        }
+    });
+
+    uint64_t torn = 0;
+    uint64_t backwards = 0;
+    uint64_t last = 0;
+    while (last < N)
+    {
+        const auto& b = value.read();
+        const auto first = b.words[0];
+        torn += std::any_of(b.words.begin(), b.words.end(),
+            [first](uint64_t w) { return w != first; });
+        backwards += first < last;
+        EXPECT_EQ(value.get_read_sequence(), first);
+        last = first;
+    }
+    writer.join();
+
+    EXPECT_EQ(torn, 0u);
+    EXPECT_EQ(backwards, 0u);
+    EXPECT_EQ(value.get_num_publishes(), N);
+    EXPECT_EQ(value.get_num_fresh_reads() + value.get_num_overwritten(), N);
+}
+
+
+TEST_F(SimulatedKernelTest, HarmonicTasksShareOneRelease)
+{
+    std::string order;
+    const auto add = [&](const std::string& name, std::chrono::microseconds t,
+                         char c) {
+        auto task = kernel.add_periodic_grouped(
+            TaskType::HARD_REALTIME, name, t, [&order, c](BaseTask&) {
+                order += c;
+                return TaskStatus::TASK_OK;
+            });
+        task->set_cost_model(std::make_shared<FixedCost>(1us));
+        task->enable();
+        return task;
+    };
+    // more than fit into the kernel's own list, the slow ones first so the
+    // group has to be rebased:
+    std::vector<std::shared_ptr<PeriodicTask>> slow;
+    std::vector<std::shared_ptr<PeriodicTask>> fast;
+    for (int i = 0; i < 20; i++)
+    {
+        slow.push_back(add("slow-" + std::to_string(i), 10ms, 's'));
+    }
+    for (int i = 0; i < 80; i++)
+    {
+        fast.push_back(add("fast-" + std::to_string(i), 1ms, 'f'));
+    }
+
+    kernel.run(100ms);
+
+    // released together at the start of the hyperperiod:
+    EXPECT_EQ(order.substr(0, 100), std::string(20, 's') + std::string(80, 'f'));
+    EXPECT_EQ(order.substr(100, 80), std::string(80, 'f'));
+    for (const auto& t : fast)
+    {
+        EXPECT_NEAR((double) t->get_num_calls(), 100.0, 1.0);
+        EXPECT_EQ(t->get_num_deadline_misses(), 0u);
+    }
+    for (const auto& t : slow)
+    {
+        EXPECT_NEAR((double) t->get_num_calls(), 10.0, 1.0);
+    }
+    // the members of a release run back-to-back:
+    EXPECT_EQ(fast.back()->get_max_release_lateness(), 99us);
+
+    const auto status = kernel.get_service_status_as_json();
+    EXPECT_NE(status.find("\"release_groups\":[{\"name\":\"release group 0\","
+                          "\"period\":0.001,\"members\":100"),
+        std::string::npos)
+        << status;
+    EXPECT_NE(status.find("\"name\":\"periodic: fast-79\""), std::string::npos);
+
+    EXPECT_TRUE(kernel.remove(fast[0]));
+    EXPECT_FALSE(kernel.remove(fast[0]));
+    size_t tasks = 0;
+    kernel.for_each_task([&tasks](const BaseTask&) { tasks++; });
+    EXPECT_EQ(tasks, 99u);
+}
+
+
+TEST_F(SimulatedKernelTest, EmptiedGroupsAreRemoved)
+{
+    const auto add = [&](std::chrono::microseconds t) {
+        auto task = kernel.add_periodic_grouped(TaskType::HARD_REALTIME,
+            "every-" + std::to_string(t.count()), t,
+            [](BaseTask&) { return TaskStatus::TASK_OK; });
+        task->set_cost_model(std::make_shared<FixedCost>(10us));
+        return task;
+    };
+    const auto groups = [this] {
+        const auto status = kernel.get_service_status_as_json();
+        const auto at = status.find("\"release_groups\":");
+        return at == std::string::npos ? std::string()
+                                       : status.substr(at, status.find(']', at) - at);
+    };
+
+    auto fast = add(1000us);
+    auto slow = add(4000us);
+    kernel.run(10ms);
+    // the members are created disabled, so are never released:
+    EXPECT_NE(groups().find("\"period\":0.001,\"members\":2,\"releases\":0,"),
+        std::string::npos)
+        << groups();
+
+    fast->enable();
+    slow->enable();
+    kernel.run(10ms);
+    EXPECT_TRUE(kernel.remove(fast));
+    // back to the period of the member that is left:
+    EXPECT_NE(groups().find("\"period\":0.004,\"members\":1,"),
+        std::string::npos)
+        << groups();
+    kernel.run(20ms);
+    EXPECT_NEAR((double) slow->get_num_calls(), 8.0, 1.0);
+
+    slow->disable();
+    const auto before = groups();
+    kernel.run(10ms);
+    EXPECT_EQ(groups(), before);
+
+    // the last member takes the group and its slot with it:
+    EXPECT_TRUE(kernel.remove(slow));
+    EXPECT_EQ(groups(), "");
+    for (size_t i = 0; i < 64; i++)
+    {
+        EXPECT_NE(kernel.add_periodic(TaskType::SOFT_REALTIME, "t", 1ms,
+                      [](BaseTask&) { return TaskStatus::TASK_OK; }),
+            nullptr);
+    }
+}
+
+TEST(TimingWheelTest, FiresEachTimerOnceAtItsTick)
+{
+    const auto tick = 10us;
+    TimingWheel wheel(TimerConfig{ 50000, tick }, 0ns);
+    std::mt19937_64 rng(42);
+
+    struct Timer
+    {
+        TimerHandle handle;
+        std::chrono::nanoseconds due{ 0 };
+        int fired = 0;
+        std::chrono::nanoseconds fired_at{ 0 };
+        bool cancelled = false;
+    };
+    std::vector<Timer> timers(40000);
+    auto now = 0ns;
+    for (size_t i = 0; i < timers.size(); i++)
+    {
+        // up to ~4 levels, the last ones beyond the wheel:
+        const auto range = i < 39900 ? (int64_t) 1 << (6 + 6 * (i % 4)) : 1 << 25;
+        const auto at = std::chrono::nanoseconds(rng() % (range * 10000));
+        auto& t = timers[i];
+        t.due = (at + tick - 1ns) / tick * tick;
+        t.handle = wheel.schedule_at(at, [&t, &now] {
+            t.fired++;
+            t.fired_at = now;
+        });
+        ASSERT_TRUE(t.handle.valid());
+    }
+    EXPECT_EQ(wheel.size(), timers.size());
+    for (size_t i = 0; i < timers.size(); i += 3)
+    {
+        EXPECT_TRUE(wheel.cancel(timers[i].handle));
+        EXPECT_FALSE(wheel.cancel(timers[i].handle));
+        timers[i].cancelled = true;
+    }
+
+    // steps of all sizes, some of them over many turns of the wheel:
+    auto before = now;
+    std::vector<std::pair<std::chrono::nanoseconds, std::chrono::nanoseconds>>
+        steps;
+    while (now < 400s)
+    {
+        before = now;
+        const auto step = rng() % 4 == 0
+            ? std::chrono::nanoseconds(rng() % 5000000000)
+            : std::chrono::nanoseconds(rng() % 300000);
+        now += step;
+        steps.emplace_back(before, now);
+        wheel.expire(now);
+    }
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_EQ(wheel.get_stats().fired + wheel.get_stats().cancelled,
+        timers.size());
+
+    for (const auto& t : timers)
+    {
+        if (t.cancelled)
+        {
+            EXPECT_EQ(t.fired, 0);
+            continue;
+        }
+        ASSERT_EQ(t.fired, 1);
+        // by the first expire() at or after its tick:
+        const auto it = std::find_if(steps.begin(), steps.end(),
+            [&t](const auto& s) { return s.second == t.fired_at; });
+        ASSERT_NE(it, steps.end());
+        EXPECT_GE(t.fired_at, t.due);
+        EXPECT_LT(it->first, t.due);
+        EXPECT_FALSE(wheel.cancel(t.handle));
+    }
+
+    // a stale handle to a reused timer doesn't cancel its new one:
+    const auto fresh = wheel.schedule_at(now + 1ms, [] {});
+    const auto old = std::find_if(timers.begin(), timers.end(),
+        [&fresh](const auto& t) { return t.handle.index == fresh.index; });
+    ASSERT_NE(old, timers.end());
+    EXPECT_FALSE(wheel.cancel(old->handle));
+    EXPECT_TRUE(wheel.is_pending(fresh));
+    // a level up, the start of its slot:
+    EXPECT_GT(wheel.next_expiry_bound(), now - 1ms);
+    EXPECT_LE(wheel.next_expiry_bound(), now + 1ms);
+    EXPECT_TRUE(wheel.cancel(fresh));
+    EXPECT_EQ(wheel.next_expiry_bound(), std::chrono::nanoseconds::max());
+}
+
+
+TEST_F(SimulatedKernelTest, KernelRunsTimersInTheSlack)
+{
+    std::vector<std::chrono::nanoseconds> fired;
+    TimerHandle cancelled;
+    auto task = kernel.add_periodic(
+        TaskType::HARD_REALTIME, "control", 1ms, [&](BaseTask& t) {
+            if (t.get_num_calls() == 3)
+            {
+                // a timeout that is met:
+                cancelled = kernel.schedule_after(
+                    1500us, [&fired] { fired.push_back(-1ns); });
+            }
+            if (t.get_num_calls() == 4)
+            {
+                EXPECT_TRUE(kernel.cancel_timer(cancelled));
+            }
+            return TaskStatus::TASK_OK;
+        });
+    task->set_cost_model(std::make_shared<FixedCost>(100us));
+    task->enable();
+
+    kernel.schedule_after(
+        2550us, [&] { fired.push_back(timer.get_time_ns()); });
+    // rearms itself:
+    std::function<void()> every_3ms = [&] {
+        fired.push_back(timer.get_time_ns());
+        kernel.schedule_after(3ms, every_3ms);
+    };
+    kernel.schedule_after(3ms, every_3ms);
+
+    kernel.run(10ms);
+
+    // between the releases, to the 100us tick:
+    ASSERT_GE(fired.size(), 4u);
+    EXPECT_EQ(fired[0], 2600us);
+    EXPECT_EQ(fired[1], 3100us);
+    EXPECT_EQ(fired[2], 6100us);
+    EXPECT_EQ(fired[3], 9100us);
+    EXPECT_EQ(std::count(fired.begin(), fired.end(), -1ns), 0);
+    EXPECT_EQ(task->get_num_deadline_misses(), 0u);
+    EXPECT_FALSE(kernel.cancel_timer(cancelled));
+
+    const auto status = kernel.get_service_status_as_json();
+    EXPECT_NE(status.find("\"timers\":{\"pending\":1,"), std::string::npos)
+        << status;
+    EXPECT_NE(status.find("\"fired\":4,\"cancelled\":1,"), std::string::npos)
+        << status;
+}
+
+
+TEST_F(SimulatedKernelTest, TimersRearmedRightAwayWaitForTheNextExpire)
+{
+    TimingWheel wheel(TimerConfig(), 0ns);
+    size_t runs = 0;
+    std::function<void()> again = [&] {
+        runs++;
+        wheel.schedule_at(0ns, again);
+    };
+    wheel.schedule_at(0ns, again);
+    EXPECT_EQ(wheel.expire(1ms), 1u);
+    EXPECT_EQ(wheel.expire(1ms), 1u);
+    EXPECT_EQ(runs, 2u);
+    EXPECT_EQ(wheel.size(), 1u);
+
+    // in simulated time, where callbacks take no time at all:
+    auto task = kernel.add_periodic(TaskType::HARD_REALTIME, "control", 1ms,
+        [](BaseTask&) { return TaskStatus::TASK_OK; });
+    task->set_cost_model(std::make_shared<FixedCost>(100us));
+    task->enable();
+
+    size_t fired = 0;
+    std::function<void()> rearm = [&] {
+        fired++;
+        kernel.schedule_after(0ns, rearm);
+    };
+    kernel.schedule_after(0ns, rearm);
+
+    kernel.run(10ms);
+    EXPECT_GE(task->get_num_calls(), 9u);
+    EXPECT_GT(fired, 0u);
+}
+
+
+TEST_F(SimulatedKernelTest, RunningKernelDoesNotCreateTheTimers)
+{
+    TimerHandle handle;
+    auto task = kernel.add_periodic(
+        TaskType::HARD_REALTIME, "control", 1ms, [&](BaseTask&) {
+            handle = kernel.schedule_after(1ms, [] {});
+            return TaskStatus::TASK_OK;
+        });
+    task->enable();
+
+    // the timers are only created before run():
+    EXPECT_DEBUG_DEATH(kernel.run(3ms), "m_running");
+    EXPECT_FALSE(handle.valid());
+    EXPECT_EQ(kernel.get_timers(), nullptr);
+}
+
 } // namespace unittests
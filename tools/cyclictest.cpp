@@ -0,0 +1,440 @@
+/** urtsched-cyclictest: measures how late the release of a hard real-time
+ * periodic task is on each reserved core, in the spirit of rt-tests'
+ * cyclictest. Use it to qualify a host (kernel command line, isolation,
+ * C-states, ...) before deploying services on it.
+ */
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <slogger/DirectConsoleLogger.hpp>
+#include <urtsched/MonotonicTimer.hpp>
+#include <urtsched/MultiCoreRealtimeKernel.hpp>
+#include <urtsched/ServiceBus.hpp>
+
+using namespace realtime;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+struct Options
+{
+    uint32_t num_cores = 1;
+    uint32_t first_core = 1;
+    std::chrono::microseconds period = 1000us;
+    std::chrono::seconds duration = 10s;
+    WaitKind wait = WaitKind::SPIN;
+    std::chrono::microseconds spin_window = 50us;
+    SchedPolicy policy = SchedPolicy::FIFO;
+    int priority = 80;
+    CoreReservationMechanism reserve = CoreReservationMechanism::NONE;
+    std::optional<std::chrono::microseconds> dma_latency;
+    uint32_t load_threads = 0;
+    size_t buckets = 1000;
+    bool histogram = false;
+    bool json = false;
+    std::optional<std::string> stats_segment;
+};
+
+
+void usage()
+{
+    std::cerr
+        << "usage: urtsched-cyclictest [options]\n"
+           "  --cores N            number of cores/kernels (1)\n"
+           "  --first-core C       first reserved core (1)\n"
+           "  --period US          release period in microseconds (1000)\n"
+           "  --duration S         how long to measure in seconds (10)\n"
+           "  --wait spin|hybrid   how to wait for a release (spin)\n"
+           "  --spin-window US     hybrid: spin this long before a release (50)\n"
+           "  --policy fifo|rr|other\n"
+           "  --priority P         for fifo and rr (80)\n"
+           "  --reserve none|taskset|cgroups (none)\n"
+           "  --dma-latency US     hold a /dev/cpu_dma_latency request\n"
+           "  --load N             run N busy threads as background load (0)\n"
+           "  --buckets N          histogram buckets of 1us, the last one "
+           "counts all overflows (1000)\n"
+           "  --histogram          print the histogram\n"
+           "  --json               print the results as json\n"
+           "  --stats NAME         publish stats for urtsched-top in shm NAME\n";
+}
+
+
+std::optional<Options> parse_options(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument(arg + " needs a value");
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--cores")
+        {
+            opt.num_cores = (uint32_t) std::stoul(value());
+        }
+        else if (arg == "--first-core")
+        {
+            opt.first_core = (uint32_t) std::stoul(value());
+        }
+        else if (arg == "--period")
+        {
+            opt.period = std::chrono::microseconds(std::stol(value()));
+        }
+        else if (arg == "--duration")
+        {
+            opt.duration = std::chrono::seconds(std::stol(value()));
+        }
+        else if (arg == "--wait")
+        {
+            const auto v = value();
+            if (v != "spin" && v != "hybrid")
+            {
+                throw std::invalid_argument("unknown wait strategy: " + v);
+            }
+            opt.wait = v == "hybrid" ? WaitKind::HYBRID : WaitKind::SPIN;
+        }
+        else if (arg == "--spin-window")
+        {
+            opt.spin_window = std::chrono::microseconds(std::stol(value()));
+        }
+        else if (arg == "--policy")
+        {
+            const auto v = value();
+            if (v == "fifo")
+            {
+                opt.policy = SchedPolicy::FIFO;
+            }
+            else if (v == "rr")
+            {
+                opt.policy = SchedPolicy::RR;
+            }
+            else if (v == "other")
+            {
+                opt.policy = SchedPolicy::OTHER;
+            }
+            else
+            {
+                throw std::invalid_argument("unknown policy: " + v);
+            }
+        }
+        else if (arg == "--priority")
+        {
+            opt.priority = std::stoi(value());
+        }
+        else if (arg == "--reserve")
+        {
+            const auto v = value();
+            if (v == "none")
+            {
+                opt.reserve = CoreReservationMechanism::NONE;
+            }
+            else if (v == "taskset")
+            {
+                opt.reserve = CoreReservationMechanism::TASKSET;
+            }
+            else if (v == "cgroups")
+            {
+                opt.reserve = CoreReservationMechanism::CGROUPS;
+            }
+            else
+            {
+                throw std::invalid_argument("unknown reservation: " + v);
+            }
+        }
+        else if (arg == "--dma-latency")
+        {
+            opt.dma_latency = std::chrono::microseconds(std::stol(value()));
+        }
+        else if (arg == "--load")
+        {
+            opt.load_threads = (uint32_t) std::stoul(value());
+        }
+        else if (arg == "--buckets")
+        {
+            opt.buckets = std::max<size_t>(1, std::stoul(value()));
+        }
+        else if (arg == "--histogram")
+        {
+            opt.histogram = true;
+        }
+        else if (arg == "--json")
+        {
+            opt.json = true;
+        }
+        else if (arg == "--stats")
+        {
+            opt.stats_segment = value();
+        }
+        else
+        {
+            return std::nullopt;
+        }
+    }
+    return opt;
+}
+
+
+/** release latencies of one core, only touched by that core's kernel */
+struct CoreLatencies
+{
+    explicit CoreLatencies(size_t num_buckets)
+        : buckets(num_buckets, 0)
+    {
+    }
+
+    void add(std::chrono::nanoseconds latency)
+    {
+        if (!started)
+        {
+            // the first release is relative to when the task was added
+            started = true;
+            return;
+        }
+        const auto us = (size_t) std::max<int64_t>(0,
+            std::chrono::duration_cast<std::chrono::microseconds>(latency)
+                .count());
+        buckets[std::min(us, buckets.size() - 1)]++;
+        min = std::min(min, latency);
+        max = std::max(max, latency);
+        total += latency;
+        count++;
+    }
+
+    std::chrono::nanoseconds avg() const
+    {
+        return count == 0 ? 0ns : total / (int64_t) count;
+    }
+
+    std::vector<uint64_t> buckets;
+    std::chrono::nanoseconds min = std::chrono::nanoseconds::max();
+    std::chrono::nanoseconds max = 0ns;
+    std::chrono::nanoseconds total = 0ns;
+    uint64_t count = 0;
+    uint64_t deadline_misses = 0;
+    bool started = false;
+};
+
+
+const char* policy_name(SchedPolicy policy)
+{
+    switch (policy)
+    {
+        case SchedPolicy::FIFO:
+            return "fifo";
+        case SchedPolicy::RR:
+            return "rr";
+        case SchedPolicy::OTHER:
+            return "other";
+        default:
+            return "?";
+    }
+}
+
+
+double to_us(std::chrono::nanoseconds ns)
+{
+    return (double) ns.count() / 1000.0;
+}
+
+
+void print_summary(const Options& opt, const std::vector<uint32_t>& cores,
+    const std::vector<CoreLatencies>& latencies)
+{
+    // like cyclictest, SCHED_OTHER threads have no real-time priority:
+    const int priority = opt.policy == SchedPolicy::OTHER ? 0 : opt.priority;
+    std::printf("# Policy: %s\n", policy_name(opt.policy));
+    for (size_t i = 0; i < latencies.size(); i++)
+    {
+        const auto& l = latencies[i];
+        std::printf("T:%2zu (core %3u) P:%2d I:%ld C:%9lu Min:%9.1f Avg:%9.1f "
+                    "Max:%9.1f Misses:%lu\n",
+            i, cores[i], priority, (long) opt.period.count(),
+            (unsigned long) l.count, l.count ? to_us(l.min) : 0.0,
+            to_us(l.avg()), to_us(l.max), (unsigned long) l.deadline_misses);
+    }
+
+    if (opt.histogram)
+    {
+        std::printf("# Histogram (us, the last bucket counts overflows)\n");
+        for (size_t b = 0; b < opt.buckets; b++)
+        {
+            bool any = false;
+            for (const auto& l : latencies)
+            {
+                any = any || l.buckets[b] != 0;
+            }
+            if (!any)
+            {
+                continue;
+            }
+            std::printf("%06zu", b);
+            for (const auto& l : latencies)
+            {
+                std::printf(" %06lu", (unsigned long) l.buckets[b]);
+            }
+            std::printf("\n");
+        }
+    }
+}
+
+
+void print_json(const Options& opt, const std::vector<uint32_t>& cores,
+    const std::vector<CoreLatencies>& latencies)
+{
+    std::string ret = std::format("{{ \"period_us\": {}, \"wait\": \"{}\", "
+                                  "\"load_threads\": {}, \"cores\": [",
+        opt.period.count(), opt.wait == WaitKind::HYBRID ? "hybrid" : "spin",
+        opt.load_threads);
+    const char* comma = "";
+    for (size_t i = 0; i < latencies.size(); i++)
+    {
+        const auto& l = latencies[i];
+        ret += comma;
+        ret += std::format("\n{{ \"core\": {}, \"count\": {}, \"min_us\": {}, "
+                           "\"avg_us\": {}, \"max_us\": {}, \"misses\": {}, "
+                           "\"histogram_us\": [",
+            cores[i], l.count, l.count ? to_us(l.min) : 0.0, to_us(l.avg()),
+            to_us(l.max), l.deadline_misses);
+        const char* bucket_comma = "";
+        for (const auto b : l.buckets)
+        {
+            ret += bucket_comma;
+            ret += std::to_string(b);
+            bucket_comma = ",";
+        }
+        ret += "] }";
+        comma = ",";
+    }
+    ret += "] }\n";
+    std::fputs(ret.c_str(), stdout);
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    std::optional<Options> parsed;
+    try
+    {
+        parsed = parse_options(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << "\n";
+    }
+    if (!parsed)
+    {
+        usage();
+        return 2;
+    }
+    const auto& opt = *parsed;
+
+    MonotonicTimer timer;
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+    service::ServiceBus bus;
+    MultiCoreRealtimeKernel mc(timer, logger, bus, opt.reserve, opt.first_core);
+
+    if (opt.dma_latency)
+    {
+        PowerLatencyConfig power;
+        power.cpu_dma_latency = opt.dma_latency;
+        mc.set_power_latency(power);
+    }
+
+    if (opt.stats_segment)
+    {
+        mc.set_stats_segment(*opt.stats_segment);
+    }
+
+    MemoryHardeningConfig memory;
+    memory.lock_memory = true;
+    mc.set_memory_hardening(memory);
+
+    std::vector<CoreLatencies> latencies(opt.num_cores, CoreLatencies(opt.buckets));
+    std::vector<std::shared_ptr<PeriodicTask>> tasks;
+    for (uint32_t i = 0; i < opt.num_cores; i++)
+    {
+        auto kernel = mc.add_core();
+
+        SchedulingConfig sched;
+        sched.policy = opt.policy;
+        sched.priority = opt.priority;
+        kernel->set_scheduling_config(sched);
+
+        WaitStrategy wait;
+        wait.kind = opt.wait;
+        wait.spin_window = opt.spin_window;
+        kernel->set_wait_strategy(wait);
+
+        auto& l = latencies[i];
+        auto task = kernel->add_periodic(TaskType::HARD_REALTIME, "cyclic",
+            opt.period, [&l](BaseTask& t) {
+                l.add(t.get_last_release_lateness());
+                return TaskStatus::TASK_OK;
+            });
+        task->enable();
+        tasks.push_back(task);
+    }
+
+    std::atomic<bool> stop_load = false;
+    std::vector<std::thread> load;
+    for (uint32_t i = 0; i < opt.load_threads; i++)
+    {
+        load.emplace_back([&stop_load]() {
+            // touch memory as well to disturb the caches:
+            std::vector<uint8_t> buf(4 * 1024 * 1024);
+            size_t ix = 0;
+            while (!stop_load.load(std::memory_order_relaxed))
+            {
+                buf[ix] = (uint8_t) (buf[ix] + 1);
+                ix = (ix + 4096 + 64) % buf.size();
+            }
+        });
+    }
+
+    const auto result = mc.run(opt.duration);
+
+    stop_load = true;
+    for (auto& t : load)
+    {
+        t.join();
+    }
+
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+        latencies[i].deadline_misses = tasks[i]->get_num_deadline_misses();
+    }
+
+    if (result != error::Error::OK)
+    {
+        std::cerr << "warning: not all cores could be scheduled as asked, "
+                     "see the log\n";
+    }
+
+    if (opt.json)
+    {
+        print_json(opt, mc.get_reserved_cores(), latencies);
+    }
+    else
+    {
+        print_summary(opt, mc.get_reserved_cores(), latencies);
+    }
+    return result == error::Error::OK ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+/** urtsched-top: shows the per-core utilization, slack and deadline misses
+ * of a running urtsched process from its shared memory statistics segment,
+ * see MultiCoreRealtimeKernel::set_stats_segment(). It only reads the
+ * segment, the real-time cores are not disturbed.
+ */
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <urtsched/StatsSegment.hpp>
+
+using namespace realtime;
+using namespace realtime::stats_layout;
+
+namespace
+{
+
+void usage()
+{
+    std::cerr << "usage: urtsched-top [--name /urtsched] [--interval MS] "
+                 "[--once] [--tasks]\n";
+}
+
+
+double to_us(int64_t ns)
+{
+    return (double) ns / 1000.0;
+}
+
+
+/** the upper bound of the histogram bucket holding the p-th percentile */
+int64_t percentile_ns(const TaskStats& t, double p)
+{
+    uint64_t total = 0;
+    for (const auto n : t.exec_histogram)
+    {
+        total += n;
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+    const auto wanted = (uint64_t) ((double) total * p);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < EXEC_HISTOGRAM_BUCKETS; b++)
+    {
+        seen += t.exec_histogram[b];
+        if (seen >= wanted)
+        {
+            return b == 0 ? 0 : (int64_t) 1 << b;
+        }
+    }
+    return (int64_t) 1 << (EXEC_HISTOGRAM_BUCKETS - 1);
+}
+
+
+/** the rates are between 'before' and 'now' */
+void show(const std::vector<KernelStats>& now,
+    const std::vector<KernelStats>& before, bool tasks, bool check_stalls)
+{
+    std::printf("%-16s %4s %7s %6s %6s %6s %6s %10s %10s %10s %10s\n",
+        "kernel", "core", "util%", "ovh%", "spin%", "sweep%", "sleep%",
+        "steps/s", "misses", "slack(us)", "minslack");
+    for (size_t i = 0; i < now.size(); i++)
+    {
+        const auto& k = now[i];
+        const auto& b = before[i];
+        const auto elapsed = k.elapsed_ns - b.elapsed_ns;
+        const auto percent = [&](int64_t ns, int64_t before_ns) {
+            return elapsed > 0 ? 100.0 * (double) (ns - before_ns) / (double) elapsed
+                               : 0.0;
+        };
+        const double steps = elapsed > 0
+            ? (double) (k.steps - b.steps) * 1e9 / (double) elapsed
+            : 0.0;
+        std::printf(
+            "%-16s %4u %7.1f %6.1f %6.1f %6.1f %6.1f %10.0f %10lu %10.1f %10.1f%s\n",
+            k.name, k.core, percent(k.busy_ns, b.busy_ns),
+            percent(k.overhead_ns, b.overhead_ns),
+            percent(k.spin_ns, b.spin_ns),
+            percent(k.idle_sweep_ns, b.idle_sweep_ns),
+            percent(k.sleep_ns, b.sleep_ns), steps,
+            (unsigned long) k.deadline_misses,
+            to_us(k.last_slack_ns), to_us(k.min_slack_ns),
+            check_stalls && k.steps == b.steps ? "  (stalled?)" : "");
+
+        if (!tasks)
+        {
+            continue;
+        }
+        for (uint32_t t = 0; t < k.num_tasks && t < MAX_TASKS; t++)
+        {
+            const auto& task = k.tasks[t];
+            std::printf("    %-32s runs %10lu misses %6lu avg %8.1fus p99 "
+                        "<%8.1fus max %8.1fus late max %8.1fus\n",
+                task.name, (unsigned long) task.runs,
+                (unsigned long) task.deadline_misses,
+                task.runs ? to_us(task.total_exec_ns / (int64_t) task.runs) : 0.0,
+                to_us(percentile_ns(task, 0.99)), to_us(task.max_exec_ns),
+                to_us(task.max_release_lateness_ns));
+        }
+        if (k.total_tasks > k.num_tasks)
+        {
+            std::printf("    ... and %u more tasks\n", k.total_tasks - k.num_tasks);
+        }
+    }
+}
+
+
+bool read_all(const StatsReader& reader, std::vector<KernelStats>& out)
+{
+    out.resize(reader.get_num_kernels());
+    for (uint32_t i = 0; i < out.size(); i++)
+    {
+        if (!reader.read_kernel(i, out[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    std::string name = "/urtsched";
+    std::chrono::milliseconds interval(1000);
+    bool once = false;
+    bool tasks = false;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--name" && i + 1 < argc)
+        {
+            name = argv[++i];
+        }
+        else if (arg == "--interval" && i + 1 < argc)
+        {
+            interval = std::chrono::milliseconds(std::stol(argv[++i]));
+        }
+        else if (arg == "--once")
+        {
+            once = true;
+        }
+        else if (arg == "--tasks")
+        {
+            tasks = true;
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    StatsReader reader(name);
+    if (!reader.ok())
+    {
+        std::cerr << "no urtsched stats segment " << name
+                  << " (or of another version)\n";
+        return 1;
+    }
+
+    std::vector<KernelStats> before;
+    std::vector<KernelStats> now;
+    if (!read_all(reader, before))
+    {
+        std::cerr << "failed to read a consistent snapshot\n";
+        return 1;
+    }
+
+    if (once)
+    {
+        // utilization since the start of run():
+        const std::vector<KernelStats> zero(before.size());
+        show(before, zero, tasks, false);
+        return 0;
+    }
+
+    while (true)
+    {
+        std::this_thread::sleep_for(interval);
+        if (!read_all(reader, now))
+        {
+            continue;
+        }
+        std::printf("\033[H\033[2Jpid %ld\n", (long) reader.get_pid());
+        show(now, before, tasks, true);
+        std::fflush(stdout);
+        before = now;
+    }
+}